@@ -0,0 +1,265 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// [Utilities] Object Allocation Helpers
+
+#include "MMSwitcher.h"
+
+#include "Allocator.h"
+
+#include <malloc.h>
+
+static __declspec(thread) TArena *__CurrentArena = nullptr;
+
+TArena::TArena(size_t xChunkSize) :
+	Chunks(nullptr), Cursor(nullptr), Limit(nullptr), Used(0), Lock(0), ChunkSize(xChunkSize) {}
+
+TArena::~TArena(void) {
+	while (Chunks != nullptr) {
+		TChunk *Chunk = Chunks;
+		Chunks = Chunk->Next;
+		free(Chunk);
+	}
+}
+
+void* TArena::__Grow(size_t Size, size_t Align) {
+	size_t ChunkSpace = sizeof(TChunk) + Align - 1 + Size;
+	// Oversized allocations get a dedicated chunk, behind the current one
+	bool Dedicated = ChunkSpace > ChunkSize;
+	if (!Dedicated) ChunkSpace = ChunkSize;
+
+	TChunk *Chunk = (TChunk*)malloc(ChunkSpace);
+	if (Chunk == nullptr)
+		FAIL(_T("Unable to allocate arena chunk of %llu bytes"), (UINT64)ChunkSpace);
+	Chunk->Size = ChunkSpace;
+
+	BYTE *Base = (BYTE*)(Chunk + 1);
+	BYTE *Ret = (BYTE*)(((UINT_PTR)Base + Align - 1) & ~(UINT_PTR)(Align - 1));
+	if (Dedicated && (Chunks != nullptr)) {
+		Chunk->Next = Chunks->Next;
+		Chunks->Next = Chunk;
+	} else {
+		Chunk->Next = Chunks;
+		Chunks = Chunk;
+		Cursor = Ret + Size;
+		Limit = (BYTE*)Chunk + ChunkSpace;
+	}
+	Used += Size;
+	return Ret;
+}
+
+void TArena::__Lock(void) {
+	while (InterlockedExchange(&Lock, 1) != 0) {
+		for (int Spin = 0; Lock != 0; Spin++) {
+			if (Spin < 64) YieldProcessor();
+			else SwitchToThread();
+		}
+	}
+}
+
+void* TArena::SyncAlloc(size_t Size, size_t Align) {
+	__Lock();
+	void *Ret;
+	try {
+		Ret = Alloc(Size, Align);
+	} catch (...) {
+		__Unlock();
+		throw;
+	}
+	__Unlock();
+	return Ret;
+}
+
+void TArena::Reset(void) {
+	TChunk *Retain = nullptr;
+	while (Chunks != nullptr) {
+		TChunk *Chunk = Chunks;
+		Chunks = Chunk->Next;
+		if ((Retain == nullptr) && (Chunk->Size == ChunkSize)) Retain = Chunk;
+		else free(Chunk);
+	}
+	if (Retain != nullptr) {
+		Retain->Next = nullptr;
+		Chunks = Retain;
+		Cursor = (BYTE*)(Retain + 1);
+		Limit = (BYTE*)Retain + Retain->Size;
+	} else {
+		Cursor = Limit = nullptr;
+	}
+	Used = 0;
+}
+
+size_t TArena::Reserved(void) const {
+	size_t Ret = 0;
+	for (TChunk *Chunk = Chunks; Chunk != nullptr; Chunk = Chunk->Next)
+		Ret += Chunk->Size;
+	return Ret;
+}
+
+TArena* TArena::Current(void) {
+	return __CurrentArena;
+}
+
+TArena::TScope::TScope(TArena &Arena) : Prev(__CurrentArena) {
+	__CurrentArena = &Arena;
+}
+
+TArena::TScope::~TScope(void) {
+	__CurrentArena = Prev;
+}
+
+// Free blocks are singly linked through their first pointer;
+// the first block of a batch in a depot links to the next batch through its second pointer
+#define __BlockNext(Block) (((void**)(Block))[0])
+#define __BatchNext(Block) (((void**)(Block))[1])
+
+struct TFixedPoolCache {
+	void *Head;
+	size_t Count;
+};
+
+struct TFixedPoolDepot {
+	LONG volatile Lock;
+	void *Batches;
+};
+
+static __declspec(thread) TFixedPoolCache __FixedPoolCaches[FIXEDPOOL_CLASSES];
+static TFixedPoolDepot __FixedPoolDepots[FIXEDPOOL_CLASSES];
+
+static void __DepotLock(TFixedPoolDepot &Depot) {
+	while (InterlockedExchange(&Depot.Lock, 1) != 0) {
+		for (int Spin = 0; Depot.Lock != 0; Spin++) {
+			if (Spin < 64) YieldProcessor();
+			else SwitchToThread();
+		}
+	}
+}
+
+static void __DepotUnlock(TFixedPoolDepot &Depot) {
+	InterlockedExchange(&Depot.Lock, 0);
+}
+
+static void* __DepotCarve(size_t Class) {
+	size_t BlockSize = (Class + 1) * FIXEDPOOL_GRANULARITY;
+	size_t BlockCount = FIXEDPOOL_CHUNK / BlockSize;
+	BYTE *Chunk = (BYTE*)_aligned_malloc(BlockCount * BlockSize, FIXEDPOOL_GRANULARITY);
+	if (Chunk == nullptr)
+		FAIL(_T("Unable to allocate fixed pool chunk for %d byte blocks"), (int)BlockSize);
+
+	// Chain blocks into batches, the first batch is handed to the caller
+	void *Batches = nullptr;
+	void *LastBatch = nullptr;
+	for (size_t Idx = 0; Idx < BlockCount; Idx += FIXEDPOOL_BATCH) {
+		size_t Count = min(BlockCount - Idx, (size_t)FIXEDPOOL_BATCH);
+		BYTE *Batch = Chunk + Idx * BlockSize;
+		for (size_t i = 0; i < Count - 1; i++)
+			__BlockNext(Batch + i * BlockSize) = Batch + (i + 1) * BlockSize;
+		__BlockNext(Batch + (Count - 1) * BlockSize) = nullptr;
+		__BatchNext(Batch) = nullptr;
+		if (LastBatch != nullptr) __BatchNext(LastBatch) = Batch;
+		else Batches = Batch;
+		LastBatch = Batch;
+	}
+
+	void *Ret = Batches;
+	if ((Batches = __BatchNext(Ret)) != nullptr) {
+		TFixedPoolDepot &Depot = __FixedPoolDepots[Class];
+		__DepotLock(Depot);
+		__BatchNext(LastBatch) = Depot.Batches;
+		Depot.Batches = Batches;
+		__DepotUnlock(Depot);
+	}
+	return Ret;
+}
+
+static void __CacheRefill(size_t Class, TFixedPoolCache &Cache) {
+	TFixedPoolDepot &Depot = __FixedPoolDepots[Class];
+	__DepotLock(Depot);
+	void *Batch = Depot.Batches;
+	if (Batch != nullptr) Depot.Batches = __BatchNext(Batch);
+	__DepotUnlock(Depot);
+	if (Batch == nullptr) Batch = __DepotCarve(Class);
+
+	// Batches returned by a flush may be partial
+	Cache.Head = Batch;
+	Cache.Count = 0;
+	for (void *Block = Batch; Block != nullptr; Block = __BlockNext(Block))
+		Cache.Count++;
+}
+
+static void __CacheSpill(size_t Class, TFixedPoolCache &Cache, size_t Count) {
+	// Keep the most recently freed (cache-hot) blocks, spill the rest
+	void *Batch = Cache.Head;
+	size_t Keep = Cache.Count - Count;
+	if (Keep > 0) {
+		void *Last = Cache.Head;
+		for (size_t i = 1; i < Keep; i++)
+			Last = __BlockNext(Last);
+		Batch = __BlockNext(Last);
+		__BlockNext(Last) = nullptr;
+	} else Cache.Head = nullptr;
+	Cache.Count = Keep;
+
+	TFixedPoolDepot &Depot = __FixedPoolDepots[Class];
+	__DepotLock(Depot);
+	__BatchNext(Batch) = Depot.Batches;
+	Depot.Batches = Batch;
+	__DepotUnlock(Depot);
+}
+
+void* TFixedPool::Alloc(size_t Size) {
+	size_t Class = SizeClass(Size);
+	TFixedPoolCache &Cache = __FixedPoolCaches[Class];
+	if (Cache.Head == nullptr)
+		__CacheRefill(Class, Cache);
+
+	void *Ret = Cache.Head;
+	Cache.Head = __BlockNext(Ret);
+	Cache.Count--;
+	return Ret;
+}
+
+void TFixedPool::Free(void *Block, size_t Size) {
+	size_t Class = SizeClass(Size);
+	TFixedPoolCache &Cache = __FixedPoolCaches[Class];
+	__BlockNext(Block) = Cache.Head;
+	Cache.Head = Block;
+	if (++Cache.Count >= FIXEDPOOL_BATCH * 2)
+		__CacheSpill(Class, Cache, FIXEDPOOL_BATCH);
+}
+
+void TFixedPool::FlushThreadCache(void) {
+	for (size_t Class = 0; Class < FIXEDPOOL_CLASSES; Class++) {
+		TFixedPoolCache &Cache = __FixedPoolCaches[Class];
+		while (Cache.Count > 0)
+			__CacheSpill(Class, Cache, min(Cache.Count, (size_t)FIXEDPOOL_BATCH));
+	}
+}
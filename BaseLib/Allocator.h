@@ -35,6 +35,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @author Zhenyu Wu
  * @date Oct 27, 2013: Refactored from SyncObjs
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Arena allocator
+ * @date Oct 17, 2026: Fixed-size pool allocator
+ * @date Oct 17, 2026: Shared placement construction helper
+ * @date Oct 17, 2026: Cross-thread arena allocator binding
  **/
 
 #ifndef Allocator_H
@@ -44,10 +48,25 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Exception.h"
 
 #include <functional>
+#include <utility>
 
 template<class T>
 struct IAllocator {};
 
+// Placement new is not compatible with debug / statistics "new" macro
+#pragma push_macro("new")
+#undef new
+
+/**
+ * @ingroup Utilities
+ * Construct an object in place on given memory
+ **/
+template<typename T, typename... Params>
+inline T* PlacementNew(void *Mem, Params&&... xParams)
+{ return new (Mem) T(std::forward<Params>(xParams)...); }
+
+#pragma pop_macro("new")
+
 /**
  * @ingroup Utilities
  * @brief Object allocator template
@@ -61,7 +80,7 @@ struct SimpleAllocator : public IAllocator < T > {
 	 **/
 	template<typename... Params>
 	inline static T* Create(Params&&... xParams)
-	{ return new T(xParams...); }
+	{ return new T(std::forward<Params>(xParams)...); }
 
 	/**
 	 * Destroy an object
@@ -104,4 +123,206 @@ struct LambdaAllocator : public IAllocator < T > {
 		Create(A), Destroy([](T*) {FAIL(_T("Should not reach")); }) {}
 };
 
+/**
+ * @ingroup Utilities
+ * @brief Bump-pointer memory arena
+ *
+ * Serves allocations from chained chunks by bumping a cursor, and releases all memory at once on Reset()
+ * @note Alloc() is NOT thread-safe, it should only be used by one thread at a time;
+ *       SyncAlloc() serializes on an internal lock (for arenas shared by threads),
+ *       and must not be mixed with concurrent Alloc() calls
+ **/
+class TArena {
+protected:
+	struct TChunk {
+		TChunk *Next;
+		size_t Size;
+	};
+
+	TChunk *Chunks;
+	BYTE *Cursor;
+	BYTE *Limit;
+	size_t Used;
+	LONG volatile Lock;
+
+	void* __Grow(size_t Size, size_t Align);
+	void __Lock(void);
+	void __Unlock(void)
+	{ InterlockedExchange(&Lock, 0); }
+
+public:
+	size_t const ChunkSize;
+
+	TArena(size_t xChunkSize = 64 * BSize_aKB);
+	~TArena(void);
+
+	/**
+	 * Allocate a block of memory with given alignment (must be power of 2)
+	 **/
+	inline void* Alloc(size_t Size, size_t Align = sizeof(void*)) {
+		BYTE *Ret = (BYTE*)(((UINT_PTR)Cursor + Align - 1) & ~(UINT_PTR)(Align - 1));
+		if ((Ret > Limit) || ((size_t)(Limit - Ret) < Size))
+			return __Grow(Size, Align);
+		Cursor = Ret + Size;
+		Used += Size;
+		return Ret;
+	}
+
+	/**
+	 * Thread-safe version of Alloc()
+	 **/
+	void* SyncAlloc(size_t Size, size_t Align = sizeof(void*));
+
+	/**
+	 * Release all allocations at once (the first chunk is retained for reuse)
+	 * @note Destructors of objects still living in the arena are NOT invoked
+	 **/
+	void Reset(void);
+
+	/**
+	 * Get the number of bytes allocated since last reset
+	 **/
+	size_t Allocated(void) const
+	{ return Used; }
+
+	/**
+	 * Get the number of bytes reserved in chunks
+	 **/
+	size_t Reserved(void) const;
+
+	/**
+	 * Get the arena currently in scope on the calling thread (nullptr if none)
+	 **/
+	static TArena* Current(void);
+
+	/**
+	 * @ingroup Utilities
+	 * @brief Arena scope
+	 *
+	 * Makes an arena current on the calling thread for its life time, restoring the previous one on exit
+	 **/
+	class TScope {
+	protected:
+		TArena *Prev;
+	public:
+		TScope(TArena &Arena);
+		~TScope(void);
+	};
+};
+
+/**
+ * @ingroup Utilities
+ * @brief Arena object allocator template
+ *
+ * Creates objects from the arena currently in scope (see TArena::TScope), or else the arena bound to the allocator
+ * Only the bound arena is shared by threads, so only allocations from it take the arena lock
+ * @note Destroy() only invokes the destructor, memory is reclaimed when the arena is reset;
+ *       all objects must be destroyed before their arena is reset or destroyed,
+ *       and the bound arena must not be put in scope while it is bound
+ **/
+template<typename T>
+struct ArenaAllocator : public IAllocator < T > {
+protected:
+	inline static TArena*& __Bound(void) {
+		static TArena *Bound = nullptr;
+		return Bound;
+	}
+
+public:
+	/**
+	 * Bind an arena (nullptr to unbind) for creating objects on threads without an arena in scope
+	 **/
+	inline static void Bind(TArena *Arena)
+	{ __Bound() = Arena; }
+
+	template<typename... Params>
+	inline static T* Create(Params&&... xParams) {
+		void *Block;
+		if (TArena *Arena = TArena::Current())
+			Block = Arena->Alloc(sizeof(T), __alignof(T));
+		else if (TArena *Arena = __Bound())
+			Block = Arena->SyncAlloc(sizeof(T), __alignof(T));
+		else
+			FAIL(_T("No arena in scope or bound"));
+		// The block of a failed construction is reclaimed with the rest of the arena
+		return PlacementNew<T>(Block, std::forward<Params>(xParams)...);
+	}
+
+	inline static void Destroy(T *Obj) {
+		if (Obj != nullptr) Obj->~T();
+	}
+};
+
+#define FIXEDPOOL_GRANULARITY	16
+#define FIXEDPOOL_CLASSES		16
+#define FIXEDPOOL_BATCH			32
+#define FIXEDPOOL_CHUNK			(64 * BSize_aKB)
+
+/**
+ * @ingroup Utilities
+ * @brief Size-class segregated fixed-size block pool
+ *
+ * Serves small blocks (up to FIXEDPOOL_CLASSES x FIXEDPOOL_GRANULARITY bytes) from per-thread caches,
+ * which exchange batches of FIXEDPOOL_BATCH blocks with a global depot of the size class
+ * @note Memory is never returned to the heap; blocks cached by a thread are only returned to the depot
+ *       when the thread calls FlushThreadCache() (e.g. before it exits)
+ **/
+class TFixedPool {
+public:
+	inline static bool Fits(size_t Size, size_t Align)
+	{ return (Size <= FIXEDPOOL_GRANULARITY * FIXEDPOOL_CLASSES) && (Align <= FIXEDPOOL_GRANULARITY); }
+
+	inline static size_t SizeClass(size_t Size)
+	{ return Size ? (Size - 1) / FIXEDPOOL_GRANULARITY : 0; }
+
+	/**
+	 * Allocate a block of given size (must fit)
+	 **/
+	static void* Alloc(size_t Size);
+
+	/**
+	 * Free a block allocated with given size
+	 **/
+	static void Free(void *Block, size_t Size);
+
+	/**
+	 * Return all blocks cached by the calling thread to the global depots
+	 **/
+	static void FlushThreadCache(void);
+};
+
+/**
+ * @ingroup Utilities
+ * @brief Fixed-size pool object allocator template
+ *
+ * Creates small objects from TFixedPool, falls back to SimpleAllocator for large or over-aligned objects
+ * @note Objects must be destroyed as their exact type, since the block size is derived from T
+ **/
+template<typename T>
+struct FixedPoolAllocator : public IAllocator < T > {
+	template<typename... Params>
+	inline static T* Create(Params&&... xParams) {
+		if (!TFixedPool::Fits(sizeof(T), __alignof(T)))
+			return SimpleAllocator<T>::Create(std::forward<Params>(xParams)...);
+
+		void *Block = TFixedPool::Alloc(sizeof(T));
+		try {
+			return PlacementNew<T>(Block, std::forward<Params>(xParams)...);
+		} catch (...) {
+			TFixedPool::Free(Block, sizeof(T));
+			throw;
+		}
+	}
+
+	inline static void Destroy(T *Obj) {
+		if (!TFixedPool::Fits(sizeof(T), __alignof(T)))
+			return SimpleAllocator<T>::Destroy(Obj);
+
+		if (Obj != nullptr) {
+			Obj->~T();
+			TFixedPool::Free(Obj, sizeof(T));
+		}
+	}
+};
+
 #endif //Allocator_H
\ No newline at end of file
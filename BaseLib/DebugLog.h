@@ -41,12 +41,15 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @date Jul 29, 2013: Unicode compatibility, macro name disambiguation
  * @date Oct 20, 2013: Fixed relative source path printing for VC++ 2012/2013
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Builds on POSIX through the platform shim
  **/
 
 #ifndef DebugLog_H
 #define DebugLog_H
 
+#ifdef _WIN32
 #include <tchar.h>
+#endif
 #include <stdio.h>
 
 #include "Misc.h"
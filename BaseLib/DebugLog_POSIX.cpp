@@ -0,0 +1,119 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// [Utilities] Generic Debug Support (POSIX backend)
+
+#include "MMSwitcher.h"
+
+#include "DebugLog.h"
+
+#ifndef _WIN32
+
+#include <stdarg.h>
+#include <pthread.h>
+#include <vector>
+
+#include "Exception.h"
+
+#ifndef SOLUTION_PATH
+#define SOLUTION_PATH ""
+#endif //SOLUTION_PATH
+
+// Narrow and "wide" paths are the same type here
+LPCSTR __RelPath(LPCSTR Path) {
+	static size_t __RelPathLen = strlen(SOLUTION_PATH);
+	return Path + (strncmp(Path, SOLUTION_PATH, __RelPathLen) ? 0 : __RelPathLen);
+}
+
+LPCTSTR __PTID(void) {
+	static __thread TCHAR PTIDPrefix[12] = {NullWChar};
+
+	if (PTIDPrefix[0] == NullWChar)
+		_sntprintf_s(PTIDPrefix, 12, _TRUNCATE, _T("%5d:%-5d"), (int)GetCurrentProcessId(), (int)GetCurrentThreadId());
+	return PTIDPrefix;
+}
+
+LPCTSTR const& CONSOLELOG(void) {
+	static LPCTSTR const __IoFU = _T("Console");
+	return __IoFU;
+}
+
+typedef std::vector<std::pair<TString, FILE*>> TLogTargets;
+static TLogTargets& LogTargets(void) {
+	static TLogTargets __IoFU({{CONSOLELOG(), stderr}});
+	return __IoFU;
+}
+
+// The threading library is not available at this level, use a plain re-entrant mutex
+static pthread_mutex_t __LogLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void ERRORPRINTF(LPCTSTR Fmt, ...) {
+	pthread_mutex_lock(&__LogLock);
+	for (size_t i = 0; i < LogTargets().size(); i++) {
+		va_list params;
+		va_start(params, Fmt);
+		_vftprintf(LogTargets()[i].second, Fmt, params);
+		va_end(params);
+		fflush(LogTargets()[i].second);
+	}
+	pthread_mutex_unlock(&__LogLock);
+}
+
+void LOGTARGET(LPCTSTR Name, FILE *xTarget, LPCTSTR Message) {
+	pthread_mutex_lock(&__LogLock);
+	if (xTarget) {
+		if (setvbuf(xTarget, nullptr, _IOLBF, 4096) != 0) {
+			LOG(_T("WARNING: Unable to turn off file buffering for log target '%s'"), Name);
+		}
+
+		for (size_t i = 0; i < LogTargets().size(); i++) {
+			if (LogTargets()[i].first.compare(Name) == 0) {
+				LogTargets()[i].second = xTarget;
+				xTarget = nullptr;
+			}
+		}
+		if (xTarget != nullptr)
+			LogTargets().emplace_back(Name, xTarget);
+		if (Message)
+			LOG(_T("===== %s ====="), Message);
+	} else {
+		for (size_t i = 0; i < LogTargets().size(); i++) {
+			if (LogTargets()[i].first.compare(Name) == 0) {
+				LogTargets().erase(LogTargets().cbegin() + i);
+				if (Message)
+					LOG(_T("===== %s ====="), Message);
+			}
+		}
+	}
+	pthread_mutex_unlock(&__LogLock);
+}
+
+#endif //_WIN32
@@ -34,9 +34,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Exception.h"
 
-#include <tchar.h>
 #include "DebugLog.h"
+#ifdef _WIN32
+#include <tchar.h>
 #include "WinError.h"
+#endif
 
 LPCTSTR const Exception::ExceptSourceNone = _T("(unknown source)");
 LPCTSTR const Exception::ExceptReasonNone = _T("(unknown reason)");
@@ -63,9 +65,13 @@ LPCTSTR const SystemError::FSystemErrorMessage = _T("%s (Error %0.8X: %s)");
 
 LPCTSTR SystemError::ErrorMessage(void) const {
 	if (rErrorMsg.length() == 0) {
+#ifdef _WIN32
 		const_cast<TString*>(&rErrorMsg)->assign(__DefErrorMsgBufferLen, NullWChar);
 		DecodeError((TCHAR*)&rErrorMsg.front(), __DefErrorMsgBufferLen, ErrorCode);
 		const_cast<TString*>(&rErrorMsg)->resize(wcslen(&rErrorMsg.front()));
+#else
+		const_cast<TString*>(&rErrorMsg)->assign(strerror((int)ErrorCode));
+#endif
 	}
 	return rErrorMsg.c_str();
 }
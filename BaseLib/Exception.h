@@ -40,12 +40,17 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @date Jul 26, 2013: Porting to Visual C++ 2012
  * @date Jul 29, 2013: Unicode compatibility, interface cleanup
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Builds on POSIX through the platform shim
  **/
 
 #ifndef Exception_H
 #define Exception_H
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include "Platform_POSIX.h"
+#endif
 
 #include "DebugLog.h"
 
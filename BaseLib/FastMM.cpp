@@ -185,7 +185,7 @@ void __CRTDECL _fast_details(
 	GetMemoryManagerState(info);
 }
 
-#include "DEBUGLOG.h"
+#include "DebugLog.h"
 
 static LPCTSTR _FormatSize(UINT64 Size, LPTSTR Buffer, size_t BufLen) {
 	static const int UnitSizes[] = {1024, 1024, 1024, 1024};
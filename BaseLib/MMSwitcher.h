@@ -255,6 +255,7 @@ extern "C" {
 		if (_MM_AllocSize() > 0)
 			LOG(_T("! Leaked Memory: %.2fKB"), (double)_MM_AllocSize() / BSize_aKB);
 #ifndef STATMM_LT
+		_MM_SetSnapshotInterval(0);
 		_MM_DumpDetails();
 #else
 #endif//STATMM_LT
@@ -35,12 +35,17 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @author Zhenyu Wu
  * @date Sep 25, 2013: Uplift from a child project
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Builds on POSIX through the platform shim
  **/
 
 #ifndef Misc_H
 #define Misc_H
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include "Platform_POSIX.h"
+#endif
 
 #define VAWRAP(...) ,##__VA_ARGS__
 
@@ -97,6 +102,9 @@ char const* ACP_LOCALE(void);
 #define BSize_aGB		(BSize_aMB*DataSize_KiloUnit)
 #define BSize_aTB		((UINT64)BSize_aGB*DataSize_KiloUnit)
 
+// Cache line size, for separating frequently written shared data
+#define CACHE_LINE_SIZE	64
+
 union Flatten_FILETIME {
 	FILETIME FileTime;
 	ULONG64 U64;
@@ -131,7 +139,7 @@ union UINT128 {
 	UINT128(UINT32 A, UINT32 B, UINT32 C, UINT32 D) :
 		U32A(A), U32B(B), U32C(C), U32D(D) {}
 	size_t hashcode(void) const;
-	static enum class Format {
+	enum class Format {
 		HEX64, HEX32, HEX16, HEX8, INET6
 	};
 	TString toString(Format const &Fmt = Format::HEX64) const;
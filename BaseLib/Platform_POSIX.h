@@ -0,0 +1,190 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * @addtogroup Utilities Basic Supporting Utilities
+ * @file
+ * @brief Minimal Win32 Platform Shim (POSIX)
+ * @author Zhenyu Wu
+ * @date Oct 17, 2026: Initial implementation
+ *
+ * Provides the Win32 base types, TCHAR (narrow only), and the few CRT / kernel
+ * functions used by the portable parts of the library, so that they (and the
+ * POSIX backends) compile on Linux
+ * @note Only included on non-Windows platforms, in place of <Windows.h> and <tchar.h>
+ **/
+
+#ifndef Platform_POSIX_H
+#define Platform_POSIX_H
+
+#ifdef _WIN32
+#error "Use the Windows headers on Windows"
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Base types
+typedef int BOOL;
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef int8_t INT8;
+typedef uint8_t UINT8;
+typedef int16_t INT16;
+typedef uint16_t UINT16;
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef uint64_t ULONG64;
+typedef int INT;
+typedef unsigned int UINT;
+typedef intptr_t INT_PTR;
+typedef uintptr_t UINT_PTR;
+typedef intptr_t LONG_PTR;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T;
+typedef void VOID;
+typedef void *PVOID;
+typedef void *LPVOID;
+typedef void *HANDLE;
+typedef void *HMODULE;
+
+#define TRUE	1
+#define FALSE	0
+
+#define INFINITE	0xFFFFFFFF
+#define MAXINT		INT_MAX
+#define MININT		INT_MIN
+
+// Narrow characters only
+typedef char CHAR;
+typedef char TCHAR;
+typedef char *LPSTR;
+typedef char const *LPCSTR;
+typedef TCHAR *LPTSTR;
+typedef TCHAR const *LPCTSTR;
+
+#define _T(x)	x
+#define _TRUNCATE	((size_t)-1)
+
+#define _sntprintf_s(buf, size, count, fmt, ...)	snprintf(buf, size, fmt, ##__VA_ARGS__)
+#define _vftprintf	vfprintf
+#define _tcslen		strlen
+#define _tcsicmp	strcasecmp
+#define _strnicmp	strncasecmp
+
+#define __declspec(x)	__declspec_##x
+#define __declspec_thread	__thread
+
+struct FILETIME {
+	DWORD dwLowDateTime;
+	DWORD dwHighDateTime;
+};
+
+struct SYSTEMTIME {
+	WORD wYear;
+	WORD wMonth;
+	WORD wDayOfWeek;
+	WORD wDay;
+	WORD wHour;
+	WORD wMinute;
+	WORD wSecond;
+	WORD wMilliseconds;
+};
+
+inline void GetSystemTime(SYSTEMTIME *SystemTime) {
+	struct timespec CurTime;
+	struct tm UTCTime;
+	clock_gettime(CLOCK_REALTIME, &CurTime);
+	gmtime_r(&CurTime.tv_sec, &UTCTime);
+	SystemTime->wYear = (WORD)(UTCTime.tm_year + 1900);
+	SystemTime->wMonth = (WORD)(UTCTime.tm_mon + 1);
+	SystemTime->wDayOfWeek = (WORD)UTCTime.tm_wday;
+	SystemTime->wDay = (WORD)UTCTime.tm_mday;
+	SystemTime->wHour = (WORD)UTCTime.tm_hour;
+	SystemTime->wMinute = (WORD)UTCTime.tm_min;
+	SystemTime->wSecond = (WORD)UTCTime.tm_sec;
+	SystemTime->wMilliseconds = (WORD)(CurTime.tv_nsec / 1000000);
+}
+
+inline DWORD GetCurrentProcessId(void)
+{ return (DWORD)getpid(); }
+inline DWORD GetCurrentThreadId(void)
+{ return (DWORD)syscall(SYS_gettid); }
+
+// Interlocked operations (full barrier, as on Windows)
+inline LONG InterlockedIncrement(LONG volatile *Target)
+{ return __sync_add_and_fetch(Target, 1); }
+inline LONG InterlockedDecrement(LONG volatile *Target)
+{ return __sync_sub_and_fetch(Target, 1); }
+inline LONG InterlockedAdd(LONG volatile *Target, LONG Value)
+{ return __sync_add_and_fetch(Target, Value); }
+inline LONG InterlockedExchangeAdd(LONG volatile *Target, LONG Value)
+{ return __sync_fetch_and_add(Target, Value); }
+inline LONG InterlockedExchange(LONG volatile *Target, LONG Value)
+{ __sync_synchronize(); return __sync_lock_test_and_set(Target, Value); }
+inline LONG InterlockedCompareExchange(LONG volatile *Target, LONG Exchange, LONG Comparand)
+{ return __sync_val_compare_and_swap(Target, Comparand, Exchange); }
+
+inline LONGLONG InterlockedIncrement64(LONGLONG volatile *Target)
+{ return __sync_add_and_fetch(Target, 1); }
+inline LONGLONG InterlockedDecrement64(LONGLONG volatile *Target)
+{ return __sync_sub_and_fetch(Target, 1); }
+inline LONGLONG InterlockedAdd64(LONGLONG volatile *Target, LONGLONG Value)
+{ return __sync_add_and_fetch(Target, Value); }
+inline LONGLONG InterlockedExchangeAdd64(LONGLONG volatile *Target, LONGLONG Value)
+{ return __sync_fetch_and_add(Target, Value); }
+inline LONGLONG InterlockedExchange64(LONGLONG volatile *Target, LONGLONG Value)
+{ __sync_synchronize(); return __sync_lock_test_and_set(Target, Value); }
+inline LONGLONG InterlockedCompareExchange64(LONGLONG volatile *Target, LONGLONG Exchange, LONGLONG Comparand)
+{ return __sync_val_compare_and_swap(Target, Comparand, Exchange); }
+
+#define MemoryBarrier()		__sync_synchronize()
+#if defined(__i386__) || defined(__x86_64__)
+#define YieldProcessor()	__builtin_ia32_pause()
+#else
+#define YieldProcessor()	__asm__ __volatile__("" ::: "memory")
+#endif
+
+#endif //Platform_POSIX_H
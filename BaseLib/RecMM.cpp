@@ -64,169 +64,250 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #endif
 
-#include <vector>
-#include <allocators>
 #include <stdio.h>
 
 #include "BaseLib/DebugLog.h"
-#include "ThreadLib/SyncObjs.h"
+#include "BaseLib/RecMMTrace.h"
+#include "ThreadLib/Threading.h"
 
-static TLockableCS* StatLock = nullptr;
-
-using namespace std;
+// Each thread appends to its own buffer (in a slot), full buffers are handed to a background writer thread
+#define RECMM_BUFFER_ENTRIES	4096
+#define RECMM_MAX_THREADS		1024
+#define RECMM_WRITER_INTERVAL	1000
 
 struct __MemOp_Entry {
 	UINT64 _TS;
+	UINT64 _Seq : 63;
+	UINT64 _Resize : 1;
 	void* _Addr;
 	size_t _Size;
 };
 
-// TEMPLATE CLASS allocator
-template<class _Ty>
-class malloc_allocator
-	: public _Allocator_base < _Ty > {	// generic allocator for objects of class _Ty
-public:
-	typedef malloc_allocator<_Ty> other;
-
-	typedef _Allocator_base<_Ty> _Mybase;
-	typedef typename _Mybase::value_type value_type;
-
-	typedef value_type *pointer;
-	typedef const value_type *const_pointer;
-	typedef void *void_pointer;
-	typedef const void *const_void_pointer;
+struct __MemOp_Buffer {
+	SLIST_ENTRY Link;
+	DWORD ThreadID;
+	size_t Count;
+	__MemOp_Entry Entries[RECMM_BUFFER_ENTRIES];
+};
 
-	typedef value_type& reference;
-	typedef const value_type& const_reference;
+// Busy: 0 = idle, 1 = owner appending, 2 = claimed (finalized or being reclaimed)
+struct __MemOp_Slot {
+	LONG volatile Busy;
+	LONG volatile InUse;
+	HANDLE Owner;
+	__MemOp_Buffer* Buffer;
+	BYTE __Pad[CACHE_LINE_SIZE - 2 * sizeof(LONG) - sizeof(HANDLE) - sizeof(__MemOp_Buffer*)];
+};
 
-	typedef size_t size_type;
-	typedef ptrdiff_t difference_type;
+static __MemOp_Slot __MemOp_Slots[RECMM_MAX_THREADS];
+static LONG volatile __MemOp_SlotCount = 0;
+static __MemOp_Slot __MemOp_NoSlot = {2};
+static __declspec(thread) __MemOp_Slot* __MemOp_ThreadSlot = nullptr;
+static BOOL volatile __MemOp_Finalized = FALSE;
 
-	typedef false_type propagate_on_container_copy_assignment;
-	typedef false_type propagate_on_container_move_assignment;
-	typedef false_type propagate_on_container_swap;
+static SLIST_HEADER __Full_Buffers;
+static SLIST_HEADER __Free_Buffers;
 
-	malloc_allocator<_Ty> select_on_container_copy_construction() const
-	{	// return this allocator
-		return (*this);
-	}
+static HANDLE __Writer_Wake = NULL;
+static HANDLE volatile __Writer_Thread = NULL;
+static LONG volatile __Writer_Started = 0;
+static BOOL volatile __Writer_Stopping = FALSE;
 
-	template<class _Other>
-	struct rebind {	// convert this type to allocator<_Other>
-		typedef malloc_allocator<_Other> other;
-	};
+static FILE* __LogFile = nullptr;
+static bool __LogDiscard = false;
+static const LPCTSTR __LogFileName = _T("MemOps.log");
 
-	pointer address(reference _Val) const _NOEXCEPT
-	{	// return address of mutable _Val
-		return (_STD addressof(_Val));
+// Encoding scratch space and chunk index, only accessed by the writer (or during finalization)
+static BYTE __LogChunk[RECMM_BUFFER_ENTRIES * 4 * RECMM_VARINT_MAX];
+static TRecMMChunkIndex* __LogIndex = nullptr;
+static size_t __LogIndexCount = 0;
+static size_t __LogIndexCapacity = 0;
+
+static void IndexLog(TRecMMChunkIndex const &Index) {
+	if (__LogIndexCount == __LogIndexCapacity) {
+		size_t Capacity = __LogIndexCapacity ? __LogIndexCapacity * 2 : 256;
+		void *NewIndex = _realloc_rec_l(__LogIndex, Capacity * sizeof(TRecMMChunkIndex));
+		if (NewIndex == nullptr) {
+			// Without a complete index, the reader falls back to scanning the chunks
+			LOG(_T("WARNING: Unable to grow memory operation log index"));
+			_free_rec_l(__LogIndex);
+			__LogIndex = nullptr;
+			__LogIndexCapacity = (size_t)-1;
+			return;
+		}
+		__LogIndex = (TRecMMChunkIndex*)NewIndex;
+		__LogIndexCapacity = Capacity;
 	}
+	if (__LogIndex != nullptr) __LogIndex[__LogIndexCount++] = Index;
+}
 
-		const_pointer address(const_reference _Val) const _NOEXCEPT
-	{	// return address of nonmutable _Val
-		return (_STD addressof(_Val));
+static void WriteLog(__MemOp_Buffer const *Buffer) {
+	if (__LogDiscard) return;
+	if (__LogFile == nullptr) {
+		// Open log file
+		LOGVV(_T("* Opening memory operation log file..."));
+		errno_t ErrCode = _tfopen_s(&__LogFile, __LogFileName, _T("w+b"));
+		if (ErrCode != 0) {
+			LOG(_T("WARNING: Unable to open memory operation log file (%d)"), ErrCode);
+			__LogDiscard = true;
+			return;
+		}
+		TRecMMTraceHeader const Header = {RECMM_TRACE_MAGIC, RECMM_TRACE_VERSION, sizeof(void*), 0};
+		fwrite(&Header, sizeof(Header), 1, __LogFile);
 	}
+	if (Buffer->Count == 0) return;
+
+	LOGVV(_T("* Flushing %u memory operation log entries..."), Buffer->Count);
+	__MemOp_Entry const *Entries = Buffer->Entries;
+	TRecMMChunkHeader ChunkHeader = {RECMM_CHUNK_MAGIC, Buffer->ThreadID, (UINT32)Buffer->Count, 0,
+		Entries[0]._TS, (UINT64)(size_t)Entries[0]._Addr, Entries[0]._Seq};
+	TRecMMChunkEncoder Encoder(ChunkHeader.BaseTS, ChunkHeader.BaseAddr, ChunkHeader.BaseSeq);
+	BYTE *Cursor = __LogChunk;
+	for (size_t Idx = 0; Idx < Buffer->Count; Idx++)
+		Cursor = Encoder.Put(Cursor, Entries[Idx]._TS, Entries[Idx]._Seq, (UINT64)(size_t)Entries[Idx]._Addr,
+							 Entries[Idx]._Size, Entries[Idx]._Resize != 0);
+	ChunkHeader.Length = (UINT32)(Cursor - __LogChunk);
+
+	TRecMMChunkIndex const Index = {(UINT64)_ftelli64(__LogFile), Entries[0]._TS, Entries[Buffer->Count - 1]._TS,
+		Buffer->ThreadID, (UINT32)Buffer->Count, Entries[0]._Seq};
+	fwrite(&ChunkHeader, sizeof(ChunkHeader), 1, __LogFile);
+	fwrite(__LogChunk, 1, ChunkHeader.Length, __LogFile);
+	IndexLog(Index);
+}
 
-		malloc_allocator() _THROW0()
-	{	// construct default allocator (do nothing)
+// Append the chunk index and trailer, allowing readers to seek without scanning
+static void FinishLog(void) {
+	if (__LogIndex != nullptr) {
+		TRecMMTraceTrailer const Trailer = {(UINT64)_ftelli64(__LogFile), (UINT32)__LogIndexCount, RECMM_INDEX_MAGIC};
+		fwrite(__LogIndex, sizeof(TRecMMChunkIndex), __LogIndexCount, __LogFile);
+		fwrite(&Trailer, sizeof(Trailer), 1, __LogFile);
+		_free_rec_l(__LogIndex);
+		__LogIndex = nullptr;
 	}
+}
 
-	malloc_allocator(const malloc_allocator<_Ty>&) _THROW0()
-	{	// construct by copying (do nothing)
+// Write out all handed off buffers (in hand-off order, so entries of each thread stay ordered)
+static void DrainLog(void) {
+	PSLIST_ENTRY List = InterlockedFlushSList(&__Full_Buffers);
+	PSLIST_ENTRY Ordered = nullptr;
+	while (List != nullptr) {
+		PSLIST_ENTRY Next = List->Next;
+		List->Next = Ordered;
+		Ordered = List;
+		List = Next;
 	}
-
-	template<class _Other>
-	malloc_allocator(const malloc_allocator<_Other>&) _THROW0()
-	{	// construct from a related allocator (do nothing)
+	while (Ordered != nullptr) {
+		__MemOp_Buffer *Buffer = CONTAINING_RECORD(Ordered, __MemOp_Buffer, Link);
+		Ordered = Ordered->Next;
+		WriteLog(Buffer);
+		Buffer->Count = 0;
+		InterlockedPushEntrySList(&__Free_Buffers, &Buffer->Link);
 	}
+}
 
-	template<class _Other>
-	malloc_allocator<_Ty>& operator=(const malloc_allocator<_Other>&)
-	{	// assign from a related allocator (do nothing)
-		return (*this);
-	}
+static void HandoffLog(__MemOp_Buffer *Buffer) {
+	InterlockedPushEntrySList(&__Full_Buffers, &Buffer->Link);
+	if (__Writer_Thread != NULL) SetEvent(__Writer_Wake);
+}
 
-	void deallocate(pointer _Ptr, size_type)
-	{	// deallocate object at _Ptr, ignore size
-		_free_rec_l(_Ptr);
+// Flush buffers of exited threads, and release their slots for reuse
+static void ReclaimSlots(void) {
+	LONG SlotCount = min(__MemOp_SlotCount, RECMM_MAX_THREADS);
+	for (LONG Idx = 0; Idx < SlotCount; Idx++) {
+		__MemOp_Slot &Slot = __MemOp_Slots[Idx];
+		if ((Slot.InUse == 0) || (Slot.Owner == NULL)) continue;
+		if (WaitForSingleObject(Slot.Owner, 0) != WAIT_OBJECT_0) continue;
+		if (InterlockedCompareExchange(&Slot.Busy, 2, 0) != 0) continue;
+
+		if (Slot.Buffer != nullptr) {
+			HandoffLog(Slot.Buffer);
+			Slot.Buffer = nullptr;
+		}
+		CloseHandle(Slot.Owner);
+		Slot.Owner = NULL;
+		Slot.Busy = 0;
+		InterlockedExchange(&Slot.InUse, 0);
 	}
+}
 
-	pointer allocate(size_type _Count)
-	{	// allocate array of _Count elements
-		if (void*_ret = _malloc_rec_l(sizeof(value_type)* _Count))
-			return (pointer)_ret;
-		if (_Count) throw bad_alloc();
-		return nullptr;
+static DWORD WINAPI WriterThread(LPVOID) {
+	while (!__Writer_Stopping) {
+		WaitForSingleObject(__Writer_Wake, RECMM_WRITER_INTERVAL);
+		DrainLog();
+		if (!__Writer_Stopping) ReclaimSlots();
 	}
+	DrainLog();
+	return 0;
+}
 
-	pointer allocate(size_type _Count, const void *)
-	{	// allocate array of _Count elements, ignore hint
-		return (allocate(_Count));
-	}
+static __MemOp_Slot* AcquireSlot(void) {
+	if (__MemOp_Finalized) return &__MemOp_NoSlot;
 
-	void construct(_Ty *_Ptr)
-	{	// default construct object at _Ptr
-		::new ((void *)_Ptr) _Ty();
-	}
-
-	void construct(_Ty *_Ptr, const _Ty& _Val)
-	{	// construct object at _Ptr with value _Val
-		::new ((void *)_Ptr) _Ty(_Val);
+	__MemOp_Slot *Ret = nullptr;
+	LONG SlotCount = min(__MemOp_SlotCount, RECMM_MAX_THREADS);
+	for (LONG Idx = 0; Idx < SlotCount; Idx++) {
+		if ((__MemOp_Slots[Idx].InUse == 0) && (InterlockedCompareExchange(&__MemOp_Slots[Idx].InUse, 1, 0) == 0)) {
+			Ret = &__MemOp_Slots[Idx];
+			break;
+		}
 	}
-
-	template<class _Objty,
-	class... _Types>
-		void construct(_Objty *_Ptr, _Types&&... _Args)
-	{	// construct _Objty(_Types...) at _Ptr
-		::new ((void *)_Ptr) _Objty(_STD forward<_Types>(_Args)...);
+	if (Ret == nullptr) {
+		LONG Idx = InterlockedIncrement(&__MemOp_SlotCount) - 1;
+		if (Idx >= RECMM_MAX_THREADS) return &__MemOp_NoSlot;
+		Ret = &__MemOp_Slots[Idx];
+		Ret->InUse = 1;
 	}
+	Ret->Owner = OpenThread(SYNCHRONIZE, FALSE, GetCurrentThreadId());
+	return Ret;
+}
 
+static __MemOp_Buffer* AcquireBuffer(void) {
+	if (PSLIST_ENTRY Entry = InterlockedPopEntrySList(&__Free_Buffers))
+		return CONTAINING_RECORD(Entry, __MemOp_Buffer, Link);
+	__MemOp_Buffer *Ret = (__MemOp_Buffer*)_malloc_rec_l(sizeof(__MemOp_Buffer));
+	if (Ret != nullptr) Ret->Count = 0;
+	return Ret;
+}
 
-	template<class _Uty>
-	void destroy(_Uty *_Ptr)
-	{	// destroy object at _Ptr
-		_Ptr->~_Uty();
-	}
-
-	size_t max_size() const _THROW0()
-	{	// estimate maximum array size
-		return ((size_t)(-1) / sizeof(_Ty));
+// Writer state: 0 = not started, 1 = starting, 2 = started (or will never start)
+static void StartWriter(void) {
+	if (InterlockedCompareExchange(&__Writer_Started, 1, 0) == 0) {
+		// NOTE: Thread creation may allocate, those operations are not recorded (slot is busy)
+		__Writer_Thread = CreateThread(nullptr, 0, &WriterThread, nullptr, 0, nullptr);
+		InterlockedExchange(&__Writer_Started, 2);
+		if (__Writer_Thread != NULL) SetEvent(__Writer_Wake);
 	}
-};
-
-#define TMemOp_Log vector<__MemOp_Entry, malloc_allocator<__MemOp_Entry>>
-static TMemOp_Log* __MemOp_Log = nullptr;
-static FILE* __LogFile = nullptr;
-static const DWORD __LogFlushCnt = 1024 * 1024;
-static const LPCTSTR __LogFileName = _T("MemOps.log");
+}
 
-void InsertLog(void* Addr, size_t Size) {
-	Flatten_FILETIME CurTS;
-	GetSystemTimeAsFileTime(&CurTS.FileTime);
-	__MemOp_Log->push_back({CurTS.U64, Addr, Size});
+// Operation stamp, read from the monotonic high resolution clock (nanoseconds)
+// Unlike a shared counter, taking a stamp writes no memory shared between threads
+inline static UINT64 NextSeq(void) {
+	return TDeadline::Now();
 }
 
-void CheckFlushLog(DWORD Threshold) {
-	if (__MemOp_Log->size() > Threshold) {
-		if (__LogFile == nullptr) {
-			// Open log file
-			LOGVV(_T("* Opening memory operation log file..."));
-			errno_t ErrCode = _tfopen_s(&__LogFile, __LogFileName, _T("w+b"));
-			if (ErrCode != 0)
-				FAIL(_T("WARNING: Unable to open memory operation log file (%d)"), ErrCode);
-			// Identify platform address size
-			unsigned char const PtrWidth = sizeof(void*);
-			fwrite(&PtrWidth, sizeof(unsigned char), 1, __LogFile);
-#ifdef _WIN64
-			size_t const ByteOrder = 0x1020304050607080L;
-#else
-			size_t const ByteOrder = 0x10203040L;
-#endif
-			fwrite(&ByteOrder, sizeof(size_t), 1, __LogFile);
-		}
-		LOGVV(_T("* Flushing %u memory operation log entries..."), __MemOp_Log->size());
-		fwrite(__MemOp_Log->data(), sizeof(__MemOp_Entry), __MemOp_Log->size(), __LogFile);
-		__MemOp_Log->clear();
+// NOTE: Deallocations are stamped before, and allocations after the operation,
+// so that stamps of a freed and reused address are ordered
+void InsertLog(void* Addr, size_t Size, bool Resize = false, UINT64 Seq = 0) {
+	if (Seq == 0) Seq = NextSeq();
+	__MemOp_Slot *Slot = __MemOp_ThreadSlot;
+	if (Slot == nullptr) Slot = __MemOp_ThreadSlot = AcquireSlot();
+	// Skip if finalized, or re-entered from within recording
+	if (InterlockedCompareExchange(&Slot->Busy, 1, 0) != 0) return;
+
+	__MemOp_Buffer *Buffer = Slot->Buffer;
+	if ((Buffer == nullptr) && ((Buffer = Slot->Buffer = AcquireBuffer()) == nullptr)) {
+		Slot->Busy = 0;
+		return;
 	}
+	if (Buffer->Count == 0) Buffer->ThreadID = GetCurrentThreadId();
+	// Timestamps are kept in 100ns units, derived from the same stamp
+	Buffer->Entries[Buffer->Count++] = {Seq / 100, Seq, Resize ? 1U : 0U, Addr, Size};
+	if (Buffer->Count == RECMM_BUFFER_ENTRIES) {
+		Slot->Buffer = nullptr;
+		HandoffLog(Buffer);
+		StartWriter();
+	}
+	Slot->Busy = 0;
 }
 
 _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_Size) void *__CRTDECL _malloc_rec(
@@ -234,7 +315,6 @@ _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_Size) void *__CRTDECL
 	) {
 	if (void *_ret = _malloc_rec_l(_Size)) {
 		size_t _size = _msize_rec_l(_ret);
-		auto Lock = StatLock->SyncLock();
 		InsertLog(_ret, _Size);
 		return _ret;
 	}
@@ -247,7 +327,6 @@ _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_Count*_Size) void *__C
 	) {
 	if (void *_ret = _calloc_rec_l(_Count, _Size)) {
 		size_t _size = _msize_rec_l(_ret);
-		auto Lock = StatLock->SyncLock();
 		InsertLog(_ret, _Size);
 		return _ret;
 	}
@@ -259,16 +338,17 @@ _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_NewSize) void *__CRTDE
 _Pre_maybenull_ _Post_invalid_ void * _Memory,
 _In_ size_t _NewSize
 ) {
+	// The old block may be freed (and reused) within the operation
+	UINT64 _Seq = NextSeq();
 	if (void *_ret = _realloc_rec_l(_Memory, _NewSize)) {
 		size_t _size = _ret ? _msize_rec_l(_ret) : 0;
-		auto Lock = StatLock->SyncLock();
 		bool Wild = false;
 		if (_Memory != _ret) {
 			if (_Memory)
-				InsertLog(_Memory, 0);;
+				InsertLog(_Memory, 0, false, _Seq);
 			InsertLog(_ret, _NewSize);
 		} else {
-			InsertLog(_Memory, _NewSize);
+			InsertLog(_Memory, _NewSize, true);
 		}
 		return _ret;
 	}
@@ -281,16 +361,17 @@ _Pre_maybenull_ _Post_invalid_ void * _Memory,
 _In_ size_t _NumOfElements,
 _In_ size_t _SizeOfElements
 ) {
+	// The old block may be freed (and reused) within the operation
+	UINT64 _Seq = NextSeq();
 	if (void *_ret = _recalloc_rec_l(_Memory, _NumOfElements, _SizeOfElements)) {
 		size_t _size = _ret ? _msize_rec_l(_ret) : 0;
-		auto Lock = StatLock->SyncLock();
 		bool Wild = false;
 		if (_Memory != _ret) {
 			if (_Memory)
-				InsertLog(_Memory, 0);;
+				InsertLog(_Memory, 0, false, _Seq);
 			InsertLog(_ret, _NumOfElements*_SizeOfElements);
 		} else {
-			InsertLog(_Memory, _NumOfElements*_SizeOfElements);
+			InsertLog(_Memory, _NumOfElements*_SizeOfElements, true);
 		}
 		return _ret;
 	}
@@ -303,9 +384,8 @@ _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_NewSize) void *__CRTDE
 	) {
 	if (void *_ret = _expand_rec_l(_Memory, _NewSize)) {
 		size_t _size = _msize_rec_l(_ret);
-		auto Lock = StatLock->SyncLock();
 		DEBUGV(if (_Memory != _ret) FAIL(_T("Expansion changes allocation record")));
-		InsertLog(_Memory, _NewSize);
+		InsertLog(_Memory, _NewSize, true);
 		return _ret;
 	}
 	return nullptr;
@@ -315,11 +395,8 @@ void __CRTDECL _free_rec(
 	_Pre_maybenull_ _Post_invalid_ void * _Memory
 	) {
 	if (_Memory) {
-		auto Lock = StatLock->SyncLock();
-		InsertLog(_Memory, 0);;
+		InsertLog(_Memory, 0);
 		_free_rec_l(_Memory);
-		// Performance: Only check for log flush when freeing
-		CheckFlushLog(__LogFlushCnt);
 	}
 }
 
@@ -515,16 +592,42 @@ extern "C++" {
 }
 
 void __MM_INIT(void) {
-	// These resources are never deallocated
-	StatLock = new (_malloc_rec_l(sizeof TLockableCS)) TLockableCS();
-	__MemOp_Log = new (_malloc_rec_l(sizeof TMemOp_Log)) TMemOp_Log();
+	InitializeSListHead(&__Full_Buffers);
+	InitializeSListHead(&__Free_Buffers);
+	__Writer_Wake = CreateEvent(NULL, FALSE, FALSE, NULL);
 	// Note: we cannot open log file here because CRT has not initialized!
 }
 
 void __MM_FINIT(void) {
-	CheckFlushLog(0);
+	// Stop the writer first (it stops reclaiming slots), preventing a late start
+	__MemOp_Finalized = TRUE;
+	if (InterlockedCompareExchange(&__Writer_Started, 2, 0) != 0) {
+		while (__Writer_Started != 2)
+			SwitchToThread();
+		if (__Writer_Thread != NULL) {
+			__Writer_Stopping = TRUE;
+			SetEvent(__Writer_Wake);
+			WaitForSingleObject(__Writer_Thread, INFINITE);
+			CloseHandle(__Writer_Thread);
+		}
+	}
+
+	// Stop recording, and collect partially filled buffers
+	LONG SlotCount = min(__MemOp_SlotCount, RECMM_MAX_THREADS);
+	for (LONG Idx = 0; Idx < SlotCount; Idx++) {
+		__MemOp_Slot &Slot = __MemOp_Slots[Idx];
+		while (InterlockedCompareExchange(&Slot.Busy, 2, 0) != 0)
+			SwitchToThread();
+		if (Slot.Buffer != nullptr) {
+			HandoffLog(Slot.Buffer);
+			Slot.Buffer = nullptr;
+		}
+	}
+
+	DrainLog();
 	if (__LogFile != nullptr) {
 		LOGVV(_T("* Closing memory operation log file..."));
+		FinishLog();
 		fclose(__LogFile);
 	}
 }
@@ -35,6 +35,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @author Zhenyu Wu
  * @date Jul 14, 2014: Initial implementation
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Per-thread recording buffers with background writer
+ * @date Oct 17, 2026: Global operation sequence numbers
+ * @date Oct 17, 2026: Monotonic clock stamps in place of the global sequence counter
  **/
 
 #ifndef RecMM_H
@@ -0,0 +1,444 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// [Utilities] Memory Operation Trace Analysis and Replay
+
+#include "MMSwitcher.h"
+
+#include "RecMMAnalyzer.h"
+#include "DebugLog.h"
+#include "Exception.h"
+#include "WinError.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+
+static size_t __Log2Bucket(UINT64 Value) {
+	size_t Ret = 0;
+	while ((Value >>= 1) != 0) Ret++;
+	return Ret;
+}
+
+static size_t __PrivateBytes(void) {
+	PROCESS_MEMORY_COUNTERS_EX Counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), (PPROCESS_MEMORY_COUNTERS)&Counters, sizeof(Counters)))
+		return 0;
+	return Counters.PrivateUsage;
+}
+
+static LPCTSTR __FormatTicks(UINT64 Ticks, LPTSTR Buffer, size_t BufLen) {
+	if (Ticks < 10) {
+		_stprintf_s(Buffer, BufLen, _T("%lluns"), Ticks * 100);
+	} else if (Ticks < 10000) {
+		_stprintf_s(Buffer, BufLen, _T("%.1fus"), (double)Ticks / 10);
+	} else if (Ticks < 10000000) {
+		_stprintf_s(Buffer, BufLen, _T("%.1fms"), (double)Ticks / 10000);
+	} else {
+		_stprintf_s(Buffer, BufLen, _T("%.1fs"), (double)Ticks / 10000000);
+	}
+	return Buffer;
+}
+
+//---------------------------------
+// Replay backends
+
+void* TRecMMReplayCRT::Alloc(size_t Size) {
+	return malloc(Size);
+}
+
+void* TRecMMReplayCRT::Resize(void *Block, size_t OldSize, size_t NewSize) {
+	return realloc(Block, NewSize);
+}
+
+void TRecMMReplayCRT::Free(void *Block, size_t Size) {
+	free(Block);
+}
+
+TRecMMReplayHeap::TRecMMReplayHeap(void) : Heap(HeapCreate(0, 0, 0)) {
+	if (Heap == NULL)
+		SYSFAIL(_T("Failed to create replay heap"));
+}
+
+TRecMMReplayHeap::~TRecMMReplayHeap(void) {
+	HeapDestroy(Heap);
+}
+
+void* TRecMMReplayHeap::Alloc(size_t Size) {
+	return HeapAlloc(Heap, 0, Size);
+}
+
+void* TRecMMReplayHeap::Resize(void *Block, size_t OldSize, size_t NewSize) {
+	return HeapReAlloc(Heap, 0, Block, NewSize);
+}
+
+void TRecMMReplayHeap::Free(void *Block, size_t Size) {
+	HeapFree(Heap, 0, Block);
+}
+
+#ifdef NEDMM
+
+void* TRecMMReplayNed::Alloc(size_t Size) {
+	return _malloc_ned(Size);
+}
+
+void* TRecMMReplayNed::Resize(void *Block, size_t OldSize, size_t NewSize) {
+	return _realloc_ned(Block, NewSize);
+}
+
+void TRecMMReplayNed::Free(void *Block, size_t Size) {
+	_free_ned(Block);
+}
+
+#endif
+
+#ifdef FASTMM
+
+void* TRecMMReplayFast::Alloc(size_t Size) {
+	return _malloc_fast(Size);
+}
+
+void* TRecMMReplayFast::Resize(void *Block, size_t OldSize, size_t NewSize) {
+	return _realloc_fast(Block, NewSize);
+}
+
+void TRecMMReplayFast::Free(void *Block, size_t Size) {
+	_free_fast(Block);
+}
+
+#endif
+
+TRecMMReplayFixedPool::~TRecMMReplayFixedPool(void) {
+	TFixedPool::FlushThreadCache();
+}
+
+void* TRecMMReplayFixedPool::Alloc(size_t Size) {
+	if (TFixedPool::Fits(Size, FIXEDPOOL_GRANULARITY))
+		return TFixedPool::Alloc(Size);
+	return malloc(Size);
+}
+
+void* TRecMMReplayFixedPool::Resize(void *Block, size_t OldSize, size_t NewSize) {
+	bool OldFits = TFixedPool::Fits(OldSize, FIXEDPOOL_GRANULARITY);
+	bool NewFits = TFixedPool::Fits(NewSize, FIXEDPOOL_GRANULARITY);
+	if (OldFits && NewFits && (TFixedPool::SizeClass(OldSize) == TFixedPool::SizeClass(NewSize)))
+		return Block;
+	if (!OldFits && !NewFits)
+		return realloc(Block, NewSize);
+
+	void *Ret = Alloc(NewSize);
+	if (Ret != nullptr) {
+		memcpy(Ret, Block, min(OldSize, NewSize));
+		Free(Block, OldSize);
+	}
+	return Ret;
+}
+
+void TRecMMReplayFixedPool::Free(void *Block, size_t Size) {
+	if (TFixedPool::Fits(Size, FIXEDPOOL_GRANULARITY)) {
+		TFixedPool::Free(Block, Size);
+	} else {
+		free(Block);
+	}
+}
+
+void* TRecMMReplayArena::Alloc(size_t Size) {
+	return Arena.Alloc(Size, MEMORY_ALLOCATION_ALIGNMENT);
+}
+
+void* TRecMMReplayArena::Resize(void *Block, size_t OldSize, size_t NewSize) {
+	if (NewSize <= OldSize) return Block;
+	void *Ret = Arena.Alloc(NewSize, MEMORY_ALLOCATION_ALIGNMENT);
+	memcpy(Ret, Block, OldSize);
+	return Ret;
+}
+
+void TRecMMReplayArena::Free(void *Block, size_t Size) {
+	// Reclaimed when the arena is destroyed
+}
+
+//---------------------------------
+// Replay plan
+
+TRecMMReplayPlan::TResult TRecMMReplayPlan::Replay(IRecMMReplayBackend &Backend) const {
+	std::vector<void*> Blocks(SlotCount, nullptr);
+	std::vector<size_t> Sizes(SlotCount, 0);
+	TResult Ret = {Steps.size(), 0, 0};
+
+	size_t const Baseline = __PrivateBytes();
+	LARGE_INTEGER Frequency, Start, Finish;
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Start);
+	for (size_t Idx = 0; Idx < Steps.size(); Idx++) {
+		TStep const &Step = Steps[Idx];
+		void *&Block = Blocks[Step.Slot];
+		switch (Step.Kind) {
+			case StepKind::Alloc:
+				Block = Backend.Alloc(Step.Size);
+				Sizes[Step.Slot] = Step.Size;
+				break;
+			case StepKind::Resize:
+				if (Block == nullptr) {
+					Block = Backend.Alloc(Step.Size);
+				} else if (void *NewBlock = Backend.Resize(Block, Sizes[Step.Slot], Step.Size)) {
+					Block = NewBlock;
+				} else break;
+				Sizes[Step.Slot] = Step.Size;
+				break;
+			case StepKind::Free:
+				if (Block != nullptr) Backend.Free(Block, Sizes[Step.Slot]);
+				Block = nullptr;
+				break;
+		}
+		if ((Idx % RECMM_REPLAY_SAMPLE) == 0) {
+			size_t Footprint = __PrivateBytes();
+			if (Footprint > Baseline) Ret.PeakFootprint = max(Ret.PeakFootprint, Footprint - Baseline);
+		}
+	}
+	QueryPerformanceCounter(&Finish);
+	Ret.Seconds = (double)(Finish.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+	size_t Footprint = __PrivateBytes();
+	if (Footprint > Baseline) Ret.PeakFootprint = max(Ret.PeakFootprint, Footprint - Baseline);
+
+	// Release blocks still live at the end of trace
+	for (UINT32 Slot = 0; Slot < SlotCount; Slot++)
+		if (Blocks[Slot] != nullptr) Backend.Free(Blocks[Slot], Sizes[Slot]);
+	return Ret;
+}
+
+//---------------------------------
+// Analyzer
+
+struct __Trace_Cursor {
+	std::vector<TRecMMTrace::TOperation> Ops;
+	size_t Pos;
+};
+
+// Whether operation A comes after B: by sequence stamp if recorded, otherwise by time,
+// with deallocations first (a freed address may be reused on another thread within the same tick)
+static bool __Trace_After(TRecMMTrace::TOperation const &A, TRecMMTrace::TOperation const &B) {
+	if (A.Seq && B.Seq && (A.Seq != B.Seq)) return A.Seq > B.Seq;
+	if (A.TS != B.TS) return A.TS > B.TS;
+	if ((A.Size == 0) != (B.Size == 0)) return B.Size == 0;
+	return A.ThreadID > B.ThreadID;
+}
+
+struct __Trace_CursorOrder {
+	bool operator()(__Trace_Cursor const *A, __Trace_Cursor const *B) const
+	{ return __Trace_After(A->Ops[A->Pos], B->Ops[B->Pos]); }
+};
+
+void TRecMMAnalyzer::__Merge(std::function<void(TRecMMTrace::TOperation const &)> const &Visit) {
+	// Chunks are per-thread and overlap in time, merge them by loading each only when reached
+	bool const BySeq = Trace.Version >= 3;
+	auto ChunkStart = [&](size_t Idx) {
+		return BySeq ? Trace.ChunkInfo(Idx).FirstSeq : Trace.ChunkInfo(Idx).FirstTS;
+	};
+	auto OpKey = [&](TRecMMTrace::TOperation const &Op) {
+		return BySeq ? Op.Seq : Op.TS;
+	};
+	std::vector<size_t> Order(Trace.ChunkCount());
+	for (size_t Idx = 0; Idx < Order.size(); Idx++) Order[Idx] = Idx;
+	std::stable_sort(Order.begin(), Order.end(), [&](size_t A, size_t B) {
+		return ChunkStart(A) < ChunkStart(B);
+	});
+
+	std::priority_queue<__Trace_Cursor*, std::vector<__Trace_Cursor*>, __Trace_CursorOrder> Active;
+	std::vector<__Trace_Cursor*> Spare;
+	size_t Next = 0;
+	try {
+		while (true) {
+			while ((Next < Order.size()) &&
+				(Active.empty() || (ChunkStart(Order[Next]) <= OpKey(Active.top()->Ops[Active.top()->Pos])))) {
+				__Trace_Cursor *Cursor = Spare.empty() ? new __Trace_Cursor : Spare.back();
+				if (!Spare.empty()) Spare.pop_back();
+				Trace.ReadChunk(Order[Next++], Cursor->Ops);
+				Cursor->Pos = 0;
+				Active.push(Cursor);
+			}
+			if (Active.empty()) break;
+
+			__Trace_Cursor *Cursor = Active.top();
+			Active.pop();
+			Visit(Cursor->Ops[Cursor->Pos]);
+			if (++Cursor->Pos < Cursor->Ops.size()) {
+				Active.push(Cursor);
+			} else {
+				Spare.push_back(Cursor);
+			}
+		}
+	} catch (...) {
+		while (!Active.empty()) {
+			Spare.push_back(Active.top());
+			Active.pop();
+		}
+		for (auto Cursor : Spare) delete Cursor;
+		throw;
+	}
+	for (auto Cursor : Spare) delete Cursor;
+}
+
+struct __Live_Block {
+	size_t Size;
+	UINT64 TS;
+	UINT32 Slot;
+};
+
+void TRecMMAnalyzer::Analyze(TRecMMReplayPlan *Plan) {
+	ZeroMemory(&Stats, sizeof(Stats));
+	std::unordered_map<UINT64, __Live_Block> Live;
+	std::unordered_map<UINT64, size_t> Pages;
+	std::vector<UINT32> FreeSlots;
+	UINT32 SlotCount = 0;
+	if (Plan != nullptr) Plan->Steps.clear();
+
+	auto Occupy = [&](UINT64 Addr, size_t Size) {
+		UINT64 End = Addr + Size;
+		for (UINT64 Page = Addr / RECMM_ANALYZER_PAGE; Page * RECMM_ANALYZER_PAGE < End; Page++) {
+			size_t Bytes = (size_t)(min(End, (Page + 1) * RECMM_ANALYZER_PAGE) - max(Addr, Page * RECMM_ANALYZER_PAGE));
+			if ((Pages[Page] += Bytes) == Bytes) Stats.LivePages++;
+		}
+	};
+	auto Vacate = [&](UINT64 Addr, size_t Size) {
+		UINT64 End = Addr + Size;
+		for (UINT64 Page = Addr / RECMM_ANALYZER_PAGE; Page * RECMM_ANALYZER_PAGE < End; Page++) {
+			size_t Bytes = (size_t)(min(End, (Page + 1) * RECMM_ANALYZER_PAGE) - max(Addr, Page * RECMM_ANALYZER_PAGE));
+			auto Entry = Pages.find(Page);
+			if ((Entry->second -= Bytes) == 0) {
+				Pages.erase(Entry);
+				Stats.LivePages--;
+			}
+		}
+	};
+
+	bool const MarksResize = Trace.Version >= 3;
+	bool First = true;
+	__Merge([&](TRecMMTrace::TOperation const &Op) {
+		// Time stamps are coarser than the sequence, and may step back slightly
+		if (First) {
+			Stats.FirstTS = Stats.LastTS = Op.TS;
+			First = false;
+		} else {
+			Stats.FirstTS = min(Stats.FirstTS, Op.TS);
+			Stats.LastTS = max(Stats.LastTS, Op.TS);
+		}
+		auto Entry = Live.find(Op.Addr);
+
+		if (Op.Size == 0) {
+			if (Entry == Live.end()) {
+				Stats.WildFrees++;
+				return;
+			}
+			__Live_Block const &Block = Entry->second;
+			Stats.Frees++;
+			Stats.LifetimeHistogram[__Log2Bucket(Op.TS > Block.TS ? Op.TS - Block.TS : 0)]++;
+			Vacate(Op.Addr, Block.Size);
+			Stats.LiveBytes -= Block.Size;
+			Stats.LiveCount--;
+			FreeSlots.push_back(Block.Slot);
+			if (Plan != nullptr) Plan->Steps.push_back({Block.Slot, TRecMMReplayPlan::StepKind::Free, Block.Size});
+			Live.erase(Entry);
+			return;
+		}
+
+		if (Entry != Live.end()) {
+			if (MarksResize && !Op.Resize) {
+				Stats.Overlaps++;
+				return;
+			}
+			__Live_Block &Block = Entry->second;
+			Stats.Resizes++;
+			Vacate(Op.Addr, Block.Size);
+			Occupy(Op.Addr, (size_t)Op.Size);
+			Stats.LiveBytes += (size_t)Op.Size - Block.Size;
+			Block.Size = (size_t)Op.Size;
+			if (Plan != nullptr) Plan->Steps.push_back({Block.Slot, TRecMMReplayPlan::StepKind::Resize, Block.Size});
+		} else {
+			UINT32 Slot;
+			if (FreeSlots.empty()) {
+				Slot = SlotCount++;
+			} else {
+				Slot = FreeSlots.back();
+				FreeSlots.pop_back();
+			}
+			__Live_Block Block = {(size_t)Op.Size, Op.TS, Slot};
+			Live.insert({Op.Addr, Block});
+			Stats.Allocs++;
+			Stats.AllocBytes += Op.Size;
+			Stats.SizeHistogram[__Log2Bucket(Op.Size)]++;
+			Occupy(Op.Addr, Block.Size);
+			Stats.LiveBytes += Block.Size;
+			Stats.LiveCount++;
+			if (Plan != nullptr) Plan->Steps.push_back({Slot, TRecMMReplayPlan::StepKind::Alloc, Block.Size});
+		}
+		if (Stats.LiveBytes > Stats.PeakBytes) {
+			Stats.PeakBytes = Stats.LiveBytes;
+			Stats.PeakCount = Stats.LiveCount;
+			Stats.PeakPages = Stats.LivePages;
+			Stats.PeakTS = Op.TS;
+		}
+	});
+	if (Plan != nullptr) Plan->SlotCount = SlotCount;
+}
+
+void TRecMMAnalyzer::Report(void) const {
+	LOG(_T("========== Memory Operation Trace Analysis =========="));
+	LOG(_T("Trace: %s (version %d, %d-bit), %llu chunks"), Trace.FileName.c_str(),
+		Trace.Version, Trace.PtrWidth * 8, (UINT64)Trace.ChunkCount());
+	LOG(_T("Duration: %.3fs"), (double)(Stats.LastTS - Stats.FirstTS) / 10000000);
+	LOG(_T("Operations: %llu allocations, %llu resizes, %llu deallocations"),
+		Stats.Allocs, Stats.Resizes, Stats.Frees);
+	if (Stats.WildFrees > 0)
+		LOG(_T("Wild deallocations: %llu"), Stats.WildFrees);
+	if (Stats.Overlaps > 0)
+		LOG(_T("WARNING: Allocations at live addresses (ignored): %llu"), Stats.Overlaps);
+	LOG(_T("Allocated: %.2fKB in total"), (double)Stats.AllocBytes / BSize_aKB);
+	LOG(_T("Peak footprint: %.2fKB in %llu blocks at +%.3fs (%.1f%% fragmentation)"),
+		(double)Stats.PeakBytes / BSize_aKB, (UINT64)Stats.PeakCount,
+		(double)(Stats.PeakTS - Stats.FirstTS) / 10000000, Stats.PeakFragmentation() * 100);
+	LOG(_T("Remaining: %.2fKB in %llu blocks (%.1f%% fragmentation)"),
+		(double)Stats.LiveBytes / BSize_aKB, (UINT64)Stats.LiveCount, Stats.LiveFragmentation() * 100);
+
+	LOG(_T("Allocation sizes:"));
+	for (size_t Idx = 0; Idx < RECMM_ANALYZER_BUCKETS; Idx++) {
+		if (Stats.SizeHistogram[Idx] == 0) continue;
+		LOG(_T("* %llu - %llu bytes: %llu"), 1ULL << Idx, (2ULL << Idx) - 1, Stats.SizeHistogram[Idx]);
+	}
+	LOG(_T("Object life times:"));
+	for (size_t Idx = 0; Idx < RECMM_ANALYZER_BUCKETS - 1; Idx++) {
+		if (Stats.LifetimeHistogram[Idx] == 0) continue;
+		TCHAR STRBUF[16];
+		LOG(_T("* < %s: %llu"), __FormatTicks(2ULL << Idx, STRBUF, 16), Stats.LifetimeHistogram[Idx]);
+	}
+}
@@ -0,0 +1,266 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/**
+ * @addtogroup Utilities Basic Supporting Utilities
+ * @file
+ * @brief Memory Operation Trace Analysis and Replay
+ * @author Zhenyu Wu
+ * @date Oct 17, 2026: Initial implementation
+ * @date Oct 17, 2026: Sequence ordered merge and explicit resizes
+ **/
+
+#ifndef RecMMAnalyzer_H
+#define RecMMAnalyzer_H
+
+#include "Misc.h"
+#include "Allocator.h"
+#include "RecMMTrace.h"
+
+#include <vector>
+#include <functional>
+
+// Granularity for estimating fragmentation (bytes of touched pages not occupied by live blocks)
+#define RECMM_ANALYZER_PAGE		4096
+// Number of logarithmic histogram buckets
+#define RECMM_ANALYZER_BUCKETS	64
+// Replay operations between footprint samples
+#define RECMM_REPLAY_SAMPLE		4096
+
+/**
+ * @ingroup Utilities
+ * @brief Memory operation replay backend interface
+ *
+ * Adapts an allocator for replaying recorded memory operations
+ **/
+class IRecMMReplayBackend {
+public:
+	virtual ~IRecMMReplayBackend(void) {}
+
+	virtual LPCTSTR Name(void) const = 0;
+	virtual void* Alloc(size_t Size) = 0;
+	virtual void* Resize(void *Block, size_t OldSize, size_t NewSize) = 0;
+	virtual void Free(void *Block, size_t Size) = 0;
+};
+
+//! @ingroup Utilities
+//! Replay with the CRT heap (or whichever memory manager is switched in)
+class TRecMMReplayCRT : public IRecMMReplayBackend {
+public:
+	LPCTSTR Name(void) const override
+	{ return _T("CRT"); }
+	void* Alloc(size_t Size) override;
+	void* Resize(void *Block, size_t OldSize, size_t NewSize) override;
+	void Free(void *Block, size_t Size) override;
+};
+
+//! @ingroup Utilities
+//! Replay with a private Win32 heap
+class TRecMMReplayHeap : public IRecMMReplayBackend {
+protected:
+	HANDLE const Heap;
+public:
+	TRecMMReplayHeap(void);
+	~TRecMMReplayHeap(void) override;
+
+	LPCTSTR Name(void) const override
+	{ return _T("Win32 Heap"); }
+	void* Alloc(size_t Size) override;
+	void* Resize(void *Block, size_t OldSize, size_t NewSize) override;
+	void Free(void *Block, size_t Size) override;
+};
+
+#ifdef NEDMM
+
+//! @ingroup Utilities
+//! Replay with NedMalloc
+class TRecMMReplayNed : public IRecMMReplayBackend {
+public:
+	LPCTSTR Name(void) const override
+	{ return _T("NedMM"); }
+	void* Alloc(size_t Size) override;
+	void* Resize(void *Block, size_t OldSize, size_t NewSize) override;
+	void Free(void *Block, size_t Size) override;
+};
+
+#endif
+
+#ifdef FASTMM
+
+//! @ingroup Utilities
+//! Replay with FastMM
+class TRecMMReplayFast : public IRecMMReplayBackend {
+public:
+	LPCTSTR Name(void) const override
+	{ return _T("FastMM"); }
+	void* Alloc(size_t Size) override;
+	void* Resize(void *Block, size_t OldSize, size_t NewSize) override;
+	void Free(void *Block, size_t Size) override;
+};
+
+#endif
+
+//! @ingroup Utilities
+//! Replay with TFixedPool (as used by FixedPoolAllocator), larger blocks go to the CRT heap
+class TRecMMReplayFixedPool : public IRecMMReplayBackend {
+public:
+	~TRecMMReplayFixedPool(void) override;
+
+	LPCTSTR Name(void) const override
+	{ return _T("FixedPool"); }
+	void* Alloc(size_t Size) override;
+	void* Resize(void *Block, size_t OldSize, size_t NewSize) override;
+	void Free(void *Block, size_t Size) override;
+};
+
+//! @ingroup Utilities
+//! Replay with a TArena (as used by ArenaAllocator), nothing is reclaimed until destruction
+class TRecMMReplayArena : public IRecMMReplayBackend {
+protected:
+	TArena Arena;
+public:
+	LPCTSTR Name(void) const override
+	{ return _T("Arena"); }
+	void* Alloc(size_t Size) override;
+	void* Resize(void *Block, size_t OldSize, size_t NewSize) override;
+	void Free(void *Block, size_t Size) override;
+};
+
+/**
+ * @ingroup Utilities
+ * @brief Memory operation replay plan
+ *
+ * A trace reduced to dense block slots, so that replay cost is dominated by the backend
+ * @note Operations are replayed back-to-back on the calling thread, in recorded order
+ **/
+class TRecMMReplayPlan {
+	friend class TRecMMAnalyzer;
+public:
+	struct TResult {
+		UINT64 Operations;
+		double Seconds;
+		size_t PeakFootprint;
+	};
+
+protected:
+	enum class StepKind : UINT32 {
+		Alloc,
+		Resize,
+		Free,
+	};
+	struct TStep {
+		UINT32 Slot;
+		StepKind Kind;
+		size_t Size;
+	};
+
+	std::vector<TStep> Steps;
+	UINT32 SlotCount;
+
+public:
+	TRecMMReplayPlan(void) : SlotCount(0) {}
+
+	size_t Count(void) const
+	{ return Steps.size(); }
+
+	/**
+	 * Replay the operations against a backend
+	 * @note Footprint is the growth of process private bytes, sampled every RECMM_REPLAY_SAMPLE operations
+	 **/
+	TResult Replay(IRecMMReplayBackend &Backend) const;
+};
+
+/**
+ * @ingroup Utilities
+ * @brief Memory operation trace analyzer
+ *
+ * Reconstructs the live heap over time from a trace, in recorded order across threads
+ * (by sequence stamp, or for traces before version 3, by time; deallocations first on ties)
+ * @note A zero size operation is taken as deallocation; an allocation at a live address is an anomaly
+ *       and ignored, except in traces before version 3, where it is taken as resize (they do not mark resizes)
+ **/
+class TRecMMAnalyzer {
+public:
+	struct TStats {
+		UINT64 FirstTS;
+		UINT64 LastTS;
+		UINT64 Allocs;
+		UINT64 Resizes;
+		UINT64 Frees;
+		UINT64 WildFrees;
+		//! Allocations at a live address (not marked as resize)
+		UINT64 Overlaps;
+		UINT64 AllocBytes;
+
+		size_t LiveBytes;
+		size_t LiveCount;
+		size_t LivePages;
+		//! Live bytes at peak, and the number of live blocks and touched pages at that moment
+		size_t PeakBytes;
+		size_t PeakCount;
+		size_t PeakPages;
+		UINT64 PeakTS;
+
+		//! Allocation count by log2 of requested size
+		UINT64 SizeHistogram[RECMM_ANALYZER_BUCKETS];
+		//! Deallocation count by log2 of life time (in 100ns ticks)
+		UINT64 LifetimeHistogram[RECMM_ANALYZER_BUCKETS];
+
+		//! Fraction of touched pages not occupied by live blocks at peak
+		double PeakFragmentation(void) const
+		{ return PeakPages ? 1 - (double)PeakBytes / ((double)PeakPages * RECMM_ANALYZER_PAGE) : 0; }
+		//! Fraction of touched pages not occupied by live blocks at end of trace
+		double LiveFragmentation(void) const
+		{ return LivePages ? 1 - (double)LiveBytes / ((double)LivePages * RECMM_ANALYZER_PAGE) : 0; }
+	};
+
+protected:
+	TRecMMTrace &Trace;
+
+	void __Merge(std::function<void(TRecMMTrace::TOperation const &)> const &Visit);
+
+public:
+	TStats Stats;
+
+	TRecMMAnalyzer(TRecMMTrace &xTrace) : Trace(xTrace) {}
+
+	/**
+	 * Analyze the whole trace, optionally producing a replay plan
+	 **/
+	void Analyze(TRecMMReplayPlan *Plan = nullptr);
+
+	/**
+	 * Print the analysis results via @link LOG() DEBUG printing functions @endlink
+	 **/
+	void Report(void) const;
+};
+
+#endif //RecMMAnalyzer_H
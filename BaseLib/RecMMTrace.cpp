@@ -0,0 +1,225 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// [Utilities] Memory Operation Trace Format and Reader
+
+#include "MMSwitcher.h"
+
+#include "RecMMTrace.h"
+#include "Exception.h"
+
+// Number of operations per pseudo-chunk when reading legacy traces
+#define RECMM_LEGACY_CHUNK		65536
+
+static bool GetVarint(BYTE const *&Buf, BYTE const *End, UINT64 &Value) {
+	Value = 0;
+	for (int Shift = 0; (Buf < End) && (Shift < 64); Shift += 7) {
+		BYTE Byte = *Buf++;
+		Value |= (UINT64)(Byte & 0x7F) << Shift;
+		if ((Byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+inline static INT64 UnZigZag(UINT64 Value)
+{ return (INT64)(Value >> 1) ^ -(INT64)(Value & 1); }
+
+TRecMMTrace::TRecMMTrace(TString const &xFileName) :
+	File(nullptr), DataOffset(0), CurChunk(0), CurOp(0), FileName(xFileName), Version(0), PtrWidth(0) {
+	errno_t ErrCode = _tfopen_s(&File, FileName.c_str(), _T("rb"));
+	if (ErrCode != 0)
+		FAIL(_T("Unable to open trace file '%s' (%d)"), FileName.c_str(), ErrCode);
+
+	try {
+		_fseeki64(File, 0, SEEK_END);
+		UINT64 FileSize = _ftelli64(File);
+
+		TRecMMTraceHeader Header = {0};
+		__ReadAt(0, &Header, min(FileSize, sizeof(Header)));
+		if (Header.Magic == RECMM_TRACE_MAGIC) {
+			if (FileSize < sizeof(Header))
+				FAIL(_T("Truncated trace header"));
+			if ((Header.Version < 2) || (Header.Version > RECMM_TRACE_VERSION))
+				FAIL(_T("Unsupported trace version %d"), Header.Version);
+			Version = Header.Version;
+			PtrWidth = Header.PtrWidth;
+			DataOffset = sizeof(Header);
+			__LoadIndex(FileSize);
+		} else {
+			// Legacy traces start with the pointer width
+			PtrWidth = *(BYTE*)&Header;
+			if ((PtrWidth != 4) && (PtrWidth != 8))
+				FAIL(_T("Unrecognized trace format"));
+			Version = 1;
+			DataOffset = 1 + PtrWidth;
+			__LoadLegacyIndex(FileSize);
+		}
+	} catch (...) {
+		fclose(File);
+		throw;
+	}
+}
+
+TRecMMTrace::~TRecMMTrace(void) {
+	fclose(File);
+}
+
+void TRecMMTrace::__ReadAt(UINT64 Offset, void *Buf, size_t Size) {
+	if (_fseeki64(File, Offset, SEEK_SET) != 0)
+		FAIL(_T("Unable to seek trace file to offset %llu"), Offset);
+	if (fread(Buf, 1, Size, File) != Size)
+		FAIL(_T("Unable to read %llu bytes from trace file at offset %llu"), (UINT64)Size, Offset);
+}
+
+void TRecMMTrace::__LoadIndex(UINT64 FileSize) {
+	size_t const IndexSize = __ChunkIndexSize();
+	TRecMMTraceTrailer Trailer = {0};
+	if (FileSize >= DataOffset + sizeof(Trailer)) {
+		__ReadAt(FileSize - sizeof(Trailer), &Trailer, sizeof(Trailer));
+		if ((Trailer.Magic == RECMM_INDEX_MAGIC) && (Trailer.IndexOffset >= DataOffset) &&
+			(Trailer.IndexOffset + (UINT64)Trailer.ChunkCount * IndexSize + sizeof(Trailer) == FileSize)) {
+			Chunks.resize(Trailer.ChunkCount);
+			if (Trailer.ChunkCount) {
+				std::vector<BYTE> Data(Trailer.ChunkCount * IndexSize);
+				__ReadAt(Trailer.IndexOffset, &Data.front(), Data.size());
+				for (UINT32 Idx = 0; Idx < Trailer.ChunkCount; Idx++)
+					memcpy(&Chunks[Idx], &Data[Idx * IndexSize], IndexSize);
+			}
+			return;
+		}
+	}
+	// Recording was interrupted, rebuild the index by scanning the chunks
+	__ScanChunks(FileSize);
+}
+
+void TRecMMTrace::__ScanChunks(UINT64 FileSize) {
+	size_t const HeaderSize = __ChunkHeaderSize();
+	std::vector<TOperation> Ops;
+	UINT64 Offset = DataOffset;
+	while (Offset + HeaderSize <= FileSize) {
+		TRecMMChunkHeader Header = {0};
+		__ReadAt(Offset, &Header, HeaderSize);
+		if ((Header.Magic != RECMM_CHUNK_MAGIC) || (Header.Count == 0) ||
+			(Offset + HeaderSize + Header.Length > FileSize))
+			break;
+
+		TRecMMChunkIndex Index = {Offset, Header.BaseTS, Header.BaseTS, Header.ThreadID, Header.Count, Header.BaseSeq};
+		Chunks.push_back(Index);
+		ReadChunk(Chunks.size() - 1, Ops);
+		Chunks.back().LastTS = Ops.back().TS;
+		Offset += HeaderSize + Header.Length;
+	}
+}
+
+void TRecMMTrace::__LoadLegacyIndex(UINT64 FileSize) {
+	size_t const EntrySize = sizeof(UINT64) + 2 * PtrWidth;
+	UINT64 Count = (FileSize - DataOffset) / EntrySize;
+	for (UINT64 Base = 0; Base < Count; Base += RECMM_LEGACY_CHUNK) {
+		UINT32 ChunkSize = (UINT32)min(Count - Base, RECMM_LEGACY_CHUNK);
+		TRecMMChunkIndex Index = {DataOffset + Base * EntrySize, 0, 0, 0, ChunkSize};
+		__ReadAt(Index.Offset, &Index.FirstTS, sizeof(UINT64));
+		__ReadAt(Index.Offset + (ChunkSize - 1) * EntrySize, &Index.LastTS, sizeof(UINT64));
+		Chunks.push_back(Index);
+	}
+}
+
+void TRecMMTrace::ReadChunk(size_t Idx, std::vector<TOperation> &Ops) {
+	if (Idx >= Chunks.size())
+		FAIL(_T("Chunk index %llu out of range (%llu)"), (UINT64)Idx, (UINT64)Chunks.size());
+	TRecMMChunkIndex const &Index = Chunks[Idx];
+	Ops.resize(Index.Count);
+
+	if (Version == 1) {
+		size_t const EntrySize = sizeof(UINT64) + 2 * PtrWidth;
+		std::vector<BYTE> Data(Index.Count * EntrySize);
+		__ReadAt(Index.Offset, &Data.front(), Data.size());
+		BYTE const *Buf = &Data.front();
+		for (auto &Op : Ops) {
+			Op.TS = *(UINT64*)Buf;
+			Op.Seq = Op.Addr = Op.Size = 0;
+			memcpy(&Op.Addr, Buf + sizeof(UINT64), PtrWidth);
+			memcpy(&Op.Size, Buf + sizeof(UINT64) + PtrWidth, PtrWidth);
+			Op.ThreadID = 0;
+			Op.Resize = false;
+			Buf += EntrySize;
+		}
+		return;
+	}
+
+	size_t const HeaderSize = __ChunkHeaderSize();
+	TRecMMChunkHeader Header = {0};
+	__ReadAt(Index.Offset, &Header, HeaderSize);
+	if ((Header.Magic != RECMM_CHUNK_MAGIC) || (Header.Count != Index.Count))
+		FAIL(_T("Corrupted chunk header at offset %llu"), Index.Offset);
+	std::vector<BYTE> Data(Header.Length);
+	if (Header.Length)
+		__ReadAt(Index.Offset + HeaderSize, &Data.front(), Data.size());
+
+	BYTE const *Buf = Data.empty() ? nullptr : &Data.front();
+	BYTE const *End = Buf + Data.size();
+	UINT64 TS = Header.BaseTS;
+	UINT64 Seq = Header.BaseSeq;
+	UINT64 Addr = Header.BaseAddr;
+	for (auto &Op : Ops) {
+		UINT64 DeltaTS, DeltaSeq = 0, DeltaAddr;
+		if (!GetVarint(Buf, End, DeltaTS) || ((Version >= 3) && !GetVarint(Buf, End, DeltaSeq)) ||
+			!GetVarint(Buf, End, DeltaAddr) || !GetVarint(Buf, End, Op.Size))
+			FAIL(_T("Corrupted chunk payload at offset %llu"), Index.Offset);
+		Op.TS = TS += UnZigZag(DeltaTS);
+		Op.Seq = Seq += DeltaSeq >> 1;
+		Op.Resize = (DeltaSeq & 1) != 0;
+		Op.Addr = Addr += UnZigZag(DeltaAddr);
+		Op.ThreadID = Header.ThreadID;
+	}
+}
+
+void TRecMMTrace::Seek(size_t ChunkIdx) {
+	CurChunk = ChunkIdx;
+	CurOps.clear();
+	CurOp = 0;
+}
+
+size_t TRecMMTrace::SeekTime(UINT64 TS) {
+	size_t Idx = 0;
+	while ((Idx < Chunks.size()) && (Chunks[Idx].LastTS < TS)) Idx++;
+	Seek(Idx);
+	return Idx;
+}
+
+bool TRecMMTrace::Next(TOperation &Op) {
+	while (CurOp >= CurOps.size()) {
+		if (CurChunk >= Chunks.size()) return false;
+		ReadChunk(CurChunk++, CurOps);
+		CurOp = 0;
+	}
+	Op = CurOps[CurOp++];
+	return true;
+}
@@ -0,0 +1,227 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/**
+ * @addtogroup Utilities Basic Supporting Utilities
+ * @file
+ * @brief Memory Operation Trace Format and Reader
+ * @author Zhenyu Wu
+ * @date Oct 17, 2026: Initial implementation
+ * @date Oct 17, 2026: Global operation sequence numbers
+ * @date Oct 17, 2026: Monotonic clock stamps in place of the global sequence counter
+ **/
+
+#ifndef RecMMTrace_H
+#define RecMMTrace_H
+
+#include "Misc.h"
+
+#include <vector>
+#include <stdio.h>
+
+/*
+ * Trace file layout (version 3, little endian):
+ *   [Header] [Chunk]... [Index entries] [Trailer]
+ * Each chunk holds the operations of one thread, as a chunk header followed by
+ * per-operation varints: zigzag timestamp delta, sequence delta (shifted left by 1, lowest bit set for in-place resize),
+ * zigzag address delta, size (0 = free)
+ * Sequence numbers are per-thread stamps of the monotonic clock (nanoseconds), taken before deallocations and
+ * after allocations, and give the order of operations across threads; timestamps are the same stamps in 100ns units
+ * The index and trailer are absent if recording was interrupted; chunks can still be scanned
+ *
+ * Version 2 layout is the same, without sequence numbers (BaseSeq and FirstSeq, and the sequence deltas),
+ * hence in-place resizes are not distinguishable from allocations
+ *
+ * Legacy (version 1) layout: [Pointer width (1 byte)] [Byte order marker (pointer width)]
+ *   followed by raw {UINT64 timestamp, pointer address, pointer-width size} tuples
+ */
+
+#define RECMM_TRACE_VERSION		3
+#define RECMM_TRACE_MAGIC		0x504F4D52	// "RMOP"
+#define RECMM_CHUNK_MAGIC		0x4B4E4843	// "CHNK"
+#define RECMM_INDEX_MAGIC		0x58444E49	// "INDX"
+
+#define RECMM_VARINT_MAX		10
+
+#pragma pack(push, 1)
+
+struct TRecMMTraceHeader {
+	UINT32 Magic;
+	UINT16 Version;
+	BYTE PtrWidth;
+	BYTE Reserved;
+};
+
+struct TRecMMChunkHeader {
+	UINT32 Magic;
+	UINT32 ThreadID;
+	UINT32 Count;
+	UINT32 Length;
+	UINT64 BaseTS;
+	UINT64 BaseAddr;
+	UINT64 BaseSeq;
+};
+
+struct TRecMMChunkIndex {
+	UINT64 Offset;
+	UINT64 FirstTS;
+	UINT64 LastTS;
+	UINT32 ThreadID;
+	UINT32 Count;
+	UINT64 FirstSeq;
+};
+
+struct TRecMMTraceTrailer {
+	UINT64 IndexOffset;
+	UINT32 ChunkCount;
+	UINT32 Magic;
+};
+
+#pragma pack(pop)
+
+/**
+ * @ingroup Utilities
+ * @brief Memory operation trace encoder
+ *
+ * Encodes the operations of a chunk, each encoded operation takes at most 4 x RECMM_VARINT_MAX bytes
+ **/
+class TRecMMChunkEncoder {
+protected:
+	UINT64 PrevTS;
+	UINT64 PrevAddr;
+	UINT64 PrevSeq;
+
+public:
+	TRecMMChunkEncoder(UINT64 BaseTS, UINT64 BaseAddr, UINT64 BaseSeq) :
+		PrevTS(BaseTS), PrevAddr(BaseAddr), PrevSeq(BaseSeq) {}
+
+	inline static BYTE* PutVarint(BYTE *Buf, UINT64 Value) {
+		while (Value >= 0x80) {
+			*Buf++ = (BYTE)(Value | 0x80);
+			Value >>= 7;
+		}
+		*Buf++ = (BYTE)Value;
+		return Buf;
+	}
+
+	inline static UINT64 ZigZag(INT64 Value)
+	{ return ((UINT64)Value << 1) ^ (UINT64)(Value >> 63); }
+
+	//! Sequence numbers must not decrease within a chunk
+	inline BYTE* Put(BYTE *Buf, UINT64 TS, UINT64 Seq, UINT64 Addr, UINT64 Size, bool Resize = false) {
+		Buf = PutVarint(Buf, ZigZag((INT64)(TS - PrevTS)));
+		Buf = PutVarint(Buf, ((Seq - PrevSeq) << 1) | (Resize ? 1 : 0));
+		Buf = PutVarint(Buf, ZigZag((INT64)(Addr - PrevAddr)));
+		PrevTS = TS;
+		PrevSeq = Seq;
+		PrevAddr = Addr;
+		return PutVarint(Buf, Size);
+	}
+};
+
+/**
+ * @ingroup Utilities
+ * @brief Memory operation trace reader
+ *
+ * Reads version 3 and 2 (chunked) and legacy traces, with random access to chunks
+ * @note Legacy traces are presented as chunks of fixed number of operations, with thread ID 0
+ * @note Traces before version 3 have no sequence numbers, which read as 0, and no resize marks
+ **/
+class TRecMMTrace {
+public:
+	struct TOperation {
+		UINT64 TS;
+		UINT64 Seq;
+		UINT64 Addr;
+		UINT64 Size;
+		DWORD ThreadID;
+		//! In-place resize of a live block (only marked since version 3)
+		bool Resize;
+	};
+
+protected:
+	FILE *File;
+	std::vector<TRecMMChunkIndex> Chunks;
+	UINT64 DataOffset;
+
+	size_t CurChunk;
+	std::vector<TOperation> CurOps;
+	size_t CurOp;
+
+	// Version 2 headers and index entries lack the trailing sequence number
+	size_t __ChunkHeaderSize(void) const
+	{ return Version < 3 ? sizeof(TRecMMChunkHeader) - sizeof(UINT64) : sizeof(TRecMMChunkHeader); }
+	size_t __ChunkIndexSize(void) const
+	{ return Version < 3 ? sizeof(TRecMMChunkIndex) - sizeof(UINT64) : sizeof(TRecMMChunkIndex); }
+
+	void __ReadAt(UINT64 Offset, void *Buf, size_t Size);
+	void __LoadIndex(UINT64 FileSize);
+	void __ScanChunks(UINT64 FileSize);
+	void __LoadLegacyIndex(UINT64 FileSize);
+
+public:
+	TString const FileName;
+	UINT16 Version;
+	BYTE PtrWidth;
+
+	TRecMMTrace(TString const &xFileName);
+	~TRecMMTrace(void);
+
+	size_t ChunkCount(void) const
+	{ return Chunks.size(); }
+
+	TRecMMChunkIndex const& ChunkInfo(size_t Idx) const
+	{ return Chunks[Idx]; }
+
+	/**
+	 * Read all operations in a chunk
+	 **/
+	void ReadChunk(size_t Idx, std::vector<TOperation> &Ops);
+
+	/**
+	 * Position sequential reading at the start of a chunk
+	 **/
+	void Seek(size_t ChunkIdx);
+
+	/**
+	 * Position sequential reading at the first chunk (in file order) that ends at or after given time
+	 * @return Index of the chunk
+	 **/
+	size_t SeekTime(UINT64 TS);
+
+	/**
+	 * Read the next operation
+	 * @return false if reached the end of trace
+	 **/
+	bool Next(TOperation &Op);
+};
+
+#endif //RecMMTrace_H
@@ -69,11 +69,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <unordered_map>
 #include <allocators>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <intrin.h>
 
 #include "BaseLib/DebugLog.h"
 #include "ThreadLib/SyncObjs.h"
-
-static TLockableCS* StatLock = nullptr;
+#include "ThreadLib/StackWalker.h"
 
 using namespace std;
 
@@ -82,19 +85,23 @@ struct __Alloc_Rec {
 	int _LineNumber;
 
 	size_t _Size;
+	// Number of allocations this record stands for (1 unless sampled)
+	size_t _Count;
+	// Captured call stack (0 if not captured)
+	UINT32 _Stack;
 };
 
 template<>
 struct hash < __Alloc_Rec > {
 	size_t operator()(__Alloc_Rec const &T)
-	{ return (size_t)T._Filename ^ (size_t)T._LineNumber; }
+	{ return (size_t)T._Filename ^ (size_t)T._LineNumber ^ ((size_t)T._Stack << 16); }
 };
 
 bool operator ==(__Alloc_Rec const &A, __Alloc_Rec const &B)
-{ return (A._Filename == B._Filename) && (A._LineNumber == B._LineNumber); }
+{ return (A._Filename == B._Filename) && (A._LineNumber == B._LineNumber) && (A._Stack == B._Stack); }
 
 bool operator !=(__Alloc_Rec const &A, __Alloc_Rec const &B)
-{ return (A._Filename != B._Filename) || (A._LineNumber != B._LineNumber); }
+{ return (A._Filename != B._Filename) || (A._LineNumber != B._LineNumber) || (A._Stack != B._Stack); }
 
 // TEMPLATE CLASS allocator
 template<class _Ty>
@@ -209,16 +216,272 @@ public:
 };
 
 #define TAlloc_Map unordered_map<__Alloc_Rec, size_t, hash<__Alloc_Rec>, equal_to<__Alloc_Rec>, malloc_allocator<pair<__Alloc_Rec const, size_t>>>
-static TAlloc_Map* __Alloc_Map = nullptr;
 #define TDealloc_Map unordered_map<void*, __Alloc_Rec, hash<void*>, equal_to<void*>, malloc_allocator<pair<void* const, __Alloc_Rec>>>
-static TDealloc_Map* __Dealloc_Map = nullptr;
 
-static size_t __Alloc_Size = 0;
-static UINT64 __Alloc_Count = 0;
-static UINT64 __Dealloc_Count = 0;
-static UINT64 __Alloc_Cumulative = 0;
-static UINT64 __Dealloc_Cumulative = 0;
-static UINT64 __Dealloc_Wild = 0;
+// Allocation records are sharded by address, each shard has its own lock, maps and counters
+// A block is always recorded and unrecorded in the same shard; shards are merged when reporting
+#define STATMM_SHARDS 64
+
+struct __Stat_Shard {
+	TLockableCS Lock;
+	TAlloc_Map Alloc_Map;
+	TDealloc_Map Dealloc_Map;
+
+	size_t Alloc_Size = 0;
+	UINT64 Alloc_Count = 0;
+	UINT64 Dealloc_Count = 0;
+	UINT64 Alloc_Cumulative = 0;
+	UINT64 Dealloc_Cumulative = 0;
+	UINT64 Dealloc_Wild = 0;
+
+	// Profiling the shard lock would allocate while it is being taken for an allocation
+	__Stat_Shard(void)
+	{ LOCKPROF(Lock.__SyncProfileDisable()); }
+};
+
+static size_t const __Stat_Shard_Stride = (sizeof(__Stat_Shard) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+static BYTE* __Stat_Shards = nullptr;
+
+inline static __Stat_Shard& __StatShardAt(size_t Idx)
+{ return *(__Stat_Shard*)(__Stat_Shards + Idx * __Stat_Shard_Stride); }
+
+inline static __Stat_Shard& __StatShardOf(void *_Memory) {
+	UINT_PTR Addr = (UINT_PTR)_Memory >> 4;
+	return __StatShardAt((size_t)((Addr ^ (Addr >> 8)) % STATMM_SHARDS));
+}
+
+// Sampling: with a non-zero rate, allocations are sampled as a Poisson process over allocated bytes,
+// and each sampled allocation is recorded with the weight of allocations it statistically stands for
+#ifndef STATMM_SAMPLE_RATE
+#define STATMM_SAMPLE_RATE 0
+#endif
+#define STATMM_FILTER_SIZE 65536
+
+static size_t volatile __Sample_Rate = STATMM_SAMPLE_RATE;
+static __declspec(thread) INT64 __Sample_Bytes = 0;
+static __declspec(thread) UINT64 __Sample_Seed = 0;
+
+// Counting filter of recorded blocks, so unsampled blocks can be freed without taking a lock
+// NOTE: Only maintained while sampling, rebuilt from the shards when sampling is turned on
+static LONG volatile __Sample_Filter[STATMM_FILTER_SIZE];
+
+inline static LONG volatile& __SampleFilterOf(void *_Memory) {
+	UINT_PTR Addr = (UINT_PTR)_Memory >> 4;
+	return __Sample_Filter[(Addr ^ (Addr >> 16)) & (STATMM_FILTER_SIZE - 1)];
+}
+
+// Check whether a block is certainly not recorded (only possible when sampling)
+inline static bool __Sample_Skip(void *_Memory)
+{ return (__Sample_Rate != 0) && (__SampleFilterOf(_Memory) == 0); }
+
+// Uniform random number in (0, 1]
+static double __Sample_Random(void) {
+	if (__Sample_Seed == 0)
+		__Sample_Seed = (((UINT64)GetCurrentThreadId() * 0x9E3779B97F4A7C15ULL) ^ __rdtsc()) | 1;
+	// xorshift64*
+	__Sample_Seed ^= __Sample_Seed >> 12;
+	__Sample_Seed ^= __Sample_Seed << 25;
+	__Sample_Seed ^= __Sample_Seed >> 27;
+	return (double)(((__Sample_Seed * 2685821657736338717ULL) >> 11) + 1) / 9007199254740993.0;
+}
+
+// Decide whether to record an allocation, and with what weight
+inline static bool __Sample_Take(size_t _size, size_t &_Count) {
+	size_t Rate = __Sample_Rate;
+	if (Rate == 0)
+		return (_Count = 1, true);
+	if ((__Sample_Bytes -= (INT64)_size) > 0)
+		return false;
+
+	// Exponentially distributed gap to next sample
+	__Sample_Bytes = (INT64)(-log(__Sample_Random()) * Rate) + 1;
+	// Weight is the inverse of sampling probability, randomly rounded to keep the estimate unbiased
+	double P = 1.0 - exp(-(double)_size / Rate);
+	double Weight = (P > 0) ? 1.0 / P : 1.0;
+	_Count = (size_t)Weight;
+	if (__Sample_Random() <= Weight - _Count) _Count++;
+	return true;
+}
+
+// Call stack attribution: with a non-zero depth, return addresses of recorded allocations are captured,
+// deduplicated in a stack table (entries are never removed), and symbolized when dumping details
+#ifndef STATMM_STACK_DEPTH
+#define STATMM_STACK_DEPTH 0
+#endif
+#define STATMM_STACK_MAX 16
+#define STATMM_STACK_TABLE 16384
+
+struct __Stack_Rec {
+	// 0 = empty, 1 = being filled, 2 = ready
+	LONG volatile State;
+	DWORD Hash;
+	WORD Depth;
+	PVOID Frames[STATMM_STACK_MAX];
+};
+
+static size_t volatile __Stack_Depth = STATMM_STACK_DEPTH;
+static __Stack_Rec* volatile __Stack_Table = nullptr;
+
+static __Stack_Rec* __Stack_GetTable(void) {
+	__Stack_Rec *Table = __Stack_Table;
+	if (Table == nullptr) {
+		// This resource is never deallocated
+		Table = (__Stack_Rec*)_calloc_stat_l(STATMM_STACK_TABLE, sizeof(__Stack_Rec));
+		if (Table == nullptr) return nullptr;
+		if (InterlockedCompareExchangePointer((PVOID volatile*)&__Stack_Table, Table, nullptr) != nullptr) {
+			_free_stat_l(Table);
+			Table = __Stack_Table;
+		}
+	}
+	return Table;
+}
+
+// Capture the call stack of current allocation, returns the stack ID (0 if not captured)
+// NOTE: Only the frames of this function and its caller are skipped, other memory manager frames may show
+__declspec(noinline) static UINT32 __Stack_Capture(void) {
+	size_t Depth = __Stack_Depth;
+	if (Depth == 0) return 0;
+	__Stack_Rec *Table = __Stack_GetTable();
+	if (Table == nullptr) return 0;
+
+	PVOID Frames[STATMM_STACK_MAX];
+	DWORD Hash;
+	WORD Captured = RtlCaptureStackBackTrace(2, (DWORD)min(Depth, (size_t)STATMM_STACK_MAX), Frames, &Hash);
+	if (Captured == 0) return 0;
+
+	for (UINT32 Probe = 0; Probe < STATMM_STACK_TABLE; Probe++) {
+		UINT32 Idx = (Hash + Probe) & (STATMM_STACK_TABLE - 1);
+		__Stack_Rec &Rec = Table[Idx];
+		if ((Rec.State == 0) && (InterlockedCompareExchange(&Rec.State, 1, 0) == 0)) {
+			Rec.Hash = Hash;
+			Rec.Depth = Captured;
+			memcpy(Rec.Frames, Frames, Captured * sizeof(PVOID));
+			InterlockedExchange(&Rec.State, 2);
+			return Idx + 1;
+		}
+		while (Rec.State == 1)
+			YieldProcessor();
+		if ((Rec.Hash == Hash) && (Rec.Depth == Captured) && (memcmp(Rec.Frames, Frames, Captured * sizeof(PVOID)) == 0))
+			return Idx + 1;
+	}
+	// Table full, leave unattributed
+	return 0;
+}
+
+// NOTE: The following helpers must be called with the shard locked
+
+static void __Alloc_Record(__Stat_Shard &Shard, void *_Memory, __Alloc_Rec const &_addr, LPCTSTR _Op) {
+	size_t _WeightedSize = _addr._Size * _addr._Count;
+	auto idxiter = Shard.Alloc_Map.find(_addr);
+	if (idxiter != Shard.Alloc_Map.end()) {
+		*const_cast<size_t*>(&idxiter->first._Size) += _WeightedSize;
+		idxiter->second += _addr._Count;
+	} else
+		Shard.Alloc_Map.insert(make_pair(__Alloc_Rec{_addr._Filename, _addr._LineNumber, _WeightedSize, 0, _addr._Stack}, _addr._Count));
+	Shard.Alloc_Count += _addr._Count;
+
+	auto insrec = Shard.Dealloc_Map.insert(make_pair(_Memory, _addr));
+	if (!insrec.second) {
+		FAIL(_T("{%s} Duplicate allocation record '%s (%d)' -> '%s (%d)'"), _Op,
+			 insrec.first->second._Filename, insrec.first->second._LineNumber,
+			 _addr._Filename, _addr._LineNumber);
+	}
+	if (__Sample_Rate != 0)
+		InterlockedIncrement(&__SampleFilterOf(_Memory));
+	Shard.Alloc_Cumulative += _WeightedSize;
+	Shard.Alloc_Size += _WeightedSize;
+}
+
+static bool __Alloc_Unrecord(__Stat_Shard &Shard, void *_Memory, size_t _OldSize, __Alloc_Rec *_rec, LPCTSTR _Op) {
+	auto iter = Shard.Dealloc_Map.find(_Memory);
+	if (iter == Shard.Dealloc_Map.end()) {
+		// Unsampled blocks may pass the filter due to collisions
+		if (__Sample_Rate == 0)
+			Shard.Dealloc_Wild++;
+		return false;
+	}
+
+	DEBUGV(if (iter->second._Size != _OldSize)
+		   FAIL(_T("{%s} Allocation deallocation size unbalanced '%s (%d)' (%d != %d)"), _Op,
+		   iter->second._Filename, iter->second._LineNumber, (int)iter->second._Size, (int)_OldSize);
+	);
+
+	size_t _Count = iter->second._Count;
+	size_t _WeightedSize = _OldSize * _Count;
+	auto cntiter = Shard.Alloc_Map.find(iter->second);
+	if (cntiter == Shard.Alloc_Map.end())
+		FAIL(_T("Missing allocation record"));
+	if ((cntiter->second -= _Count) == 0) {
+		Shard.Alloc_Map.erase(cntiter);
+	} else {
+		*const_cast<size_t*>(&cntiter->first._Size) -= _WeightedSize;
+	}
+	if (_rec) *_rec = iter->second;
+	Shard.Dealloc_Map.erase(iter);
+	if (__Sample_Rate != 0)
+		InterlockedDecrement(&__SampleFilterOf(_Memory));
+	Shard.Dealloc_Count += _Count;
+	Shard.Dealloc_Cumulative += _WeightedSize;
+	Shard.Alloc_Size -= _WeightedSize;
+	return true;
+}
+
+static void __Alloc_Resize(__Stat_Shard &Shard, void *_Memory, size_t _OldSize, size_t _NewSize) {
+	auto iter = Shard.Dealloc_Map.find(_Memory);
+	if (iter == Shard.Dealloc_Map.end())
+		return;
+
+	size_t _Count = iter->second._Count;
+	iter->second._Size += _NewSize - _OldSize;
+	auto cntiter = Shard.Alloc_Map.find(iter->second);
+	if (cntiter == Shard.Alloc_Map.end())
+		FAIL(_T("Missing allocation record"));
+	*const_cast<size_t*>(&cntiter->first._Size) += (_NewSize - _OldSize) * _Count;
+	Shard.Dealloc_Cumulative += _OldSize * _Count;
+	Shard.Alloc_Cumulative += _NewSize * _Count;
+	Shard.Alloc_Size += (_NewSize - _OldSize) * _Count;
+}
+
+// Size of a block if it may be recorded (0 otherwise), so unsampled blocks skip the size query
+inline static size_t __Tracked_Size(void *_Memory)
+{ return (_Memory && !__Sample_Skip(_Memory)) ? _msize_stat_l(_Memory) : 0; }
+
+// Moved blocks are unrecorded from the old shard, and recorded in the new shard (keeping allocation site and weight)
+// NOTE: _NewSize is the requested size, the block size is only queried if the block is recorded
+static void __Realloc_Record(void *_Memory, size_t _OldSize, void *_ret, size_t _NewSize,
+							 const TCHAR * _Filename, int _LineNumber, LPCTSTR _Op) {
+	if (_Memory == _ret) {
+		if (__Sample_Skip(_ret)) return;
+		size_t _size = _msize_stat_l(_ret);
+		__Stat_Shard &Shard = __StatShardOf(_ret);
+		Synchronized(Shard.Lock, __Alloc_Resize(Shard, _ret, _OldSize, _size));
+		return;
+	}
+
+	__Alloc_Rec _addr{_Filename, _LineNumber, 0, 1};
+	bool Recorded = false;
+	if (_Memory && !__Sample_Skip(_Memory)) {
+		__Stat_Shard &Shard = __StatShardOf(_Memory);
+		__Alloc_Rec _rec;
+		Synchronized(Shard.Lock, {
+			Recorded = __Alloc_Unrecord(Shard, _Memory, _OldSize, &_rec, _Op);
+			if (Recorded) {
+				_addr._Filename = _rec._Filename;
+				_addr._LineNumber = _rec._LineNumber;
+				_addr._Count = _rec._Count;
+				_addr._Stack = _rec._Stack;
+			}
+		});
+	}
+	if (!Recorded) {
+		if (!__Sample_Take(_NewSize, _addr._Count))
+			return;
+		_addr._Stack = __Stack_Capture();
+	}
+	_addr._Size = _msize_stat_l(_ret);
+	__Stat_Shard &Shard = __StatShardOf(_ret);
+	Synchronized(Shard.Lock, __Alloc_Record(Shard, _ret, _addr, _Op));
+}
 
 #else//STATMM_LT
 
@@ -227,6 +490,9 @@ static UINT64 __Dealloc_Wild = 0;
 
 static TSyncInt __Alloc_Size = 0;
 
+inline static size_t __Tracked_Size(void *_Memory)
+{ return _Memory ? _msize_stat_l(_Memory) : 0; }
+
 #endif//STATMM_LT
 
 _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_Size) void *__CRTDECL _malloc_stat(
@@ -239,27 +505,18 @@ _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_Size) void *__CRTDECL
 #endif
 	) {
 	if (void *_ret = _malloc_stat_l(_Size)) {
-		size_t _size = _msize_stat_l(_ret);
 #ifndef STATMM_LT
-		auto Lock = StatLock->SyncLock();
-		__Alloc_Rec _addr{_Filename, _LineNumber, _size};
-		auto idxiter = __Alloc_Map->find(_addr);
-		if (idxiter != __Alloc_Map->end()) {
-			*const_cast<size_t*>(&idxiter->first._Size) += _size;
-			idxiter->second++;
-		} else
-			__Alloc_Map->insert(make_pair(_addr, 1));
-		__Alloc_Count++;
-
-		auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-		if (!insrec.second) {
-			FAIL(_T("{malloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-				 insrec.first->second._Filename, insrec.first->second._LineNumber,
-				 _Filename, _LineNumber);
+		// Sample by the requested size, only sampled blocks are size queried
+		size_t _Count;
+		if (__Sample_Take(_Size, _Count)) {
+			__Alloc_Rec _addr{_Filename, _LineNumber, _msize_stat_l(_ret), _Count, __Stack_Capture()};
+			__Stat_Shard &Shard = __StatShardOf(_ret);
+			auto Lock = Shard.Lock.SyncLock();
+			__Alloc_Record(Shard, _ret, _addr, _T("malloc"));
 		}
-		__Alloc_Cumulative += _size;
+#else
+		__Alloc_Size += _msize_stat_l(_ret);
 #endif//STATMM_LT
-		__Alloc_Size += _size;
 		return _ret;
 	}
 	return nullptr;
@@ -277,27 +534,18 @@ _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_Count*_Size) void *__C
 #endif
 	) {
 	if (void *_ret = _calloc_stat_l(_Count, _Size)) {
-		size_t _size = _msize_stat_l(_ret);
 #ifndef STATMM_LT
-		auto Lock = StatLock->SyncLock();
-		__Alloc_Rec _addr{_Filename, _LineNumber, _size};
-		auto idxiter = __Alloc_Map->find(_addr);
-		if (idxiter != __Alloc_Map->end()) {
-			*const_cast<size_t*>(&idxiter->first._Size) += _size;
-			idxiter->second++;
-		} else
-			__Alloc_Map->insert(make_pair(_addr, 1));
-		__Alloc_Count++;
-
-		auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-		if (!insrec.second) {
-			FAIL(_T("{calloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-				 insrec.first->second._Filename, insrec.first->second._LineNumber,
-				 _Filename, _LineNumber);
+		// Sample by the requested size, only sampled blocks are size queried
+		size_t _Weight;
+		if (__Sample_Take(_Count * _Size, _Weight)) {
+			__Alloc_Rec _addr{_Filename, _LineNumber, _msize_stat_l(_ret), _Weight, __Stack_Capture()};
+			__Stat_Shard &Shard = __StatShardOf(_ret);
+			auto Lock = Shard.Lock.SyncLock();
+			__Alloc_Record(Shard, _ret, _addr, _T("calloc"));
 		}
-		__Alloc_Cumulative += _size;
+#else
+		__Alloc_Size += _msize_stat_l(_ret);
 #endif//STATMM_LT
-		__Alloc_Size += _size;
 		return _ret;
 	}
 	return nullptr;
@@ -308,73 +556,13 @@ _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_NewSize) void *__CRTDE
 _Pre_maybenull_ _Post_invalid_ void * _Memory,
 _In_ size_t _NewSize
 ) {
-	size_t _OldSize = _Memory ? _msize_stat_l(_Memory) : 0;
+	size_t _OldSize = __Tracked_Size(_Memory);
 	if (void *_ret = _realloc_stat_l(_Memory, _NewSize)) {
-		size_t _size = _ret ? _msize_stat_l(_ret) : 0;
 #ifndef STATMM_LT
-		auto Lock = StatLock->SyncLock();
-		bool Wild = false;
-		if (_Memory != _ret) {
-			if (_Memory) {
-				auto iter = __Dealloc_Map->find(_Memory);
-				if (iter != __Dealloc_Map->end()) {
-					DEBUGV(if (iter->second._Size != _OldSize)
-						   FAIL(_T("{realloc} Allocation deallocation size unbalanced '%s (%d)' (%d != %d)"),
-						   iter->second._Filename, iter->second._LineNumber, (int)iter->second._Size, (int)_OldSize);
-					);
-
-					if (_ret == nullptr) {
-						auto cntiter = __Alloc_Map->find(iter->second);
-						if (cntiter == __Alloc_Map->end())
-							FAIL(_T("Missing allocation record"));
-						if (--cntiter->second == 0) {
-							__Alloc_Map->erase(cntiter);
-						} else {
-							*const_cast<size_t*>(&cntiter->first._Size) += _size - _OldSize;
-						}
-					} else {
-						__Alloc_Count++;
-						__Alloc_Rec _addr{iter->second._Filename, iter->second._LineNumber, _size};
-						auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-						if (!insrec.second) {
-							FAIL(_T("{realloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-								 insrec.first->second._Filename, insrec.first->second._LineNumber,
-								 _addr._Filename, _addr._LineNumber);
-						}
-					}
-					__Dealloc_Map->erase(iter);
-					__Dealloc_Count++;
-				} else {
-					Wild = true;
-					__Dealloc_Wild++;
-				}
-			} else {
-				if (_ret != nullptr) {
-					__Alloc_Rec _addr{nullptr, 0, _size};
-					auto idxiter = __Alloc_Map->find(_addr);
-					if (idxiter != __Alloc_Map->end()) {
-						*const_cast<size_t*>(&idxiter->first._Size) += _size;
-						idxiter->second++;
-					} else
-						__Alloc_Map->insert(make_pair(_addr, 1));
-					__Alloc_Count++;
-
-					auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-					if (!insrec.second) {
-						FAIL(_T("{realloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-							 insrec.first->second._Filename, insrec.first->second._LineNumber,
-							 _addr._Filename, _addr._LineNumber);
-					}
-				}
-			}
-		}
-		if (!Wild) {
-			__Dealloc_Cumulative += _OldSize;
-			__Alloc_Cumulative += _size;
-		}
-		if (!Wild)
+		__Realloc_Record(_Memory, _OldSize, _ret, _NewSize, nullptr, 0, _T("realloc"));
+#else
+		__Alloc_Size += _msize_stat_l(_ret) - _OldSize;
 #endif//STATMM_LT
-			__Alloc_Size += _size - _OldSize;
 		return _ret;
 	}
 	return nullptr;
@@ -386,73 +574,13 @@ _Pre_maybenull_ _Post_invalid_ void * _Memory,
 _In_ size_t _NumOfElements,
 _In_ size_t _SizeOfElements
 ) {
-	size_t _OldSize = _Memory ? _msize_stat_l(_Memory) : 0;
+	size_t _OldSize = __Tracked_Size(_Memory);
 	if (void *_ret = _recalloc_stat_l(_Memory, _NumOfElements, _SizeOfElements)) {
-		size_t _size = _ret ? _msize_stat_l(_ret) : 0;
 #ifndef STATMM_LT
-		auto Lock = StatLock->SyncLock();
-		bool Wild = false;
-		if (_Memory != _ret) {
-			if (_Memory) {
-				auto iter = __Dealloc_Map->find(_Memory);
-				if (iter != __Dealloc_Map->end()) {
-					DEBUGV(if (iter->second._Size != _OldSize)
-						   FAIL(_T("{recalloc} Allocation deallocation size unbalanced '%s (%d)' (%d != %d)"),
-						   iter->second._Filename, iter->second._LineNumber, (int)iter->second._Size, (int)_OldSize);
-					);
-
-					if (_ret == nullptr) {
-						auto cntiter = __Alloc_Map->find(iter->second);
-						if (cntiter == __Alloc_Map->end())
-							FAIL(_T("Missing allocation record"));
-						if (--cntiter->second == 0) {
-							__Alloc_Map->erase(cntiter);
-						} else {
-							*const_cast<size_t*>(&cntiter->first._Size) += _size - _OldSize;
-						}
-					} else {
-						__Alloc_Count++;
-						__Alloc_Rec _addr{iter->second._Filename, iter->second._LineNumber, _size};
-						auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-						if (!insrec.second) {
-							FAIL(_T("{recalloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-								 insrec.first->second._Filename, insrec.first->second._LineNumber,
-								 _addr._Filename, _addr._LineNumber);
-						}
-					}
-					__Dealloc_Map->erase(iter);
-					__Dealloc_Count++;
-				} else {
-					Wild = true;
-					__Dealloc_Wild++;
-				}
-			} else {
-				if (_ret != nullptr) {
-					__Alloc_Rec _addr{nullptr, 0, _size};
-					auto idxiter = __Alloc_Map->find(_addr);
-					if (idxiter != __Alloc_Map->end()) {
-						*const_cast<size_t*>(&idxiter->first._Size) += _size;
-						idxiter->second++;
-					} else
-						__Alloc_Map->insert(make_pair(_addr, 1));
-					__Alloc_Count++;
-
-					auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-					if (!insrec.second) {
-						FAIL(_T("{recalloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-							 insrec.first->second._Filename, insrec.first->second._LineNumber,
-							 _addr._Filename, _addr._LineNumber);
-					}
-				}
-			}
-		}
-		if (!Wild) {
-			__Dealloc_Cumulative += _OldSize;
-			__Alloc_Cumulative += _size;
-		}
-		if (!Wild)
+		__Realloc_Record(_Memory, _OldSize, _ret, _NumOfElements * _SizeOfElements, nullptr, 0, _T("recalloc"));
+#else
+		__Alloc_Size += _msize_stat_l(_ret) - _OldSize;
 #endif//STATMM_LT
-			__Alloc_Size += _size - _OldSize;
 		return _ret;
 	}
 	return nullptr;
@@ -462,25 +590,18 @@ _Check_return_ _Ret_maybenull_ _Post_writable_byte_size_(_NewSize) void *__CRTDE
 	_Pre_notnull_ void * _Memory,
 	_In_ size_t _NewSize
 	) {
-	size_t _OldSize = _Memory ? _msize_stat_l(_Memory) : 0;
+	size_t _OldSize = __Tracked_Size(_Memory);
 	if (void *_ret = _expand_stat_l(_Memory, _NewSize)) {
-		size_t _size = _msize_stat_l(_ret);
 #ifndef STATMM_LT
-		auto Lock = StatLock->SyncLock();
 		DEBUGV(if (_Memory != _ret) FAIL(_T("Expansion changes allocation record")));
-		auto iter = __Dealloc_Map->find(_Memory);
-		if (iter != __Dealloc_Map->end()) {
-			iter->second._Size += _size - _OldSize;
-			auto cntiter = __Alloc_Map->find(iter->second);
-			if (cntiter == __Alloc_Map->end())
-				FAIL(_T("Missing allocation record"));
-			*const_cast<size_t*>(&cntiter->first._Size) += _size - _OldSize;
-			__Dealloc_Cumulative += _OldSize;
-			__Alloc_Cumulative += _size;
-#endif//STATMM_LT
-			__Alloc_Size += _size - _OldSize;
-#ifndef STATMM_LT
+		if (!__Sample_Skip(_ret)) {
+			size_t _size = _msize_stat_l(_ret);
+			__Stat_Shard &Shard = __StatShardOf(_ret);
+			auto Lock = Shard.Lock.SyncLock();
+			__Alloc_Resize(Shard, _ret, _OldSize, _size);
 		}
+#else
+		__Alloc_Size += _msize_stat_l(_ret) - _OldSize;
 #endif//STATMM_LT
 		return _ret;
 	}
@@ -496,73 +617,9 @@ _In_ size_t _NewSize,
 _In_opt_z_ const TCHAR * _Filename,
 _In_ int _LineNumber
 ) {
-	size_t _OldSize = _Memory ? _msize_stat_l(_Memory) : 0;
+	size_t _OldSize = __Tracked_Size(_Memory);
 	if (void *_ret = _realloc_stat_l(_Memory, _NewSize)) {
-		size_t _size = _ret ? _msize_stat_l(_ret) : 0;
-#ifndef STATMM_LT
-		auto Lock = StatLock->SyncLock();
-		bool Wild = false;
-		if (_Memory != _ret) {
-			if (_Memory) {
-				auto iter = __Dealloc_Map->find(_Memory);
-				if (iter != __Dealloc_Map->end()) {
-					DEBUGV(if (iter->second._Size != _OldSize)
-						   FAIL(_T("{realloc} Allocation deallocation size unbalanced '%s (%d)' (%d != %d)"),
-						   iter->second._Filename, iter->second._LineNumber, (int)iter->second._Size, (int)_OldSize);
-					);
-
-					if (_ret == nullptr) {
-						auto cntiter = __Alloc_Map->find(iter->second);
-						if (cntiter == __Alloc_Map->end())
-							FAIL(_T("Missing allocation record"));
-						if (--cntiter->second == 0) {
-							__Alloc_Map->erase(cntiter);
-						} else {
-							*const_cast<size_t*>(&cntiter->first._Size) += _size - _OldSize;
-						}
-					} else {
-						__Alloc_Count++;
-						__Alloc_Rec _addr{iter->second._Filename, iter->second._LineNumber, _size};
-						auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-						if (!insrec.second) {
-							FAIL(_T("{realloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-								 insrec.first->second._Filename, insrec.first->second._LineNumber,
-								 _addr._Filename, _addr._LineNumber);
-						}
-					}
-					__Dealloc_Map->erase(iter);
-					__Dealloc_Count++;
-				} else {
-					Wild = true;
-					__Dealloc_Wild++;
-				}
-			} else {
-				if (_ret != nullptr) {
-					__Alloc_Rec _addr{_Filename, _LineNumber, _size};
-					auto idxiter = __Alloc_Map->find(_addr);
-					if (idxiter != __Alloc_Map->end()) {
-						*const_cast<size_t*>(&idxiter->first._Size) += _size;
-						idxiter->second++;
-					} else
-						__Alloc_Map->insert(make_pair(_addr, 1));
-					__Alloc_Count++;
-
-					auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-					if (!insrec.second) {
-						FAIL(_T("{realloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-							 insrec.first->second._Filename, insrec.first->second._LineNumber,
-							 _addr._Filename, _addr._LineNumber);
-					}
-				}
-			}
-		}
-		if (!Wild) {
-			__Dealloc_Cumulative += _OldSize;
-			__Alloc_Cumulative += _size;
-		}
-		if (!Wild)
-#endif//STATMM_LT
-			__Alloc_Size += _size - _OldSize;
+		__Realloc_Record(_Memory, _OldSize, _ret, _NewSize, _Filename, _LineNumber, _T("realloc"));
 		return _ret;
 	}
 	return nullptr;
@@ -576,73 +633,9 @@ _In_ size_t _SizeOfElements,
 _In_opt_z_ const TCHAR * _Filename,
 _In_ int _LineNumber
 ) {
-	size_t _OldSize = _Memory ? _msize_stat_l(_Memory) : 0;
+	size_t _OldSize = __Tracked_Size(_Memory);
 	if (void *_ret = _recalloc_stat_l(_Memory, _NumOfElements, _SizeOfElements)) {
-		size_t _size = _ret ? _msize_stat_l(_ret) : 0;
-#ifndef STATMM_LT
-		auto Lock = StatLock->SyncLock();
-		bool Wild = false;
-		if (_Memory != _ret) {
-			if (_Memory) {
-				auto iter = __Dealloc_Map->find(_Memory);
-				if (iter != __Dealloc_Map->end()) {
-					DEBUGV(if (iter->second._Size != _OldSize)
-						   FAIL(_T("{recalloc} Allocation deallocation size unbalanced '%s (%d)' (%d != %d)"),
-						   iter->second._Filename, iter->second._LineNumber, (int)iter->second._Size, (int)_OldSize);
-					);
-
-					if (_ret == nullptr) {
-						auto cntiter = __Alloc_Map->find(iter->second);
-						if (cntiter == __Alloc_Map->end())
-							FAIL(_T("Missing allocation record"));
-						if (--cntiter->second == 0) {
-							__Alloc_Map->erase(cntiter);
-						} else {
-							*const_cast<size_t*>(&cntiter->first._Size) += _size - _OldSize;
-						}
-					} else {
-						__Alloc_Count++;
-						__Alloc_Rec _addr{iter->second._Filename, iter->second._LineNumber, _size};
-						auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-						if (!insrec.second) {
-							FAIL(_T("{recalloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-								 insrec.first->second._Filename, insrec.first->second._LineNumber,
-								 _addr._Filename, _addr._LineNumber);
-						}
-					}
-					__Dealloc_Map->erase(iter);
-					__Dealloc_Count++;
-				} else {
-					Wild = true;
-					__Dealloc_Wild++;
-				}
-			} else {
-				if (_ret != nullptr) {
-					__Alloc_Rec _addr{_Filename, _LineNumber, _size};
-					auto idxiter = __Alloc_Map->find(_addr);
-					if (idxiter != __Alloc_Map->end()) {
-						*const_cast<size_t*>(&idxiter->first._Size) += _size;
-						idxiter->second++;
-					} else
-						__Alloc_Map->insert(make_pair(_addr, 1));
-					__Alloc_Count++;
-
-					auto insrec = __Dealloc_Map->insert(make_pair(_ret, _addr));
-					if (!insrec.second) {
-						FAIL(_T("{recalloc} Duplicate allocation record '%s (%d)' -> '%s (%d)'"),
-							 insrec.first->second._Filename, insrec.first->second._LineNumber,
-							 _addr._Filename, _addr._LineNumber);
-					}
-				}
-			}
-		}
-		if (!Wild) {
-			__Dealloc_Cumulative += _OldSize;
-			__Alloc_Cumulative += _size;
-		}
-		if (!Wild)
-#endif//STATMM_LT
-			__Alloc_Size += _size - _OldSize;
+		__Realloc_Record(_Memory, _OldSize, _ret, _NumOfElements * _SizeOfElements, _Filename, _LineNumber, _T("recalloc"));
 		return _ret;
 	}
 	return nullptr;
@@ -654,35 +647,16 @@ void __CRTDECL _free_stat_h(
 	_Pre_maybenull_ _Post_invalid_ void * _Memory
 	) {
 	if (_Memory) {
-		size_t _OldSize = _msize_stat_l(_Memory);
 #ifndef STATMM_LT
-		auto Lock = StatLock->SyncLock();
-		bool Wild = false;
-		auto iter = __Dealloc_Map->find(_Memory);
-		if (iter != __Dealloc_Map->end()) {
-			DEBUGV(if (iter->second._Size != _OldSize)
-				   FAIL(_T("{free} Allocation deallocation size unbalanced '%s (%d)' (%d != %d)"),
-				   iter->second._Filename, iter->second._LineNumber, (int)iter->second._Size, (int)_OldSize);
-			);
-
-			auto cntiter = __Alloc_Map->find(iter->second);
-			if (cntiter == __Alloc_Map->end())
-				FAIL(_T("Missing allocation record"));
-			if (--cntiter->second == 0) {
-				__Alloc_Map->erase(cntiter);
-			} else {
-				*const_cast<size_t*>(&cntiter->first._Size) -= _OldSize;
-			}
-			__Dealloc_Map->erase(iter);
-			__Dealloc_Count++;
-			__Dealloc_Cumulative += _OldSize;
-		} else {
-			Wild = true;
-			__Dealloc_Wild++;
+		// Unsampled blocks skip size query and locking
+		if (!__Sample_Skip(_Memory)) {
+			size_t _OldSize = _msize_stat_l(_Memory);
+			__Stat_Shard &Shard = __StatShardOf(_Memory);
+			Synchronized(Shard.Lock, __Alloc_Unrecord(Shard, _Memory, _OldSize, nullptr, _T("free")));
 		}
-		if (!Wild)
+#else
+		__Alloc_Size -= _msize_stat_l(_Memory);
 #endif//STATMM_LT
-			__Alloc_Size -= _OldSize;
 		_free_stat_l(_Memory);
 	}
 }
@@ -910,32 +884,20 @@ void __CRTDECL _free_stat_x(
 	_In_ int _LineNumber
 	) {
 	if (_Memory) {
-		size_t _OldSize = _msize_stat_l(_Memory);
-#ifndef STATMM_LT
-		auto Lock = StatLock->SyncLock();
-		auto iter = __Dealloc_Map->find(_Memory);
-		if (iter == __Dealloc_Map->end())
-			FAIL(_T("Missing allocation record"));
-
-		DEBUGV(if (iter->second._Size != _OldSize)
-			   FAIL(_T("{free} Allocation deallocation size unbalanced '%s (%d)' (%d != %d)"),
-			   iter->second._Filename, iter->second._LineNumber, (int)iter->second._Size, (int)_OldSize);
-		);
-
-		DEBUGV(if (iter->second != __Alloc_Rec{_Filename, _LineNumber}) FAIL(_T("Free site different from allocation")));
-		auto cntiter = __Alloc_Map->find(iter->second);
-		if (cntiter == __Alloc_Map->end())
-			FAIL(_T("Missing allocation record"));
-		if (--cntiter->second == 0) {
-			__Alloc_Map->erase(cntiter);
-		} else {
-			*const_cast<size_t*>(&cntiter->first._Size) -= _OldSize;
+		if (!__Sample_Skip(_Memory)) {
+			size_t _OldSize = _msize_stat_l(_Memory);
+			__Stat_Shard &Shard = __StatShardOf(_Memory);
+			Synchronized(Shard.Lock, {
+				DEBUGV({
+					auto iter = Shard.Dealloc_Map.find(_Memory);
+					if ((iter != Shard.Dealloc_Map.end()) &&
+						((iter->second._Filename != _Filename) || (iter->second._LineNumber != _LineNumber)))
+						FAIL(_T("Free site different from allocation"));
+				});
+				if (!__Alloc_Unrecord(Shard, _Memory, _OldSize, nullptr, _T("free")) && (__Sample_Rate == 0))
+					FAIL(_T("Missing allocation record"));
+			});
 		}
-		__Dealloc_Map->erase(_Memory);
-		__Dealloc_Count++;
-		__Dealloc_Cumulative += _OldSize;
-#endif//STATMM_LT
-		__Alloc_Size -= _OldSize;
 		free(_Memory);
 	}
 }
@@ -1095,27 +1057,96 @@ extern "C++" {
 
 void __MM_INIT(void) {
 	// These resources are never deallocated
-	StatLock = new (_malloc_stat_l(sizeof TLockableCS)) TLockableCS();
-	__Alloc_Map = new (_malloc_stat_l(sizeof TAlloc_Map)) TAlloc_Map();
-	__Dealloc_Map = new (_malloc_stat_l(sizeof TDealloc_Map)) TDealloc_Map();
+	BYTE* ShardBuf = (BYTE*)_malloc_stat_l(STATMM_SHARDS * __Stat_Shard_Stride + CACHE_LINE_SIZE);
+	__Stat_Shards = (BYTE*)(((UINT_PTR)ShardBuf + CACHE_LINE_SIZE - 1) & ~(UINT_PTR)(CACHE_LINE_SIZE - 1));
+	for (size_t Idx = 0; Idx < STATMM_SHARDS; Idx++)
+		new (&__StatShardAt(Idx)) __Stat_Shard();
+}
+
+// Merge counters (and optionally allocation site records) of all shards
+static void __Stat_Collect(_MM_Stats &Stats, UINT64 &Dealloc_Wild, TAlloc_Map *Alloc_Map) {
+	Dealloc_Wild = 0;
+	for (size_t Idx = 0; Idx < STATMM_SHARDS; Idx++) {
+		__Stat_Shard &Shard = __StatShardAt(Idx);
+		Synchronized(Shard.Lock, {
+			Stats.__Alloc_Size += Shard.Alloc_Size;
+			Stats.__Alloc_Count += (size_t)Shard.Alloc_Count;
+			Stats.__Dealloc_Count += (size_t)Shard.Dealloc_Count;
+			Stats.__Alloc_Cumulative += (size_t)Shard.Alloc_Cumulative;
+			Stats.__Dealloc_Cumulative += (size_t)Shard.Dealloc_Cumulative;
+			Dealloc_Wild += Shard.Dealloc_Wild;
+			if (Alloc_Map) {
+				for (auto &entry : Shard.Alloc_Map) {
+					auto insrec = Alloc_Map->insert(entry);
+					if (!insrec.second) {
+						*const_cast<size_t*>(&insrec.first->first._Size) += entry.first._Size;
+						insrec.first->second += entry.second;
+					}
+				}
+			}
+		});
+	}
 }
 
 size_t _MM_AllocSize(void) {
-	Synchronized((*StatLock), {
-		return __Alloc_Size;
-	});
+	size_t _ret = 0;
+	for (size_t Idx = 0; Idx < STATMM_SHARDS; Idx++) {
+		__Stat_Shard &Shard = __StatShardAt(Idx);
+		Synchronized(Shard.Lock, _ret += Shard.Alloc_Size);
+	}
+	return _ret;
+}
+
+void _MM_SetSampleRate(size_t Bytes) {
+	// Hold all shards, so no record changes while the filter is rebuilt and the mode switches
+	for (size_t Idx = 0; Idx < STATMM_SHARDS; Idx++)
+		__StatShardAt(Idx).Lock.__SyncLock();
+	if ((__Sample_Rate == 0) && (Bytes != 0)) {
+		memset((void*)__Sample_Filter, 0, sizeof(__Sample_Filter));
+		for (size_t Idx = 0; Idx < STATMM_SHARDS; Idx++) {
+			for (auto &entry : __StatShardAt(Idx).Dealloc_Map)
+				__SampleFilterOf(entry.first)++;
+		}
+	}
+	__Sample_Rate = Bytes;
+	for (size_t Idx = STATMM_SHARDS; Idx > 0; Idx--)
+		__StatShardAt(Idx - 1).Lock.__SyncUnlock();
+}
+
+size_t _MM_GetSampleRate(void) {
+	return __Sample_Rate;
+}
+
+void _MM_SetStackDepth(size_t Depth) {
+	__Stack_Depth = min(Depth, (size_t)STATMM_STACK_MAX);
+}
+
+size_t _MM_GetStackDepth(void) {
+	return __Stack_Depth;
 }
 
 _MM_Stats _MM_AllocStats(void) {
 	_MM_Stats _ret;
-	Synchronized((*StatLock), {
-		_ret.__Alloc_Size = __Alloc_Size;
-		_ret.__Alloc_Count = __Alloc_Count;
-		_ret.__Dealloc_Count = __Dealloc_Count;
-		_ret.__Alloc_Cumulative = __Alloc_Cumulative;
-		_ret.__Dealloc_Cumulative = __Dealloc_Cumulative;
-		return _ret;
-	});
+	UINT64 Dealloc_Wild;
+	__Stat_Collect(_ret, Dealloc_Wild, nullptr);
+	_ret.__Dealloc_Wild = (size_t)Dealloc_Wild;
+	return _ret;
+}
+
+_MM_Stats _MM_SiteStats(const TCHAR * Filename, int LineNumber) {
+	_MM_Stats _ret;
+	for (size_t Idx = 0; Idx < STATMM_SHARDS; Idx++) {
+		__Stat_Shard &Shard = __StatShardAt(Idx);
+		Synchronized(Shard.Lock, {
+			for (auto &entry : Shard.Alloc_Map) {
+				if ((entry.first._Filename == Filename) && (entry.first._LineNumber == LineNumber)) {
+					_ret.__Alloc_Size += entry.first._Size;
+					_ret.__Alloc_Count += entry.second;
+				}
+			}
+		});
+	}
+	return _ret;
 }
 
 static LPCTSTR _FormatSize(UINT64 Size, LPTSTR Buffer, size_t BufLen) {
@@ -1133,30 +1164,268 @@ static LPCTSTR _FormatSize(UINT64 Size, LPTSTR Buffer, size_t BufLen) {
 	return Buffer;
 }
 
+class __Stat_StackWalker : public StackWalker {
+public:
+	__Stat_StackWalker(void) : StackWalker(RetrieveSymbol | RetrieveLine | SymBuildPath) {}
+	virtual void OnOutput(LPCSTR szText) override {
+		TString TraceStr = UTF8toTString(szText);
+		if (TraceStr.length() > 1) {
+			TraceStr.pop_back();
+			LOG(_T("    %s"), TraceStr.c_str());
+		}
+	}
+};
+
+static void _DumpStack(UINT32 StackID, __Stat_StackWalker *&Walker) {
+	__Stack_Rec const &Rec = __Stack_Table[StackID - 1];
+	DWORD64 Addrs[STATMM_STACK_MAX];
+	for (WORD Idx = 0; Idx < Rec.Depth; Idx++)
+		Addrs[Idx] = (DWORD64)Rec.Frames[Idx];
+	// Symbols are only loaded when the first stack is printed
+	if (Walker == nullptr) Walker = new __Stat_StackWalker();
+	Walker->ShowAddresses(Addrs, Rec.Depth);
+}
+
 void _MM_DumpDetails(void) {
-	Synchronized((*StatLock), {
-		LOG(_T("========== Memory Manager Statistics =========="));
-		TCHAR STRBUF_Alloc[16]; TCHAR STRBUF_Dealloc[16]; TCHAR STRBUF_Occupy[16];
-		LOG(_T("Allocations: %s allocations, %s deallocations (%s occupied)"),
-			_FormatSize(__Alloc_Cumulative, STRBUF_Alloc, 16),
-			_FormatSize(__Dealloc_Cumulative, STRBUF_Dealloc, 16),
-			_FormatSize(__Alloc_Size, STRBUF_Occupy, 16));
-		LOG(_T("Operations: %lld allocations, %lld deallocations (%lld pending)"),
-			__Alloc_Count, __Dealloc_Count, __Alloc_Count - __Dealloc_Count);
-		if (__Dealloc_Wild > 0)
-			LOG(_T("Wild deallocations: %lld"), __Dealloc_Wild);
-		for (auto &entry : *__Alloc_Map) {
-			TCHAR STRBUF[16];
-			if (entry.first._Filename) {
-				LOG(_T("* %s (%d): %lld [%s]"),
-					entry.first._Filename, entry.first._LineNumber,
-					(UINT64)entry.second, _FormatSize(entry.first._Size, STRBUF, 16));
-			} else {
-				LOG(_T("* <Anonymous>: %lld [%s]"),
-					(UINT64)entry.second, _FormatSize(entry.first._Size, STRBUF, 16));
-			}
+	_MM_Stats Stats;
+	UINT64 Dealloc_Wild;
+	TAlloc_Map Alloc_Map;
+	__Stat_Collect(Stats, Dealloc_Wild, &Alloc_Map);
+
+	LOG(_T("========== Memory Manager Statistics =========="));
+	if (size_t Rate = __Sample_Rate) {
+		TCHAR STRBUF_Rate[16];
+		LOG(_T("Sampled every %s allocated on average, figures are estimates"), _FormatSize(Rate, STRBUF_Rate, 16));
+	}
+	TCHAR STRBUF_Alloc[16]; TCHAR STRBUF_Dealloc[16]; TCHAR STRBUF_Occupy[16];
+	LOG(_T("Allocations: %s allocations, %s deallocations (%s occupied)"),
+		_FormatSize(Stats.__Alloc_Cumulative, STRBUF_Alloc, 16),
+		_FormatSize(Stats.__Dealloc_Cumulative, STRBUF_Dealloc, 16),
+		_FormatSize(Stats.__Alloc_Size, STRBUF_Occupy, 16));
+	LOG(_T("Operations: %lld allocations, %lld deallocations (%lld pending)"),
+		(UINT64)Stats.__Alloc_Count, (UINT64)Stats.__Dealloc_Count, (UINT64)(Stats.__Alloc_Count - Stats.__Dealloc_Count));
+	if (Dealloc_Wild > 0)
+		LOG(_T("Wild deallocations: %lld"), Dealloc_Wild);
+	__Stat_StackWalker *Walker = nullptr;
+	for (auto &entry : Alloc_Map) {
+		TCHAR STRBUF[16];
+		if (entry.first._Filename) {
+			LOG(_T("* %s (%d): %lld [%s]"),
+				entry.first._Filename, entry.first._LineNumber,
+				(UINT64)entry.second, _FormatSize(entry.first._Size, STRBUF, 16));
+		} else {
+			LOG(_T("* <Anonymous>: %lld [%s]"),
+				(UINT64)entry.second, _FormatSize(entry.first._Size, STRBUF, 16));
 		}
+		if (entry.first._Stack)
+			_DumpStack(entry.first._Stack, Walker);
+	}
+	delete Walker;
+}
+
+// Snapshots hold merged allocation records sorted by site, so that two snapshots can be diffed in one pass
+// NOTE: Snapshot storage is allocated from the underlying memory manager, and is not recorded
+#define STATMM_SNAPSHOTS 16
+#define STATMM_SNAPSHOT_NAMELEN 64
+
+typedef vector<__Alloc_Rec, malloc_allocator<__Alloc_Rec>> TSnapshot_Recs;
+
+struct __Stat_Snapshot {
+	TCHAR Name[STATMM_SNAPSHOT_NAMELEN];
+	Flatten_FILETIME Time;
+	_MM_Stats Stats;
+	TSnapshot_Recs Recs;
+};
+
+static bool __Alloc_Rec_Less(__Alloc_Rec const &A, __Alloc_Rec const &B) {
+	if (A._Filename != B._Filename) return A._Filename < B._Filename;
+	if (A._LineNumber != B._LineNumber) return A._LineNumber < B._LineNumber;
+	return A._Stack < B._Stack;
+}
+
+static TLockableCS __Snapshot_Lock;
+static __Stat_Snapshot* __Snapshots[STATMM_SNAPSHOTS];
+
+static __Stat_Snapshot* __Snapshot_Create(LPCTSTR Name) {
+	void *Buffer = _malloc_stat_l(sizeof(__Stat_Snapshot));
+	if (Buffer == nullptr)
+		FAIL(_T("Unable to allocate snapshot '%s'"), Name);
+	__Stat_Snapshot *Ret = new (Buffer) __Stat_Snapshot();
+	_tcsncpy_s(Ret->Name, Name, _TRUNCATE);
+	GetSystemTimeAsFileTime(&Ret->Time.FileTime);
+
+	UINT64 Dealloc_Wild;
+	TAlloc_Map Alloc_Map;
+	__Stat_Collect(Ret->Stats, Dealloc_Wild, &Alloc_Map);
+	// Key size holds the total size of a site, count goes into the record as well
+	Ret->Recs.reserve(Alloc_Map.size());
+	for (auto &entry : Alloc_Map) {
+		Ret->Recs.push_back(entry.first);
+		Ret->Recs.back()._Count = entry.second;
+	}
+	sort(Ret->Recs.begin(), Ret->Recs.end(), __Alloc_Rec_Less);
+	return Ret;
+}
+
+static void __Snapshot_Destroy(__Stat_Snapshot *Snapshot) {
+	if (Snapshot) {
+		Snapshot->~__Stat_Snapshot();
+		_free_stat_l(Snapshot);
+	}
+}
+
+static LPCTSTR _FormatDelta(INT64 Delta, LPTSTR Buffer, size_t BufLen) {
+	Buffer[0] = (Delta < 0) ? _T('-') : _T('+');
+	_FormatSize(_abs64(Delta), Buffer + 1, BufLen - 1);
+	return Buffer;
+}
+
+struct __Snapshot_Delta {
+	__Alloc_Rec const *Rec;
+	INT64 Size;
+	INT64 Count;
+};
+
+static void __Snapshot_Compare(__Stat_Snapshot const &From, __Stat_Snapshot const &To) {
+	typedef vector<__Snapshot_Delta, malloc_allocator<__Snapshot_Delta>> TSnapshot_Deltas;
+	TSnapshot_Deltas Deltas;
+	auto FromIter = From.Recs.begin();
+	auto ToIter = To.Recs.begin();
+	while ((FromIter != From.Recs.end()) || (ToIter != To.Recs.end())) {
+		if ((ToIter == To.Recs.end()) || ((FromIter != From.Recs.end()) && __Alloc_Rec_Less(*FromIter, *ToIter))) {
+			Deltas.push_back({&*FromIter, -(INT64)FromIter->_Size, -(INT64)FromIter->_Count});
+			FromIter++;
+		} else if ((FromIter == From.Recs.end()) || __Alloc_Rec_Less(*ToIter, *FromIter)) {
+			Deltas.push_back({&*ToIter, (INT64)ToIter->_Size, (INT64)ToIter->_Count});
+			ToIter++;
+		} else {
+			if ((FromIter->_Size != ToIter->_Size) || (FromIter->_Count != ToIter->_Count))
+				Deltas.push_back({&*ToIter, (INT64)ToIter->_Size - (INT64)FromIter->_Size,
+								 (INT64)ToIter->_Count - (INT64)FromIter->_Count});
+			FromIter++;
+			ToIter++;
+		}
+	}
+	// Largest growth first
+	sort(Deltas.begin(), Deltas.end(), [](__Snapshot_Delta const &A, __Snapshot_Delta const &B) {
+		return A.Size > B.Size;
 	});
+
+	LOG(_T("======== Memory Manager Statistics Changes ========"));
+	LOG(_T("'%s' -> '%s' (%.1f sec)"), From.Name, To.Name,
+		(double)((INT64)To.Time.U64 - (INT64)From.Time.U64) / MSTime_o100ns / MSTime_aSecond);
+	TCHAR STRBUF_Occupy[16];
+	LOG(_T("| Occupied: %s, pending allocations: %+lld"),
+		_FormatDelta((INT64)To.Stats.__Alloc_Size - (INT64)From.Stats.__Alloc_Size, STRBUF_Occupy, 16),
+		((INT64)To.Stats.__Alloc_Count - (INT64)To.Stats.__Dealloc_Count) -
+		((INT64)From.Stats.__Alloc_Count - (INT64)From.Stats.__Dealloc_Count));
+
+	__Stat_StackWalker *Walker = nullptr;
+	for (auto &Delta : Deltas) {
+		TCHAR STRBUF[16];
+		if (Delta.Rec->_Filename) {
+			LOG(_T("| %s (%d): %+lld (%s)"), Delta.Rec->_Filename, Delta.Rec->_LineNumber,
+				Delta.Count, _FormatDelta(Delta.Size, STRBUF, 16));
+		} else {
+			LOG(_T("| <Anonymous>: %+lld (%s)"), Delta.Count, _FormatDelta(Delta.Size, STRBUF, 16));
+		}
+		if (Delta.Rec->_Stack)
+			_DumpStack(Delta.Rec->_Stack, Walker);
+	}
+	delete Walker;
+}
+
+// NOTE: The following helpers must be called with the snapshot lock held
+
+// Find the slot of a named snapshot (nullptr if not found)
+static __Stat_Snapshot** __Snapshot_Find(LPCTSTR Name) {
+	for (size_t Idx = 0; Idx < STATMM_SNAPSHOTS; Idx++) {
+		if ((__Snapshots[Idx] != nullptr) && (_tcsncmp(__Snapshots[Idx]->Name, Name, STATMM_SNAPSHOT_NAMELEN - 1) == 0))
+			return &__Snapshots[Idx];
+	}
+	return nullptr;
+}
+
+static __Stat_Snapshot** __Snapshot_FindFree(void) {
+	for (size_t Idx = 0; Idx < STATMM_SNAPSHOTS; Idx++) {
+		if (__Snapshots[Idx] == nullptr)
+			return &__Snapshots[Idx];
+	}
+	return nullptr;
+}
+
+void _MM_TakeSnapshot(LPCTSTR Name) {
+	__Stat_Snapshot *Snapshot = __Snapshot_Create(Name);
+	auto Lock = __Snapshot_Lock.SyncLock();
+	__Stat_Snapshot **Slot = __Snapshot_Find(Name);
+	if (Slot == nullptr) Slot = __Snapshot_FindFree();
+	if (Slot == nullptr) {
+		__Snapshot_Destroy(Snapshot);
+		FAIL(_T("Too many snapshots (%d)"), STATMM_SNAPSHOTS);
+	}
+	__Snapshot_Destroy(*Slot);
+	*Slot = Snapshot;
+}
+
+void _MM_DropSnapshot(LPCTSTR Name) {
+	auto Lock = __Snapshot_Lock.SyncLock();
+	if (__Stat_Snapshot **Slot = __Snapshot_Find(Name)) {
+		__Snapshot_Destroy(*Slot);
+		*Slot = nullptr;
+	}
+}
+
+void _MM_CompareSnapshots(LPCTSTR From, LPCTSTR To) {
+	__Stat_Snapshot *Current = To ? nullptr : __Snapshot_Create(_T("<Current>"));
+	auto Lock = __Snapshot_Lock.SyncLock();
+	__Stat_Snapshot **FromSlot = __Snapshot_Find(From);
+	__Stat_Snapshot **ToSlot = To ? __Snapshot_Find(To) : &Current;
+	if ((FromSlot == nullptr) || (ToSlot == nullptr)) {
+		__Snapshot_Destroy(Current);
+		FAIL(_T("Snapshot '%s' not found"), FromSlot ? To : From);
+	}
+	__Snapshot_Compare(**FromSlot, **ToSlot);
+	__Snapshot_Destroy(Current);
+}
+
+// Periodic snapshot thread, compares each period with the previous one
+static DWORD volatile __Snapshot_Interval = 0;
+static HANDLE __Snapshot_Wake = NULL;
+static HANDLE __Snapshot_Thread = NULL;
+
+static DWORD WINAPI __SnapshotThread(LPVOID) {
+	__Stat_Snapshot *Prev = __Snapshot_Create(_T("<Previous Period>"));
+	while (true) {
+		WaitForSingleObject(__Snapshot_Wake, __Snapshot_Interval);
+		if (__Snapshot_Interval == 0) break;
+		__Stat_Snapshot *Curr = __Snapshot_Create(_T("<Current Period>"));
+		__Snapshot_Compare(*Prev, *Curr);
+		_tcsncpy_s(Curr->Name, _T("<Previous Period>"), _TRUNCATE);
+		__Snapshot_Destroy(Prev);
+		Prev = Curr;
+	}
+	__Snapshot_Destroy(Prev);
+	return 0;
+}
+
+void _MM_SetSnapshotInterval(unsigned long Interval) {
+	auto Lock = __Snapshot_Lock.SyncLock();
+	__Snapshot_Interval = Interval;
+	if (Interval != 0) {
+		if (__Snapshot_Thread == NULL) {
+			if (__Snapshot_Wake == NULL)
+				__Snapshot_Wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+			__Snapshot_Thread = CreateThread(nullptr, 0, &__SnapshotThread, nullptr, 0, nullptr);
+			if (__Snapshot_Thread == NULL)
+				FAIL(_T("Unable to create snapshot thread (%d)"), GetLastError());
+		} else
+			SetEvent(__Snapshot_Wake);
+	} else if (__Snapshot_Thread != NULL) {
+		SetEvent(__Snapshot_Wake);
+		WaitForSingleObject(__Snapshot_Thread, INFINITE);
+		CloseHandle(__Snapshot_Thread);
+		__Snapshot_Thread = NULL;
+	}
 }
 
 #else
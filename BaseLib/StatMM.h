@@ -35,6 +35,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @author Zhenyu Wu
  * @date Jan 16, 2014: Initial implementation
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Sampling mode
+ * @date Oct 17, 2026: Call stack attribution
+ * @date Oct 17, 2026: Heap snapshots and diffs
+ * @date Oct 17, 2026: Per-site statistics query
  **/
 
 #ifndef StatMM_H
@@ -531,10 +535,51 @@ struct _MM_Stats {
 	size_t __Dealloc_Count = 0;
 	size_t __Alloc_Cumulative = 0;
 	size_t __Dealloc_Cumulative = 0;
+	//! Deallocations of untracked blocks (only counted while tracking every allocation)
+	size_t __Dealloc_Wild = 0;
 };
 _MM_Stats _MM_AllocStats(void);
+
+/**
+ * Merge live allocation records of one allocation site (over all shards and call stacks)
+ * @note Only __Alloc_Size and __Alloc_Count are filled; Filename is matched by address
+ **/
+_MM_Stats _MM_SiteStats(const TCHAR * Filename, int LineNumber);
 void _MM_DumpDetails(void);
 
+/**
+ * Set the average number of allocated bytes between sampled allocations (0 to track every allocation)
+ * @note Can be changed at any time (default: STATMM_SAMPLE_RATE); blocks that were not sampled are
+ *       not tracked, so lowering the rate to 0 later reports them as wild deallocations
+ **/
+void _MM_SetSampleRate(size_t Bytes);
+size_t _MM_GetSampleRate(void);
+
+/**
+ * Set the number of return addresses captured per recorded allocation (0 to disable, at most 16)
+ * @note Allocations are attributed to both the allocation site and the call stack;
+ *       stacks are symbolized with StackWalker when dumping details (default: STATMM_STACK_DEPTH)
+ **/
+void _MM_SetStackDepth(size_t Depth);
+size_t _MM_GetStackDepth(void);
+
+/**
+ * Take a named snapshot of per-site allocation records (replacing the snapshot of the same name)
+ * @note At most 16 snapshots can be kept at the same time
+ **/
+void _MM_TakeSnapshot(const TCHAR * Name);
+void _MM_DropSnapshot(const TCHAR * Name);
+
+/**
+ * Print per-site growth (in counts and bytes) from one snapshot to another (or to current state if To is nullptr)
+ **/
+void _MM_CompareSnapshots(const TCHAR * From, const TCHAR * To = nullptr);
+
+/**
+ * Periodically print per-site growth since the previous period (in milliseconds, 0 to stop)
+ **/
+void _MM_SetSnapshotInterval(unsigned long Interval);
+
 #endif//STATMM_LT
 
 #endif//StatMM_H
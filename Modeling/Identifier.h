@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @author Zhenyu Wu
  * @date Sep 24, 2013: Uplift from a child project
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Read-only identifier lookups under shared lock
  **/
 
 #ifndef Identifier_H
@@ -104,7 +105,7 @@ class IIdentPool : public TLockable {
 	ENFORCE_DERIVE(IIdentifier, TIdentifier);
 protected:
 	typedef std::unordered_map<TKey, ManagedRef<TIdentifier>, TKeyHasher> _Idents;
-	TSyncObj<_Idents> Idents;
+	TSyncObj<_Idents, SimpleAllocator<_Idents>, TLockableSRW> Idents;
 
 	template<typename... Params>
 	bool _FindOrCreateIdent(_Idents& Pool, TKey const &xKey, ManagedRef<TIdentifier>& xMRef, Params&&... xParams) {
@@ -117,8 +118,8 @@ protected:
 		return (xMRef = (*iRet).second, false);
 	}
 
-	bool _FindIdent(_Idents& Pool, TKey const &xKey, ManagedRef<TIdentifier>& xMRef) {
-		_Idents::iterator iRet = Pool.find(xKey);
+	bool _FindIdent(_Idents const& Pool, TKey const &xKey, ManagedRef<TIdentifier>& xMRef) {
+		_Idents::const_iterator iRet = Pool.find(xKey);
 		if (iRet != Pool.end()) {
 			return (xMRef = (*iRet).second, true);
 		}
@@ -142,12 +143,17 @@ public:
 
 	template<typename... Params>
 	bool FindOrCreateIdent(TKey const &xKey, ManagedRef<TIdentifier>& xMRef, Params&&... xParams) {
+		{
+			// Most lookups hit, try without blocking other readers first
+			auto Pool(Idents.PickupShared());
+			if (_FindIdent(Pool, xKey, xMRef)) return false;
+		}
 		auto Pool(Idents.Pickup());
 		return _FindOrCreateIdent(Pool, xKey, xMRef, xParams...);
 	}
 
 	bool FindIdent(TKey const &xKey, ManagedRef<TIdentifier> &xMRef) {
-		auto Pool(Idents.Pickup());
+		auto Pool(Idents.PickupShared());
 		return _FindIdent(Pool, xKey, xMRef);
 	}
 
@@ -164,7 +170,7 @@ public:
 	}
 
 	size_t size(void) {
-		auto Pool(Idents.Pickup());
+		auto Pool(Idents.PickupShared());
 		return Pool->size();
 	}
 };
@@ -0,0 +1,289 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// [Threading] Fiber-based Asynchronous Tasks
+
+#include "BaseLib/MMSwitcher.h"
+
+#include "FiberScheduler.h"
+
+#define FSLogTag _T("F.Scheduler '%s'")
+#define FSLogHeader _T("{") FSLogTag _T("} ")
+
+//! Perform logging within a fiber scheduler
+#define FSLOG(s, ...) LOG(FSLogHeader s, Name.c_str(), __VA_ARGS__)
+#define FSLOGV(s, ...) LOGV(FSLogHeader s, Name.c_str(), __VA_ARGS__)
+#define FSLOGVV(s, ...) LOGVV(FSLogHeader s, Name.c_str(), __VA_ARGS__)
+
+struct TFiberScheduler::TFiber {
+	enum class Action {
+		Finished,
+		Yielded,
+		Waiting,
+	};
+
+	TFiberScheduler &Scheduler;
+	TFiberProc const Proc;
+	LPVOID Handle;
+	// Fiber of the driver thread to return to (updated on each resume)
+	LPVOID Driver;
+
+	Action NextAction;
+	HANDLE WaitObject;
+	DWORD WaitTimeout;
+	HANDLE WaitRegistration;
+	WaitResult WaitRet;
+	// Both the driver (registration done) and the wait callback must check in before resuming
+	LONG volatile WaitCheckIn;
+
+	TFiber(TFiberScheduler &xScheduler, TFiberProc const &xProc) :
+		Scheduler(xScheduler), Proc(xProc), Handle(nullptr), Driver(nullptr),
+		NextAction(Action::Finished), WaitObject(nullptr), WaitTimeout(INFINITE),
+		WaitRegistration(nullptr), WaitRet(WaitResult::Error), WaitCheckIn(0) {}
+};
+
+typedef TFiberScheduler::TFiber TFiber;
+
+// TLS (not __declspec(thread), whose address may be cached across fiber switches)
+static DWORD __FiberTLS = TlsAlloc();
+
+static inline TFiber* __CurrentFiber(void)
+{ return (__FiberTLS != TLS_OUT_OF_INDEXES) ? (TFiber*)TlsGetValue(__FiberTLS) : nullptr; }
+
+static VOID WINAPI __FiberProc(LPVOID Param) {
+	TFiber *Fiber = (TFiber*)Param;
+	try {
+		Fiber->Proc();
+	} catch (Exception *e) {
+		LOG(_T("{F.Scheduler '%s'} WARNING: Task terminated due to unhandled ZWUtils Exception - %s"),
+			Fiber->Scheduler.Name.c_str(), e->Why());
+		delete e;
+	} catch (std::exception &e) {
+		LOG(_T("{F.Scheduler '%s'} WARNING: Task terminated due to unhandled C++ Exception - %s"),
+			Fiber->Scheduler.Name.c_str(), UTF8toTString(e.what()).c_str());
+	} catch (...) {
+		// Must not propagate, there is nothing above a fiber's entry point
+		LOG(_T("{F.Scheduler '%s'} WARNING: Task terminated due to unhandled exception"),
+			Fiber->Scheduler.Name.c_str());
+	}
+	Fiber->NextAction = TFiber::Action::Finished;
+	SwitchToFiber(Fiber->Driver);
+}
+
+/**
+ * Driver thread, runs ready fibers until shutdown
+ **/
+class TFiberDriver : public TRunnable {
+protected:
+	TFiberScheduler &rScheduler;
+
+	void* Run(TWorkerThread &WorkerThread, void *NoUse) override;
+	void __Dispatch(TFiber *Fiber);
+	static VOID CALLBACK __WaitCallback(PVOID Param, BOOLEAN TimedOut);
+
+public:
+	TFiberDriver(TFiberScheduler &xScheduler) : rScheduler(xScheduler) {}
+};
+
+void* TFiberDriver::Run(TWorkerThread &WorkerThread, void *NoUse) {
+	LPVOID DriverFiber = ConvertThreadToFiber(nullptr);
+	if (DriverFiber == nullptr)
+		SYSFAIL(_T("Failed to convert driver thread '%s' to fiber"), WorkerThread.Name.c_str());
+
+	while (true) {
+		rScheduler.rReadySignal.WaitFor();
+		TFiber *Fiber = nullptr;
+		{
+			auto Ready(rScheduler.rReady.Pickup());
+			if (!Ready->empty()) {
+				Fiber = Ready->front();
+				Ready->pop_front();
+			}
+		}
+		if (Fiber == nullptr) {
+			// Shutdown signal
+			if (~rScheduler.rStopping) break;
+			continue;
+		}
+
+		Fiber->Driver = DriverFiber;
+		TlsSetValue(__FiberTLS, Fiber);
+		SwitchToFiber(Fiber->Handle);
+		TlsSetValue(__FiberTLS, nullptr);
+		__Dispatch(Fiber);
+	}
+
+	ConvertFiberToThread();
+	return nullptr;
+}
+
+VOID CALLBACK TFiberDriver::__WaitCallback(PVOID Param, BOOLEAN TimedOut) {
+	TFiber *Fiber = (TFiber*)Param;
+	Fiber->WaitRet = TimedOut ? WaitResult::TimedOut : WaitResult::Signaled;
+	if (InterlockedDecrement(&Fiber->WaitCheckIn) == 0)
+		Fiber->Scheduler.__Resume(Fiber);
+}
+
+void TFiberDriver::__Dispatch(TFiber *Fiber) {
+	switch (Fiber->NextAction) {
+		case TFiber::Action::Finished:
+			rScheduler.__Retire(Fiber);
+			break;
+
+		case TFiber::Action::Yielded:
+			rScheduler.__Resume(Fiber);
+			break;
+
+		case TFiber::Action::Waiting:
+			// The fiber is switched out, now it is safe to let the callback resume it
+			Fiber->WaitCheckIn = 2;
+			if (!RegisterWaitForSingleObject(&Fiber->WaitRegistration, Fiber->WaitObject, &__WaitCallback,
+				Fiber, Fiber->WaitTimeout, WT_EXECUTEONLYONCE)) {
+				Fiber->WaitRegistration = nullptr;
+				Fiber->WaitRet = WaitResult::Error;
+				rScheduler.__Resume(Fiber);
+			} else if (InterlockedDecrement(&Fiber->WaitCheckIn) == 0)
+				rScheduler.__Resume(Fiber);
+			break;
+	}
+}
+
+TFiberScheduler::TFiberScheduler(TString const &xName, size_t ThreadCount, SIZE_T StackSize) :
+	Name(xName), rLiveCount(0), rDrained(true, true), rStopping(FALSE), rStackSize(StackSize) {
+	if (__FiberTLS == TLS_OUT_OF_INDEXES)
+		FAIL(_T("{Scheduler %s} Fiber TLS not available"), Name.c_str());
+	if (ThreadCount == 0)
+		ThreadCount = 1;
+
+	rDriver = new TFiberDriver(*this);
+	for (size_t i = 0; i < ThreadCount; i++) {
+		rThreads.push_back(new TWorkerThread(TStringCast(Name << _T('#') << i), *rDriver, nullptr));
+	}
+	FSLOGV(_T("Started %d driver threads"), (int)ThreadCount);
+}
+
+TFiberScheduler::~TFiberScheduler(void) {
+	Shutdown();
+	for (auto Thread : rThreads)
+		delete Thread;
+	delete rDriver;
+}
+
+void TFiberScheduler::Spawn(TFiberProc const &Proc) {
+	TFiber *Current = __CurrentFiber();
+	// Tasks may still spawn sub-tasks while the scheduler drains
+	if (~rStopping && !(Current && (&Current->Scheduler == this)))
+		FAIL(_T("{Scheduler %s} Cannot spawn task after shutdown"), Name.c_str());
+
+	TFiber *Fiber = new TFiber(*this, Proc);
+	Fiber->Handle = CreateFiberEx(0, rStackSize, FIBER_FLAG_FLOAT_SWITCH, &__FiberProc, Fiber);
+	if (Fiber->Handle == nullptr) {
+		DWORD ErrCode = GetLastError();
+		delete Fiber;
+		SYSERRFAIL(ErrCode, _T("{Scheduler %s} Failed to create fiber"), Name.c_str());
+	}
+	// The count and the event must change together, or a racing retirement may leave them inconsistent
+	Synchronized(rLiveLock, {
+		if (rLiveCount++ == 0)
+			rDrained.Reset();
+	});
+	__Resume(Fiber);
+}
+
+void TFiberScheduler::__Resume(TFiber *Fiber) {
+	rReady.Pickup()->push_back(Fiber);
+	rReadySignal.Signal();
+}
+
+void TFiberScheduler::__Retire(TFiber *Fiber) {
+	DeleteFiber(Fiber->Handle);
+	delete Fiber;
+	Synchronized(rLiveLock, {
+		if (--rLiveCount == 0)
+			rDrained.Set();
+	});
+}
+
+bool TFiberScheduler::Drain(DWORD Timeout) {
+	if (InTask())
+		FAIL(_T("{Scheduler %s} Cannot drain from within a task"), Name.c_str());
+	return rDrained.WaitFor(Timeout) == WaitResult::Signaled;
+}
+
+void TFiberScheduler::Shutdown(void) {
+	if (InTask())
+		FAIL(_T("{Scheduler %s} Cannot shutdown from within a task"), Name.c_str());
+	if (rStopping.Exchange(TRUE)) return;
+	FSLOGV(_T("Shutting down..."));
+	Drain();
+	rReadySignal.Signal((LONG)rThreads.size());
+	for (auto Thread : rThreads)
+		Thread->WaitFor();
+	FSLOGV(_T("All driver threads stopped"));
+}
+
+bool TFiberScheduler::InTask(void) {
+	return __CurrentFiber() != nullptr;
+}
+
+WaitResult TFiberScheduler::Await(TWaitable const &Waitable, DWORD Timeout) {
+	TFiber *Fiber = __CurrentFiber();
+	// Nothing to gain from parking
+	if ((Fiber == nullptr) || (Timeout == 0))
+		return WaitSingle(Waitable, Timeout);
+
+	Fiber->WaitObject = Waitable.CreateWaitHandle();
+	Fiber->WaitTimeout = Timeout;
+	Fiber->NextAction = TFiber::Action::Waiting;
+	SwitchToFiber(Fiber->Driver);
+
+	// Resumed (possibly on another driver thread)
+	if (Fiber->WaitRegistration != nullptr) {
+		// Callback has completed its use of the registration, non-blocking unregister suffices
+		UnregisterWaitEx(Fiber->WaitRegistration, nullptr);
+		Fiber->WaitRegistration = nullptr;
+	}
+	CloseHandle(Fiber->WaitObject);
+	Fiber->WaitObject = nullptr;
+	return Fiber->WaitRet;
+}
+
+void TFiberScheduler::Reschedule(void) {
+	TFiber *Fiber = __CurrentFiber();
+	if (Fiber == nullptr) return;
+
+	Fiber->NextAction = TFiber::Action::Yielded;
+	SwitchToFiber(Fiber->Driver);
+}
+
+#undef FSLOG
+#undef FSLOGV
+#undef FSLOGVV
@@ -0,0 +1,177 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/**
+ * @addtogroup Threading Threading Support Utilities
+ * @file
+ * @brief Fiber-based Asynchronous Tasks
+ * @author Zhenyu Wu
+ * @date Oct 17, 2026: Initial implementation
+ **/
+
+#ifndef FiberScheduler_H
+#define FiberScheduler_H
+
+#include "BaseLib/Misc.h"
+
+#include "Threading.h"
+#include "SyncObjs.h"
+#include "SyncQueue.h"
+#include "SyncObjPool.h"
+#include "WorkerThread.h"
+
+#include <vector>
+#include <deque>
+#include <functional>
+
+//! Default reserved stack size of a fiber task
+#define FIBER_STACK_DEFAULT		(64 * 1024)
+//! Polling interval (ms) for awaiting queues without wakeup signals (SIGNAL_MODERATION)
+#define FIBER_POLL_INTERVAL		10
+
+class TFiberDriver;
+
+/**
+ * @ingroup Threading
+ * @brief Fiber task scheduler
+ *
+ * Runs many logical tasks, each on its own fiber, on a handful of driver threads.
+ * A task awaiting a waitable is parked (the wait is delegated to the system thread pool)
+ * and its driver thread moves on to other ready tasks.
+ * @note Tasks may resume on a different driver thread: do not hold locks, or rely on
+ *       thread-local states across awaits
+ * @note Mutexes are owned by threads, and cannot be awaited
+ **/
+class TFiberScheduler {
+	friend TFiberDriver;
+public:
+	typedef std::function<void(void)> TFiberProc;
+	struct TFiber;
+
+protected:
+	TSyncObj<std::deque<TFiber*>> rReady;
+	TSemaphore rReadySignal;
+	TLockableCS rLiveLock;
+	size_t rLiveCount;
+	TEvent rDrained;
+	TSyncBool rStopping;
+	SIZE_T const rStackSize;
+	TFiberDriver *rDriver;
+	std::vector<TWorkerThread*> rThreads;
+
+	void __Resume(TFiber *Fiber);
+	void __Retire(TFiber *Fiber);
+
+public:
+	TString const Name;
+
+	TFiberScheduler(TString const &xName, size_t ThreadCount = 1, SIZE_T StackSize = FIBER_STACK_DEFAULT);
+	~TFiberScheduler(void);
+
+	/**
+	 * Start a new task
+	 * @note Exceptions escaping the task are logged and discarded
+	 **/
+	void Spawn(TFiberProc const &Proc);
+
+	/**
+	 * Wait for all tasks to finish
+	 * @return Whether all tasks finished within the timeout
+	 **/
+	bool Drain(DWORD Timeout = INFINITE);
+
+	/**
+	 * Finish all tasks and stop the driver threads
+	 **/
+	void Shutdown(void);
+
+	/**
+	 * Check whether the caller is running as a fiber task
+	 **/
+	static bool InTask(void);
+
+	/**
+	 * Await a waitable object, parking the calling task
+	 * @note Outside of a task, simply blocks the calling thread
+	 **/
+	static WaitResult Await(TWaitable const &Waitable, DWORD Timeout = INFINITE);
+
+	/**
+	 * Let other ready tasks run (no-op outside of a task)
+	 **/
+	static void Reschedule(void);
+
+	/**
+	 * Dequeue an entry, parking the calling task while the queue is empty
+	 * @return Whether an entry was dequeued before timeout
+	 **/
+	template<class T, class Container>
+	static bool AwaitDequeue(TSyncQueue<T, Container> &Queue, T &Entry, DWORD Timeout = INFINITE);
+
+	/**
+	 * Acquire an object, parking the calling task while the pool is exhausted
+	 * @return The acquired object, nullptr if timed out
+	 **/
+	template<class T, class TAllocator>
+	static typename TSyncObjPool<T, TAllocator>::TSyncPoolObj* AwaitAcquire(TSyncObjPool<T, TAllocator> &Pool, DWORD Timeout = INFINITE);
+};
+
+template<class T, class Container>
+bool TFiberScheduler::AwaitDequeue(TSyncQueue<T, Container> &Queue, T &Entry, DWORD Timeout) {
+	TDeadline Deadline(Timeout);
+	while (!Queue.Dequeue(Entry, 0)) {
+		if (Deadline.Expired()) return false;
+		DWORD WaitTime = Deadline.WaitTime();
+#ifdef SIGNAL_MODERATION
+		// Entry signals are only delivered to blocked getters
+		if (WaitTime > FIBER_POLL_INTERVAL) WaitTime = FIBER_POLL_INTERVAL;
+#endif//SIGNAL_MODERATION
+		Await(Queue.EntriesWaitable(), WaitTime);
+	}
+	return true;
+}
+
+template<class T, class TAllocator>
+typename TSyncObjPool<T, TAllocator>::TSyncPoolObj* TFiberScheduler::AwaitAcquire(TSyncObjPool<T, TAllocator> &Pool, DWORD Timeout) {
+	TDeadline Deadline(Timeout);
+	while (true) {
+		if (auto Obj = Pool.Acquire(0))
+			return Obj;
+		if (Deadline.Expired()) return nullptr;
+		DWORD WaitTime = Deadline.WaitTime();
+#ifdef SIGNAL_MODERATION
+		if (WaitTime > FIBER_POLL_INTERVAL) WaitTime = FIBER_POLL_INTERVAL;
+#endif//SIGNAL_MODERATION
+		Await(Pool.AvailableWaitable(), WaitTime);
+	}
+}
+
+#endif //FiberScheduler_H
@@ -0,0 +1,215 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// [Threading] Lock Contention Profiler
+
+#include "BaseLib/MMSwitcher.h"
+
+#include "LockProfiler.h"
+
+#ifdef LOCK_PROFILING
+
+#include "BaseLib/DebugLog.h"
+#include "BaseLib/WinError.h"
+#include "SyncPrems.h"
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+static UINT64 __Profile_Freq(void) {
+	static UINT64 Freq = 0;
+	if (Freq == 0) {
+		LARGE_INTEGER Value;
+		QueryPerformanceFrequency(&Value);
+		Freq = Value.QuadPart;
+	}
+	return Freq;
+}
+
+// Registry lock is a premitive, to avoid profiling itself
+static TCriticalSection& __Profile_Lock(void) {
+	static TCriticalSection __IoFU_T;
+	return __IoFU_T;
+}
+static TLockProfile* volatile __Profile_List = nullptr;
+
+static HANDLE __Report_Thread = NULL;
+static HANDLE __Report_Wake = NULL;
+static DWORD volatile __Report_Interval = 0;
+
+inline int __Profile_Bucket(UINT64 Ticks) {
+	UINT64 Micros = Ticks * 1000000 / __Profile_Freq();
+	if (Micros == 0) return 0;
+	if (Micros >= (1ULL << (LOCKPROF_BUCKETS - 2))) return LOCKPROF_BUCKETS - 1;
+	unsigned long Index;
+	_BitScanReverse(&Index, (unsigned long)Micros);
+	return Index + 1;
+}
+
+UINT64 TLockProfile::Now(void) {
+	LARGE_INTEGER Value;
+	QueryPerformanceCounter(&Value);
+	return Value.QuadPart;
+}
+
+void TLockProfile::Clear(void) {
+	Acquisitions = SharedAcquisitions = Contended = 0;
+	TryAcquisitions = TryFailed = Releases = 0;
+	WaitTicks = HoldTicks = 0;
+	for (int i = 0; i < LOCKPROF_BUCKETS; i++)
+		WaitHist[i] = HoldHist[i] = 0;
+}
+
+TLockProfile* TLockProfile::Resolve(TString const &Name) {
+	__Profile_Lock().Enter();
+	TLockProfile *Ret = __Profile_List;
+	while ((Ret != nullptr) && (Ret->Name.compare(Name) != 0))
+		Ret = Ret->Next;
+	if (Ret == nullptr) {
+		Ret = new TLockProfile(Name);
+		Ret->Next = __Profile_List;
+		__Profile_List = Ret;
+	}
+	__Profile_Lock().Leave();
+	return Ret;
+}
+
+void TLockProfile::Acquired(bool xContended, UINT64 xWaitTicks, bool Shared) {
+	InterlockedIncrement64(Shared ? &SharedAcquisitions : &Acquisitions);
+	if (xContended) {
+		InterlockedIncrement64(&Contended);
+		InterlockedExchangeAdd64(&WaitTicks, xWaitTicks);
+	}
+	InterlockedIncrement(&WaitHist[__Profile_Bucket(xWaitTicks)]);
+}
+
+void TLockProfile::TryAcquired(bool Success, bool Shared) {
+	InterlockedIncrement64(&TryAcquisitions);
+	if (!Success) InterlockedIncrement64(&TryFailed);
+}
+
+void TLockProfile::Released(UINT64 xHoldTicks) {
+	InterlockedIncrement64(&Releases);
+	InterlockedExchangeAdd64(&HoldTicks, xHoldTicks);
+	InterlockedIncrement(&HoldHist[__Profile_Bucket(xHoldTicks)]);
+}
+
+static void __LogHistogram(LPCTSTR Title, LONG const volatile *Hist) {
+	TStringStream Line;
+	Line << Title;
+	for (int i = 0; i < LOCKPROF_BUCKETS; i++) {
+		if (Hist[i] == 0) continue;
+		if (i == 0) Line << _T(" <1us:");
+		else Line << _T(" <") << (1ULL << i) << _T("us:");
+		Line << Hist[i];
+	}
+	LOG(_T("%s"), Line.str().c_str());
+}
+
+void TLockProfile::Report(void) {
+	vector<TLockProfile*> Profiles;
+	__Profile_Lock().Enter();
+	for (TLockProfile *Profile = __Profile_List; Profile != nullptr; Profile = Profile->Next)
+		Profiles.push_back(Profile);
+	__Profile_Lock().Leave();
+
+	sort(Profiles.begin(), Profiles.end(), [](TLockProfile *A, TLockProfile *B) {
+		return A->WaitTicks > B->WaitTicks;
+	});
+
+	double TickUS = 1000000.0 / __Profile_Freq();
+	LOG(_T("======== Lock Contention Profile ========"));
+	for (TLockProfile *Profile : Profiles) {
+		LONGLONG Locks = Profile->Acquisitions + Profile->SharedAcquisitions;
+		if ((Locks == 0) && (Profile->TryAcquisitions == 0)) continue;
+		LONGLONG Contended = Profile->Contended;
+		LONGLONG Releases = Profile->Releases;
+		LOG(_T("%s: %lld locks (%lld shared), %lld contended (%.1f%%), %lld/%lld try failed"),
+			Profile->Name.c_str(), Locks, Profile->SharedAcquisitions, Contended,
+			Locks ? Contended * 100.0 / Locks : 0.0, Profile->TryFailed, Profile->TryAcquisitions);
+		LOG(_T("  Wait: %.3f ms total, %.2f us / contention; Hold: %.3f ms total, %.2f us / release"),
+			Profile->WaitTicks * TickUS / 1000, Contended ? Profile->WaitTicks * TickUS / Contended : 0.0,
+			Profile->HoldTicks * TickUS / 1000, Releases ? Profile->HoldTicks * TickUS / Releases : 0.0);
+		__LogHistogram(_T("  Wait histogram:"), Profile->WaitHist);
+		__LogHistogram(_T("  Hold histogram:"), Profile->HoldHist);
+	}
+	LOG(_T("========================================="));
+}
+
+void TLockProfile::Reset(void) {
+	__Profile_Lock().Enter();
+	for (TLockProfile *Profile = __Profile_List; Profile != nullptr; Profile = Profile->Next)
+		Profile->Clear();
+	__Profile_Lock().Leave();
+}
+
+static DWORD WINAPI __ReportThread(LPVOID) {
+	while (true) {
+		DWORD Interval = __Report_Interval;
+		if (Interval == 0) break;
+		if (WaitForSingleObject(__Report_Wake, Interval) == WAIT_TIMEOUT)
+			TLockProfile::Report();
+	}
+	return 0;
+}
+
+void TLockProfile::SetReportInterval(DWORD Interval) {
+	HANDLE StopThread = NULL;
+	__Profile_Lock().Enter();
+	__Report_Interval = Interval;
+	if (Interval != 0) {
+		if (__Report_Thread == NULL) {
+			if (__Report_Wake == NULL)
+				__Report_Wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+			__Report_Thread = CreateThread(nullptr, 0, &__ReportThread, nullptr, 0, nullptr);
+			if (__Report_Thread == NULL) {
+				__Profile_Lock().Leave();
+				SYSFAIL(_T("Unable to create lock profile report thread"));
+			}
+		} else
+			SetEvent(__Report_Wake);
+	} else {
+		StopThread = __Report_Thread;
+		__Report_Thread = NULL;
+	}
+	__Profile_Lock().Leave();
+
+	// Must not hold the registry lock, the report thread may be reporting
+	if (StopThread != NULL) {
+		SetEvent(__Report_Wake);
+		WaitForSingleObject(StopThread, INFINITE);
+		CloseHandle(StopThread);
+	}
+}
+
+#endif //LOCK_PROFILING
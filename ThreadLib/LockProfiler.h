@@ -0,0 +1,121 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/**
+ * @addtogroup Threading Threading Support Utilities
+ * @file
+ * @brief Lock Contention Profiler
+ * @author Zhenyu Wu
+ * @date Oct 17, 2026: Initial implementation
+ **/
+
+#ifndef LockProfiler_H
+#define LockProfiler_H
+
+#include "BaseLib/Misc.h"
+
+/**
+ * Lock profiling is opt-in, define LOCK_PROFILING in the project to enable
+ * Without it, all instrumentation compiles out
+ **/
+#ifdef LOCK_PROFILING
+#define LOCKPROF(s) s
+#else
+#define LOCKPROF(s)
+#endif
+
+#ifdef LOCK_PROFILING
+
+//! Number of log2 histogram buckets (in microseconds, the last bucket covers >= ~4 sec)
+#define LOCKPROF_BUCKETS 24
+
+/**
+ * @ingroup Threading
+ * @brief Lock contention profile
+ *
+ * Accumulated statistics of all locks sharing the same name
+ * Unnamed locks are accounted under their lockable class name
+ * @note Resolving a profile allocates memory, so locks taken by the memory manager must opt out
+ *       (see TLockable::__SyncProfileDisable)
+ **/
+class TLockProfile {
+protected:
+	TLockProfile *Next;
+
+	TLockProfile(TString const &xName) : Next(nullptr), Name(xName) { Clear(); }
+	void Clear(void);
+
+public:
+	TString const Name;
+
+	LONGLONG volatile Acquisitions;
+	LONGLONG volatile SharedAcquisitions;
+	LONGLONG volatile Contended;
+	LONGLONG volatile TryAcquisitions;
+	LONGLONG volatile TryFailed;
+	LONGLONG volatile Releases;
+	LONGLONG volatile WaitTicks;
+	LONGLONG volatile HoldTicks;
+	LONG volatile WaitHist[LOCKPROF_BUCKETS];
+	LONG volatile HoldHist[LOCKPROF_BUCKETS];
+
+	/**
+	 * Current high-resolution timestamp (in profiler ticks)
+	 **/
+	static UINT64 Now(void);
+
+	/**
+	 * Find or create the profile of given name
+	 * @note Profiles are never freed, use few distinct names
+	 **/
+	static TLockProfile* Resolve(TString const &Name);
+
+	void Acquired(bool xContended, UINT64 xWaitTicks, bool Shared);
+	void TryAcquired(bool Success, bool Shared);
+	void Released(UINT64 xHoldTicks);
+
+	/**
+	 * Log the statistics of all profiles, ordered by total wait time
+	 **/
+	static void Report(void);
+	/**
+	 * Clear the statistics of all profiles
+	 **/
+	static void Reset(void);
+	/**
+	 * Periodically report the statistics (in milliseconds, 0 to stop)
+	 **/
+	static void SetReportInterval(DWORD Interval);
+};
+
+#endif //LOCK_PROFILING
+
+#endif //LockProfiler_H
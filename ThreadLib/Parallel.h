@@ -0,0 +1,204 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/**
+ * @addtogroup Threading Threading Support Utilities
+ * @file
+ * @brief Parallel Loop Algorithms
+ * @author Zhenyu Wu
+ * @date Oct 17, 2026: Initial implementation
+ **/
+
+#ifndef Parallel_H
+#define Parallel_H
+
+#include "BaseLib/Misc.h"
+
+#include "Threading.h"
+#include "SyncObjs.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <exception>
+
+//! Number of chunks per worker targeted by automatic (minimum) grain sizing
+#define PARALLEL_CHUNKS_PER_WORKER 8
+
+/**
+ * @ingroup Threading
+ * @brief Fork-join counter for parallel algorithms
+ *
+ * Tracks outstanding sub-ranges, and keeps the first exception raised by any of them
+ * The joining caller holds a share of its own until it joins, so the count only drops
+ * to zero once, after all work is done
+ **/
+class TParallelJoin {
+protected:
+	TSyncInt rPending;
+	TEvent rFinished;
+	TLockableCS rErrorLock;
+	std::exception_ptr rError;
+
+public:
+	TParallelJoin(void) : rPending(1), rFinished(true, false) {}
+
+	void Fork(void)
+	{ rPending++; }
+	void Done(void) {
+		if (--rPending == 0)
+			rFinished.Set();
+	}
+
+	void Fail(std::exception_ptr const &Error) {
+		Synchronized(rErrorLock, {
+			if (!rError) rError = Error;
+		});
+	}
+
+	/**
+	 * Wait for all sub-ranges, running pending tasks meanwhile (on workers of the pool),
+	 * other threads simply block
+	 * @note Re-throws the first exception raised by any sub-range
+	 **/
+	void Join(TThreadPool &Pool) {
+		Done();
+		if (Pool.InWorker()) {
+			while (~rPending > 0) {
+				if (!Pool.HelpOne())
+					SwitchToThread();
+			}
+		}
+		// Also makes sure the last Done() is through with the event before it is destroyed
+		rFinished.WaitFor();
+		if (rError) std::rethrow_exception(rError);
+	}
+};
+
+/**
+ * Pick the minimum grain size: explicit if given, otherwise a few chunks per worker
+ **/
+template<typename TIndex>
+TIndex __ParallelGrain(TThreadPool &Pool, TIndex Begin, TIndex End, TIndex Grain) {
+	if (Grain > 0) return Grain;
+	Grain = (End - Begin) / (TIndex)(Pool.WorkerCount() * PARALLEL_CHUNKS_PER_WORKER);
+	return Grain > 0 ? Grain : 1;
+}
+
+template<typename TIndex, class TBody>
+void __ParallelFor_Split(TThreadPool &Pool, TParallelJoin &Join, TIndex Begin, TIndex End, TIndex Grain, TBody const &Body) {
+	try {
+		// Lazy splitting: hand the upper half to thieves only once the previous one was taken,
+		// otherwise nobody is looking for work, and the range is worked through grain by grain
+		while (End - Begin > Grain) {
+			if (!Pool.SpawnedTaken()) {
+				Body(Begin, Begin + Grain);
+				Begin += Grain;
+				continue;
+			}
+			TIndex Mid = Begin + (End - Begin) / 2;
+			Join.Fork();
+			try {
+				Pool.Spawn([&Pool, &Join, Mid, End, Grain, &Body] {
+					__ParallelFor_Split(Pool, Join, Mid, End, Grain, Body);
+					Join.Done();
+				});
+			} catch (...) {
+				Join.Done();
+				throw;
+			}
+			End = Mid;
+		}
+		Body(Begin, End);
+	} catch (...) {
+		Join.Fail(std::current_exception());
+	}
+}
+
+/**
+ * @ingroup Threading
+ * Run Body(SubBegin, SubEnd) over [Begin, End) on the pool workers
+ *
+ * The range is split in halves on demand, whenever the previously split off half has been
+ * picked up by an idle worker, but never below Grain; otherwise it is worked through
+ * in Grain sized steps. The caller takes part in the work and returns when all sub-ranges are done.
+ * Nesting is safe: waiting pool workers run pending tasks instead of blocking.
+ * @param Grain Smallest sub-range split off, and step of the local work (0 = automatic, a few chunks per worker)
+ * @note If any sub-range throws, the first exception is re-thrown to the caller
+ **/
+template<typename TIndex, class TBody>
+void ParallelFor(TThreadPool &Pool, TIndex Begin, TIndex End, TIndex Grain, TBody const &Body) {
+	if (End <= Begin) return;
+	Grain = __ParallelGrain(Pool, Begin, End, Grain);
+	// Not worth forking
+	if (End - Begin <= Grain) {
+		Body(Begin, End);
+		return;
+	}
+
+	TParallelJoin Join;
+	__ParallelFor_Split(Pool, Join, Begin, End, Grain, Body);
+	Join.Join(Pool);
+}
+
+/**
+ * @ingroup Threading
+ * Reduce Body(SubBegin, SubEnd) partial results over [Begin, End) on the pool workers
+ *
+ * The range is cut into Grain sized chunks, which are evaluated in parallel (see ParallelFor);
+ * the partial results are then combined in range order, so the result is deterministic
+ * even for non-associative operations (e.g. floating point sums).
+ * @param Grain Chunk size (0 = automatic, a few chunks per worker)
+ * @param Combine Binary operation: TValue(TValue const&, TValue const&)
+ * @note TValue must not be bool (partials are kept in a std::vector)
+ **/
+template<typename TIndex, typename TValue, class TBody, class TCombine>
+TValue ParallelReduce(TThreadPool &Pool, TIndex Begin, TIndex End, TIndex Grain,
+	TValue const &Identity, TBody const &Body, TCombine const &Combine) {
+	if (End <= Begin) return Identity;
+	Grain = __ParallelGrain(Pool, Begin, End, Grain);
+
+	TIndex Chunks = (End - Begin + Grain - 1) / Grain;
+	std::vector<TValue> Partials((size_t)Chunks, Identity);
+	ParallelFor(Pool, (TIndex)0, Chunks, (TIndex)1, [&](TIndex ChunkBegin, TIndex ChunkEnd) {
+		for (TIndex i = ChunkBegin; i < ChunkEnd; i++) {
+			TIndex SubBegin = Begin + i * Grain;
+			TIndex SubEnd = (End - SubBegin > Grain) ? SubBegin + Grain : End;
+			Partials[(size_t)i] = Body(SubBegin, SubEnd);
+		}
+	});
+
+	TValue Result = Identity;
+	for (auto &Partial : Partials)
+		Result = Combine(Result, Partial);
+	return Result;
+}
+
+#endif //Parallel_H
@@ -21,6 +21,8 @@
  *                     - Added example for doing an exception-callstack-walking in main.cpp
  *                       (thanks to owillebo: http://www.codeproject.com/script/profile/whos_who.asp?id=536268)
  *  2005-08-05   v5    - Removed most Lint (http://www.gimpel.com/) errors... thanks to Okko Willeboordse!
+ *  2026-10-17         - Factored out symbol resolution (ResolveEntry), added ShowAddresses
+ *                       for resolving previously captured return addresses
  *
  **********************************************************************/
 #include <windows.h>
@@ -896,9 +898,6 @@ BOOL StackWalker::ShowCallstack(HANDLE hThread, const CONTEXT *context, PReadPro
 {
   CONTEXT c;;
   CallstackEntry csEntry;
-  IMAGEHLP_SYMBOL64 *pSym = NULL;
-  StackWalkerInternal::IMAGEHLP_MODULE64_V2 Module;
-  IMAGEHLP_LINE64 Line;
   int frameNum;
 
   if (m_modulesLoaded == FALSE)
@@ -970,18 +969,6 @@ BOOL StackWalker::ShowCallstack(HANDLE hThread, const CONTEXT *context, PReadPro
 #error "Platform not supported!"
 #endif
 
-  pSym = (IMAGEHLP_SYMBOL64 *) malloc(sizeof(IMAGEHLP_SYMBOL64) + STACKWALK_MAX_NAMELEN);
-  if (!pSym) goto cleanup;  // not enough memory...
-  memset(pSym, 0, sizeof(IMAGEHLP_SYMBOL64) + STACKWALK_MAX_NAMELEN);
-  pSym->SizeOfStruct = sizeof(IMAGEHLP_SYMBOL64);
-  pSym->MaxNameLength = STACKWALK_MAX_NAMELEN;
-
-  memset(&Line, 0, sizeof(Line));
-  Line.SizeOfStruct = sizeof(Line);
-
-  memset(&Module, 0, sizeof(Module));
-  Module.SizeOfStruct = sizeof(Module);
-
   for (frameNum = 0; ; ++frameNum )
   {
     // get next stack frame (StackWalk64(), SymFunctionTableAccess64(), SymGetModuleBase64())
@@ -995,103 +982,12 @@ BOOL StackWalker::ShowCallstack(HANDLE hThread, const CONTEXT *context, PReadPro
       break;
     }
 
-    csEntry.offset = s.AddrPC.Offset;
-    csEntry.name[0] = 0;
-    csEntry.undName[0] = 0;
-    csEntry.undFullName[0] = 0;
-    csEntry.offsetFromSmybol = 0;
-    csEntry.offsetFromLine = 0;
-    csEntry.lineFileName[0] = 0;
-    csEntry.lineNumber = 0;
-    csEntry.loadedImageName[0] = 0;
-    csEntry.moduleName[0] = 0;
     if (s.AddrPC.Offset == s.AddrReturn.Offset)
     {
       this->OnDbgHelpErr("StackWalk64-Endless-Callstack!", 0, s.AddrPC.Offset);
       break;
     }
-    if (s.AddrPC.Offset != 0)
-    {
-      // we seem to have a valid PC
-      // show procedure info (SymGetSymFromAddr64())
-      if (this->m_sw->pSGSFA(this->m_hProcess, s.AddrPC.Offset, &(csEntry.offsetFromSmybol), pSym) != FALSE)
-      {
-        // TODO: Mache dies sicher...!
-        strcpy_s(csEntry.name, pSym->Name);
-        // UnDecorateSymbolName()
-        this->m_sw->pUDSN( pSym->Name, csEntry.undName, STACKWALK_MAX_NAMELEN, UNDNAME_NAME_ONLY );
-        this->m_sw->pUDSN( pSym->Name, csEntry.undFullName, STACKWALK_MAX_NAMELEN, UNDNAME_COMPLETE );
-      }
-      else
-      {
-        this->OnDbgHelpErr("SymGetSymFromAddr64", GetLastError(), s.AddrPC.Offset);
-      }
-
-      // show line number info, NT5.0-method (SymGetLineFromAddr64())
-      if (this->m_sw->pSGLFA != NULL )
-      { // yes, we have SymGetLineFromAddr64()
-        if (this->m_sw->pSGLFA(this->m_hProcess, s.AddrPC.Offset, &(csEntry.offsetFromLine), &Line) != FALSE)
-        {
-          csEntry.lineNumber = Line.LineNumber;
-          // TODO: Mache dies sicher...!
-          strcpy_s(csEntry.lineFileName, __RelPath(Line.FileName));
-        }
-        else
-        {
-          this->OnDbgHelpErr("SymGetLineFromAddr64", GetLastError(), s.AddrPC.Offset);
-        }
-      } // yes, we have SymGetLineFromAddr64()
-
-      // show module info (SymGetModuleInfo64())
-      if (this->m_sw->GetModuleInfo(this->m_hProcess, s.AddrPC.Offset, &Module ) != FALSE)
-      { // got module info OK
-        switch ( Module.SymType )
-        {
-        case SymNone:
-          csEntry.symTypeString = "-nosymbols-";
-          break;
-        case SymCoff:
-          csEntry.symTypeString = "COFF";
-          break;
-        case SymCv:
-          csEntry.symTypeString = "CV";
-          break;
-        case SymPdb:
-          csEntry.symTypeString = "PDB";
-          break;
-        case SymExport:
-          csEntry.symTypeString = "-exported-";
-          break;
-        case SymDeferred:
-          csEntry.symTypeString = "-deferred-";
-          break;
-        case SymSym:
-          csEntry.symTypeString = "SYM";
-          break;
-#if API_VERSION_NUMBER >= 9
-        case SymDia:
-          csEntry.symTypeString = "DIA";
-          break;
-#endif
-        case 8: //SymVirtual:
-          csEntry.symTypeString = "Virtual";
-          break;
-        default:
-          //_snprintf( ty, sizeof ty, "symtype=%ld", (long) Module.SymType );
-          csEntry.symTypeString = NULL;
-          break;
-        }
-
-        // TODO: Mache dies sicher...!
-        strcpy_s(csEntry.moduleName, Module.ModuleName);
-        csEntry.baseOfImage = Module.BaseOfImage;
-        strcpy_s(csEntry.loadedImageName, Module.LoadedImageName);
-      } // got module info OK
-      else
-      {
-        this->OnDbgHelpErr("SymGetModuleInfo64", GetLastError(), s.AddrPC.Offset);
-      }
-    } // we seem to have a valid PC
+    this->ResolveEntry(s.AddrPC.Offset, csEntry);
 
     CallstackEntryType et = nextEntry;
     if (frameNum == 0)
@@ -1106,15 +1002,147 @@ BOOL StackWalker::ShowCallstack(HANDLE hThread, const CONTEXT *context, PReadPro
     }
   } // for ( frameNum )
 
-  cleanup:
-    if (pSym) free( pSym );
-
   if (context == NULL)
     ResumeThread(hThread);
 
   return TRUE;
 }
 
+void StackWalker::ResolveEntry(DWORD64 addr, CallstackEntry &csEntry)
+{
+  BYTE symBuffer[sizeof(IMAGEHLP_SYMBOL64) + STACKWALK_MAX_NAMELEN];
+  IMAGEHLP_SYMBOL64 *pSym = (IMAGEHLP_SYMBOL64 *) symBuffer;
+  StackWalkerInternal::IMAGEHLP_MODULE64_V2 Module;
+  IMAGEHLP_LINE64 Line;
+
+  memset(pSym, 0, sizeof(symBuffer));
+  pSym->SizeOfStruct = sizeof(IMAGEHLP_SYMBOL64);
+  pSym->MaxNameLength = STACKWALK_MAX_NAMELEN;
+
+  memset(&Line, 0, sizeof(Line));
+  Line.SizeOfStruct = sizeof(Line);
+
+  memset(&Module, 0, sizeof(Module));
+  Module.SizeOfStruct = sizeof(Module);
+
+  csEntry.offset = addr;
+  csEntry.name[0] = 0;
+  csEntry.undName[0] = 0;
+  csEntry.undFullName[0] = 0;
+  csEntry.offsetFromSmybol = 0;
+  csEntry.offsetFromLine = 0;
+  csEntry.lineFileName[0] = 0;
+  csEntry.lineNumber = 0;
+  csEntry.loadedImageName[0] = 0;
+  csEntry.moduleName[0] = 0;
+  if (addr != 0)
+  {
+    // we seem to have a valid PC
+    // show procedure info (SymGetSymFromAddr64())
+    if (this->m_sw->pSGSFA(this->m_hProcess, addr, &(csEntry.offsetFromSmybol), pSym) != FALSE)
+    {
+      // TODO: Mache dies sicher...!
+      strcpy_s(csEntry.name, pSym->Name);
+      // UnDecorateSymbolName()
+      this->m_sw->pUDSN( pSym->Name, csEntry.undName, STACKWALK_MAX_NAMELEN, UNDNAME_NAME_ONLY );
+      this->m_sw->pUDSN( pSym->Name, csEntry.undFullName, STACKWALK_MAX_NAMELEN, UNDNAME_COMPLETE );
+    }
+    else
+    {
+      this->OnDbgHelpErr("SymGetSymFromAddr64", GetLastError(), addr);
+    }
+
+    // show line number info, NT5.0-method (SymGetLineFromAddr64())
+    if (this->m_sw->pSGLFA != NULL )
+    { // yes, we have SymGetLineFromAddr64()
+      if (this->m_sw->pSGLFA(this->m_hProcess, addr, &(csEntry.offsetFromLine), &Line) != FALSE)
+      {
+        csEntry.lineNumber = Line.LineNumber;
+        // TODO: Mache dies sicher...!
+        strcpy_s(csEntry.lineFileName, __RelPath(Line.FileName));
+      }
+      else
+      {
+        this->OnDbgHelpErr("SymGetLineFromAddr64", GetLastError(), addr);
+      }
+    } // yes, we have SymGetLineFromAddr64()
+
+    // show module info (SymGetModuleInfo64())
+    if (this->m_sw->GetModuleInfo(this->m_hProcess, addr, &Module ) != FALSE)
+    { // got module info OK
+      switch ( Module.SymType )
+      {
+      case SymNone:
+        csEntry.symTypeString = "-nosymbols-";
+        break;
+      case SymCoff:
+        csEntry.symTypeString = "COFF";
+        break;
+      case SymCv:
+        csEntry.symTypeString = "CV";
+        break;
+      case SymPdb:
+        csEntry.symTypeString = "PDB";
+        break;
+      case SymExport:
+        csEntry.symTypeString = "-exported-";
+        break;
+      case SymDeferred:
+        csEntry.symTypeString = "-deferred-";
+        break;
+      case SymSym:
+        csEntry.symTypeString = "SYM";
+        break;
+#if API_VERSION_NUMBER >= 9
+      case SymDia:
+        csEntry.symTypeString = "DIA";
+        break;
+#endif
+      case 8: //SymVirtual:
+        csEntry.symTypeString = "Virtual";
+        break;
+      default:
+        //_snprintf( ty, sizeof ty, "symtype=%ld", (long) Module.SymType );
+        csEntry.symTypeString = NULL;
+        break;
+      }
+
+      // TODO: Mache dies sicher...!
+      strcpy_s(csEntry.moduleName, Module.ModuleName);
+      csEntry.baseOfImage = Module.BaseOfImage;
+      strcpy_s(csEntry.loadedImageName, Module.LoadedImageName);
+    } // got module info OK
+    else
+    {
+      this->OnDbgHelpErr("SymGetModuleInfo64", GetLastError(), addr);
+    }
+  } // we seem to have a valid PC
+}
+
+BOOL StackWalker::ShowAddresses(const DWORD64 *addrs, int count)
+{
+  CallstackEntry csEntry;
+
+  if (m_modulesLoaded == FALSE)
+    this->LoadModules();  // ignore the result...
+
+  if (this->m_sw->m_hDbhHelp == NULL)
+  {
+    SetLastError(ERROR_DLL_INIT_FAILED);
+    return FALSE;
+  }
+
+  for (int frameNum = 0; frameNum < count; ++frameNum)
+  {
+    this->ResolveEntry(addrs[frameNum], csEntry);
+    this->OnCallstackEntry(frameNum == 0 ? firstEntry : nextEntry, csEntry);
+  }
+  if (count > 0)
+    this->OnCallstackEntry(lastEntry, csEntry);
+  SetLastError(ERROR_SUCCESS);
+  return TRUE;
+}
+
 BOOL __stdcall StackWalker::myReadProcMem(
     HANDLE      hProcess,
     DWORD64     qwBaseAddress,
@@ -89,6 +89,13 @@ public:
     LPVOID pUserData = NULL  // optional to identify some data in the 'readMemoryFunction'-callback
     );
 
+  // Resolve previously captured addresses (e.g. via RtlCaptureStackBackTrace),
+  // reported through OnCallstackEntry just like ShowCallstack
+  BOOL ShowAddresses(
+    const DWORD64 *addrs,
+    int count
+    );
+
 #if _MSC_VER >= 1300
 // due to some reasons, the "STACKWALK_MAX_NAMELEN" must be declared as "public" 
 // in older compilers in order to use it... starting with VC7 we can declare it as "protected"
@@ -123,6 +130,8 @@ protected:
   virtual void OnDbgHelpErr(LPCSTR szFuncName, DWORD gle, DWORD64 addr);
   virtual void OnOutput(LPCSTR szText);
 
+  void ResolveEntry(DWORD64 addr, CallstackEntry &entry);
+
   StackWalkerInternal *m_sw;
   HANDLE m_hProcess;
   DWORD m_dwProcessId;
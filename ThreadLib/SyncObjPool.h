@@ -35,23 +35,42 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @author Zhenyu Wu
  * @date Aug 02, 2013: Initial implementation
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Per-thread object magazines
+ * @date Oct 17, 2026: Slab allocation mode
+ * @date Oct 17, 2026: Named lock profiles
+ * @date Oct 17, 2026: Object availability waitable
+ * @date Oct 17, 2026: Packed payload array and exception safety for slabs
+ * @date Oct 17, 2026: Monotonic deadline for return lock
  **/
 
 #ifndef SyncObjPool_H
 #define SyncObjPool_H
 
+#include <vector>
+#include <type_traits>
+#include <stddef.h>
+#include <malloc.h>
+
 #include "BaseLib/Misc.h"
 #include "BaseLib/Allocator.h"
 #include "BaseLib/ManagedRef.h"
 #include "SyncObjs.h"
 #include "SyncQueue.h"
+#include "Threading.h"
 
 /**
  * @ingroup Threading
  * @brief Synchronized object pool template
  *
  * Defines a life-cycle managed pool of object resource, upports allocation provisioning and buffer reduction
+ * Optionally keeps a per-thread magazine of objects, so that most acquisitions and releases take no lock
+ * Optionally allocates each block of objects (wrappers and payloads) from a single slab, with the payloads
+ * packed in a cache line aligned array, in which case payloads are default constructed in-place, and
+ * TAllocator only destroys objects given via Replace(); slab pools do not shrink, since a slab
+ * is only freed once all of its objects are, which incremental deallocation cannot guarantee
  * @note Since the underlying implementation uses TSyncQueue, it inherits similar functionality limitations
+ * @note Objects cached in the magazine of an exited thread only return to the pool on ObjectReturnLock()
+ *       or pool destruction, call MagazineFlush() before thread exit to avoid this
  **/
 template <class T, class TAllocator = SimpleAllocator<T>>
 class TSyncObjPool {
@@ -104,19 +123,46 @@ protected:
 	size_type const AllocBlock;
 	size_type const Sentinal;
 	size_type const Limit;
+	bool const SlabAlloc;
 
 	TInterlockedSyncOrdinal<size_type> AllocCnt;
 	TSyncBool GrowLimit;
 
+	struct TMagazine {
+		LONG volatile Busy;
+		size_type Count;
+		TSyncPoolObj* Objs[1];
+	};
+	struct TMagazineFiller {
+		TMagazine &Magazine;
+		TMagazineFiller(TMagazine &xMagazine) : Magazine(xMagazine) {}
+		void push_back(TSyncPoolObj* Obj)
+		{ Magazine.Objs[Magazine.Count++] = Obj; }
+	};
+	size_type const MagazineDepth;
+	DWORD MagazineTLS;
+	LONG volatile MagazineBypass;
+	TLockableCS MagazineLock;
+	std::vector<TMagazine*> Magazines;
+
 	void __CheckGrow(void);
 	void __CheckShrink(size_type PoolSize);
+	void __CheckReturn(size_type PoolSize);
 	bool __ObjectReturnTryLock(void);
 
+	TMagazine* __MagazineAcquire(void);
+	void __MagazineSpill(TMagazine &Magazine, size_type Count);
+	void __MagazineDrain(void);
+
 	virtual void Release(TSyncPoolObj* Obj);
 public:
 	TString const Name;
 
-	TSyncObjPool(TString const &xName, UINT32 xLimit = INFINITE, UINT32 xAllocBlock = 256);
+	/**
+	 * Create a pool, with per-thread magazines of xMagazineDepth objects (0 to disable),
+	 * and optionally allocate each block of objects from a single slab
+	 **/
+	TSyncObjPool(TString const &xName, UINT32 xLimit = INFINITE, UINT32 xAllocBlock = 256, UINT32 xMagazineDepth = 0, bool xSlabAlloc = false);
 	virtual ~TSyncObjPool(void);
 
 	/**
@@ -135,7 +181,9 @@ public:
 	 * Wait for all objects return to the pool and lock the acquistion operation
 	 * @note Only intended for short operations (otherwise may hang Acquire indefinitely)
 	 **/
-	bool ObjectReturnLock(DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr);
+	bool ObjectReturnLock(TDeadline const &Deadline, TWaitable *xWaitEvent = nullptr);
+	bool ObjectReturnLock(DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr)
+	{ return ObjectReturnLock(TDeadline(Timeout), xWaitEvent); }
 
 	/**
 	 * Release acquistion operation lock
@@ -146,6 +194,18 @@ public:
 	 * Switch to a new instance of pool object allocator
 	 **/
 	bool SetAllocator(TAllocator *xObjAlloc, DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr);
+
+	/**
+	 * Return all objects cached in the magazine of calling thread to the pool
+	 **/
+	void MagazineFlush(void);
+
+	/**
+	 * Waitable signaled when pooled objects may be available, for acquirers that cannot block
+	 * (retry with Acquire(0) after each wake up)
+	 **/
+	TWaitable const& AvailableWaitable(void) const
+	{ return Pool.EntriesWaitable(); }
 };
 
 #define SOPLogTag _T("Sync.ObjPool '%s'")
@@ -198,8 +258,91 @@ public:
 };
 
 template<class T, class TAllocator>
-TSyncObjPool<T, TAllocator>::TSyncObjPool(TString const &xName, UINT32 xLimit, UINT32 xAllocBlock) :
-Name(xName), AllocBlock(xAllocBlock), Sentinal(xAllocBlock / 4), Limit(xLimit), AllocCnt(0), GrowLimit(false), Pool(xName + _T(".Pool")) {
+class SlabPoolObj_Impl : public TSyncObjPool<T, TAllocator>::TSyncPoolObj {
+protected:
+	struct TSlab {
+		LONG volatile RefCnt;
+	};
+	struct TCell;
+
+	T* PoolObj;
+	T* const SlabObj;
+
+	SlabPoolObj_Impl(TSyncObjPool<T, TAllocator> *xParent, T *xSlabObj) :
+		TSyncObjPool<T, TAllocator>::TSyncPoolObj(xParent), PoolObj(xSlabObj), SlabObj(xSlabObj) {}
+
+	inline void __Destroy(T *xObj)
+	{ if (xObj == SlabObj) xObj->~T(); else TAllocator::Destroy(xObj); }
+
+public:
+	~SlabPoolObj_Impl(void)
+	{ __Destroy(PoolObj); }
+
+	//! Wrapper storage belongs to the slab, which is freed with its last wrapper
+	static void operator delete(void *Ptr);
+
+	inline T* operator&(void) const override
+	{ return PoolObj; }
+	inline void Replace(T *xObj) override
+	{ __Destroy((T*)InterlockedExchangePointer((PVOID*)&PoolObj, xObj)); }
+
+	static void CreateSlab(TSyncObjPool<T, TAllocator> *xParent, size_t Count,
+						   std::vector<typename TSyncObjPool<T, TAllocator>::TSyncPoolObj*> &Entries);
+};
+
+template<class T, class TAllocator>
+struct SlabPoolObj_Impl<T, TAllocator>::TCell {
+	TSlab* Slab;
+	typename std::aligned_storage<sizeof(SlabPoolObj_Impl), __alignof(SlabPoolObj_Impl)>::type Wrapper;
+};
+
+template<class T, class TAllocator>
+void SlabPoolObj_Impl<T, TAllocator>::operator delete(void *Ptr) {
+	TSlab* Slab = ((TCell*)((BYTE*)Ptr - offsetof(TCell, Wrapper)))->Slab;
+	if (InterlockedDecrement(&Slab->RefCnt) == 0)
+		_aligned_free(Slab);
+}
+
+template<class T, class TAllocator>
+void SlabPoolObj_Impl<T, TAllocator>::CreateSlab(TSyncObjPool<T, TAllocator> *xParent, size_t Count,
+												 std::vector<typename TSyncObjPool<T, TAllocator>::TSyncPoolObj*> &Entries) {
+	// Layout: [Header] [Wrapper cells...] [Payloads...], header and payload array start on cache line boundaries
+	size_t SlabAlign = __alignof(T) > CACHE_LINE_SIZE ? __alignof(T) : CACHE_LINE_SIZE;
+	size_t CellsOffset = (sizeof(TSlab) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+	size_t ObjsOffset = (CellsOffset + sizeof(TCell) * Count + SlabAlign - 1) & ~(SlabAlign - 1);
+	size_t ObjStride = sizeof(T);
+	BYTE* SlabBase = (BYTE*)_aligned_malloc(ObjsOffset + ObjStride * Count, SlabAlign);
+	if (SlabBase == nullptr)
+		FAIL(_T("Unable to allocate slab of %d objects"), (int)Count);
+
+	BYTE* Objs = SlabBase + ObjsOffset;
+	size_t Built = 0;
+	try {
+		for (; Built < Count; Built++)
+			PlacementNew<T>(Objs + Built * ObjStride);
+	} catch (...) {
+		// Unwind the payloads already constructed, and the slab itself
+		while (Built-- > 0)
+			((T*)(Objs + Built * ObjStride))->~T();
+		_aligned_free(SlabBase);
+		throw;
+	}
+
+	TSlab* Slab = (TSlab*)SlabBase;
+	Slab->RefCnt = (LONG)Count;
+	TCell* Cells = (TCell*)(SlabBase + CellsOffset);
+	for (size_t i = 0; i < Count; i++) {
+		Cells[i].Slab = Slab;
+		Entries.push_back(PlacementNew<SlabPoolObj_Impl>(&Cells[i].Wrapper, xParent, (T*)(Objs + i * ObjStride)));
+	}
+}
+
+template<class T, class TAllocator>
+TSyncObjPool<T, TAllocator>::TSyncObjPool(TString const &xName, UINT32 xLimit, UINT32 xAllocBlock, UINT32 xMagazineDepth, bool xSlabAlloc) :
+Name(xName), AllocBlock(xAllocBlock), Sentinal(xAllocBlock / 4), Limit(xLimit), SlabAlloc(xSlabAlloc), AllocCnt(0), GrowLimit(false), Pool(xName + _T(".Pool")),
+MagazineDepth(xMagazineDepth), MagazineTLS(TLS_OUT_OF_INDEXES), MagazineBypass(0) {
+	LOCKPROF(AquisitionLock.__SyncProfileName(Name + _T(".Acquisition")));
+	LOCKPROF(MagazineLock.__SyncProfileName(Name + _T(".Magazine")));
 	if (Sentinal == 0)
 		SOPFAIL(_T("Allocation block size too small (%d)"), AllocBlock);
 	if (Limit < Sentinal)
@@ -209,6 +352,17 @@ Name(xName), AllocBlock(xAllocBlock), Sentinal(xAllocBlock / 4), Limit(xLimit),
 	if ((Limit != INFINITE) && (Limit % AllocBlock != 0)) {
 		SOPLOG(_T("WARNING: Allocation limit (%d) is not a multiple of Allocation block size (%d)"), Limit, AllocBlock);
 	}
+	if (MagazineDepth > 0) {
+		if (MagazineDepth < 2)
+			SOPFAIL(_T("Magazine depth too small (%d)"), MagazineDepth);
+		if ((Limit != INFINITE) && (MagazineDepth > Sentinal)) {
+			SOPLOG(_T("WARNING: Magazine depth (%d) > Allocation sentinal (%d), acquisition may starve"), MagazineDepth, Sentinal);
+		}
+		MagazineTLS = TlsAlloc();
+		if (MagazineTLS == TLS_OUT_OF_INDEXES) {
+			SOPLOG(_T("WARNING: Unable to allocate TLS slot, magazines disabled"));
+		}
+	}
 	__CheckGrow();
 }
 
@@ -216,6 +370,14 @@ template<class T, class TAllocator>
 TSyncObjPool<T, TAllocator>::~TSyncObjPool(void) {
 	SOPLOGVV(_T("Destruction in progress..."));
 
+	if (MagazineTLS != TLS_OUT_OF_INDEXES) {
+		InterlockedIncrement(&MagazineBypass);
+		__MagazineDrain();
+		for (auto Magazine : Magazines)
+			_aligned_free(Magazine);
+		TlsFree(MagazineTLS);
+	}
+
 	Pool.__SyncLock();
 	TSyncQueuePool::size_type PoolSize = Pool.Length();
 
@@ -238,6 +400,8 @@ TSyncObjPool<T, TAllocator>::~TSyncObjPool(void) {
 
 template<class T, class TAllocator>
 void TSyncObjPool<T, TAllocator>::__CheckGrow(void) {
+	typedef SlabPoolObj_Impl<T, TAllocator> TSlabPoolObj;
+
 	// Quick return if already grown to the limit
 	if (GrowLimit.CompareAndSwap(false, false))
 		return;
@@ -258,9 +422,17 @@ void TSyncObjPool<T, TAllocator>::__CheckGrow(void) {
 				TSyncQueuePool::size_type AllocSize = AllocBlock;
 				// High frequency event
 				//SOPLOGVV(_T("Incremental allocation of %d entries from %d"), AllocSize, ~AllocCnt);
-				while (AllocSize-- > 0) {
-					Pool.Enqueue(SyncPoolObj_Impl<T, TAllocator>::Create(this));
-					++AllocCnt;
+				if (SlabAlloc) {
+					std::vector<TSyncPoolObj*> Entries;
+					Entries.reserve(AllocSize);
+					TSlabPoolObj::CreateSlab(this, AllocSize, Entries);
+					Pool.EnqueueBulk(std::move(Entries));
+					AllocCnt += AllocSize;
+				} else {
+					while (AllocSize-- > 0) {
+						Pool.Enqueue(SyncPoolObj_Impl<T, TAllocator>::Create(this));
+						++AllocCnt;
+					}
 				}
 			}
 		});
@@ -269,6 +441,10 @@ void TSyncObjPool<T, TAllocator>::__CheckGrow(void) {
 
 template<class T, class TAllocator>
 void TSyncObjPool<T, TAllocator>::__CheckShrink(typename TSyncObjPool<T, TAllocator>::size_type PoolSize) {
+	// Deleting idle wrappers scattered over partly used slabs frees no memory,
+	// while the next growth allocates yet another slab
+	if (SlabAlloc) return;
+
 	if (PoolSize >= AllocBlock + Sentinal) {
 		Synchronized(Pool, {
 			// Get the authoritative length
@@ -295,15 +471,105 @@ void TSyncObjPool<T, TAllocator>::__CheckShrink(typename TSyncObjPool<T, TAlloca
 }
 
 template<class T, class TAllocator>
-void TSyncObjPool<T, TAllocator>::Release(TSyncPoolObj* Obj) {
-	TSyncQueuePool::size_type PoolSize = Pool.Enqueue(Obj);
+void TSyncObjPool<T, TAllocator>::__CheckReturn(typename TSyncObjPool<T, TAllocator>::size_type PoolSize) {
 	if (PoolSize == ~AllocCnt)
 		ObjReturn.Set();
 	__CheckShrink(PoolSize);
 }
 
+template<class T, class TAllocator>
+typename TSyncObjPool<T, TAllocator>::TMagazine* TSyncObjPool<T, TAllocator>::__MagazineAcquire(void) {
+	TMagazine* Ret = (TMagazine*)TlsGetValue(MagazineTLS);
+	if (Ret == nullptr) {
+		size_t MagazineSize = sizeof(TMagazine) + sizeof(TSyncPoolObj*) * (MagazineDepth - 1);
+		// Keep magazines of different threads on separate cache lines
+		MagazineSize = (MagazineSize + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+		Ret = (TMagazine*)_aligned_malloc(MagazineSize, CACHE_LINE_SIZE);
+		if (Ret == nullptr)
+			SOPFAIL(_T("Unable to allocate magazine"));
+		Ret->Busy = 0;
+		Ret->Count = 0;
+		Synchronized(MagazineLock, {
+			Magazines.push_back(Ret);
+		});
+		TlsSetValue(MagazineTLS, Ret);
+	}
+	// Claim the magazine, and check again after claiming (pairs with __MagazineDrain)
+	if (InterlockedExchange(&Ret->Busy, 1) != 0)
+		// Being drained
+		return nullptr;
+	if (MagazineBypass) {
+		Ret->Busy = 0;
+		return nullptr;
+	}
+	return Ret;
+}
+
+template<class T, class TAllocator>
+void TSyncObjPool<T, TAllocator>::__MagazineSpill(TMagazine &Magazine, size_type Count) {
+	Magazine.Count -= Pool.EnqueueBulk(Magazine.Objs + Magazine.Count - Count, Magazine.Objs + Magazine.Count);
+	__CheckReturn(Pool.Length());
+}
+
+template<class T, class TAllocator>
+void TSyncObjPool<T, TAllocator>::__MagazineDrain(void) {
+	// NOTE: Must NOT hold AquisitionLock or Pool lock, magazine owners may be waiting for them
+	Synchronized(MagazineLock, {
+		for (auto Magazine : Magazines) {
+			while (InterlockedExchange(&Magazine->Busy, 1) != 0)
+				SwitchToThread();
+			if (Magazine->Count)
+				__MagazineSpill(*Magazine, Magazine->Count);
+			Magazine->Busy = 0;
+		}
+	});
+}
+
+template<class T, class TAllocator>
+void TSyncObjPool<T, TAllocator>::MagazineFlush(void) {
+	if (MagazineTLS != TLS_OUT_OF_INDEXES) {
+		TMagazine* Magazine = (TMagazine*)TlsGetValue(MagazineTLS);
+		if (Magazine && (InterlockedExchange(&Magazine->Busy, 1) == 0)) {
+			if (Magazine->Count)
+				__MagazineSpill(*Magazine, Magazine->Count);
+			Magazine->Busy = 0;
+		}
+	}
+}
+
+template<class T, class TAllocator>
+void TSyncObjPool<T, TAllocator>::Release(TSyncPoolObj* Obj) {
+	if ((MagazineTLS != TLS_OUT_OF_INDEXES) && !MagazineBypass) {
+		if (TMagazine* Magazine = __MagazineAcquire()) {
+			if (Magazine->Count == MagazineDepth)
+				__MagazineSpill(*Magazine, MagazineDepth / 2);
+			Magazine->Objs[Magazine->Count++] = Obj;
+			Magazine->Busy = 0;
+			return;
+		}
+	}
+
+	__CheckReturn(Pool.Enqueue(Obj));
+}
+
 template<class T, class TAllocator>
 typename TSyncObjPool<T, TAllocator>::TSyncPoolObj* TSyncObjPool<T, TAllocator>::Acquire(DWORD Timeout, TWaitable *xWaitEvent) {
+	if ((MagazineTLS != TLS_OUT_OF_INDEXES) && !MagazineBypass) {
+		if (TMagazine* Magazine = __MagazineAcquire()) {
+			if (Magazine->Count == 0) {
+				// Refill half of the magazine in one batch
+				TMagazineFiller Filler(*Magazine);
+				Synchronized(AquisitionLock, {
+					__CheckGrow();
+					Pool.DequeueBulk(Filler, MagazineDepth / 2, 0);
+				});
+			}
+			TSyncPoolObj* Entry = Magazine->Count ? Magazine->Objs[--Magazine->Count] : nullptr;
+			Magazine->Busy = 0;
+			if (Entry) return Entry;
+		}
+	}
+
 	Synchronized(AquisitionLock, {
 		__CheckGrow();
 		TSyncPoolObj* Entry = nullptr;
@@ -329,36 +595,35 @@ bool TSyncObjPool<T, TAllocator>::__ObjectReturnTryLock(void) {
 }
 
 template<class T, class TAllocator>
-bool TSyncObjPool<T, TAllocator>::ObjectReturnLock(DWORD Timeout, TWaitable *xWaitEvent) {
-	Flatten_FILETIME EnterTime;
-	if (Timeout != INFINITE)
-		GetSystemTimeAsFileTime(&EnterTime.FileTime);
-
+bool TSyncObjPool<T, TAllocator>::ObjectReturnLock(TDeadline const &Deadline, TWaitable *xWaitEvent) {
+	if (MagazineTLS != TLS_OUT_OF_INDEXES) {
+		// Route all acquisitions and releases through the pool, and collect cached objects
+		InterlockedIncrement(&MagazineBypass);
+		__MagazineDrain();
+	}
 	while (true) {
 		if (__ObjectReturnTryLock())
 			return true;
 
-		DWORD Delta;
-		if (Timeout != INFINITE) {
-			Flatten_FILETIME CurTime;
-			GetSystemTimeAsFileTime(&CurTime.FileTime);
-			Delta = (DWORD)((CurTime.U64 - EnterTime.U64) / MSTime_o100ns);
-			if (Delta > Timeout) return false;
-		} else
-			Delta = 0;
-		if (xWaitEvent == nullptr) {
-			if (ObjReturn.WaitFor(Timeout - Delta) != WaitResult::Signaled)
-				return false;
-		} else {
-			if (WaitMultiple({ObjReturn, *xWaitEvent}, false, Timeout - Delta) != WaitResult::Signaled_0)
-				return false;
-		}
+		if (Deadline.Expired()) break;
+		WaitResult WRet = (xWaitEvent == nullptr) ? ObjReturn.WaitFor(Deadline.WaitTime()) :
+			WaitMultiple({ObjReturn, *xWaitEvent}, false, Deadline.WaitTime());
+		// A timed-out wait re-checks the deadline above (the timer may fire slightly early)
+		if (WRet == WaitResult::TimedOut) continue;
+		if (WRet != ((xWaitEvent == nullptr) ? WaitResult::Signaled : WaitResult::Signaled_0))
+			break;
 	}
+
+	if (MagazineTLS != TLS_OUT_OF_INDEXES)
+		InterlockedDecrement(&MagazineBypass);
+	return false;
 }
 
 template<class T, class TAllocator>
 void TSyncObjPool<T, TAllocator>::ObjectReturnUnlock(void) {
 	AquisitionLock.__SyncUnlock();
+	if (MagazineTLS != TLS_OUT_OF_INDEXES)
+		InterlockedDecrement(&MagazineBypass);
 }
 
 template<class T, class TAllocator>
@@ -33,3 +33,314 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "BaseLib/MMSwitcher.h"
 
 #include "SyncObjs.h"
+
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#ifdef _WIN32
+
+// WaitOnAddress() and friends are only available since Windows 8, resolve them at run time,
+// so that the library still loads on earlier systems, where the parking lot below is used instead
+typedef BOOL(WINAPI *TWaitOnAddress)(VOID volatile*, PVOID, SIZE_T, DWORD);
+typedef VOID(WINAPI *TWakeByAddress)(PVOID);
+
+struct TAddressWaitAPI {
+	TWaitOnAddress Wait;
+	TWakeByAddress WakeSingle;
+	TWakeByAddress WakeAll;
+};
+
+static TAddressWaitAPI __AddressWaitAPI;
+static LONG volatile __AddressWaitAPIState = 0;
+
+static TAddressWaitAPI const& __GetAddressWaitAPI(void) {
+	// Resolution is idempotent, so racing threads may both do it
+	if (__AddressWaitAPIState == 0) {
+		HMODULE Module = LoadLibraryW(L"api-ms-win-core-synch-l1-2-0.dll");
+		if (Module != NULL) {
+			__AddressWaitAPI.Wait = (TWaitOnAddress)GetProcAddress(Module, "WaitOnAddress");
+			__AddressWaitAPI.WakeSingle = (TWakeByAddress)GetProcAddress(Module, "WakeByAddressSingle");
+			__AddressWaitAPI.WakeAll = (TWakeByAddress)GetProcAddress(Module, "WakeByAddressAll");
+		}
+		if ((__AddressWaitAPI.Wait == nullptr) || (__AddressWaitAPI.WakeSingle == nullptr) ||
+			(__AddressWaitAPI.WakeAll == nullptr))
+			__AddressWaitAPI.Wait = nullptr;
+		InterlockedExchange(&__AddressWaitAPIState, 1);
+	}
+	return __AddressWaitAPI;
+}
+
+// Parking lot: waiters queue in a bucket hashed from the address, and sleep on their own event
+#define PARKLOT_BUCKETS	64
+
+struct TParkWaiter {
+	LONG volatile *Address;
+	HANDLE Event;
+	TParkWaiter *Next;
+};
+
+struct TParkBucket {
+	LONG volatile Lock;
+	TParkWaiter *Waiters;
+};
+
+static TParkBucket __ParkBuckets[PARKLOT_BUCKETS];
+
+static TParkBucket& __ParkBucketLock(LONG volatile *Address) {
+	TParkBucket &Bucket = __ParkBuckets[((UINT_PTR)Address / sizeof(LONG)) % PARKLOT_BUCKETS];
+	while (InterlockedExchange(&Bucket.Lock, 1) != 0) {
+		for (int Spin = 0; Bucket.Lock != 0; Spin++) {
+			if (Spin < 64) YieldProcessor();
+			else SwitchToThread();
+		}
+	}
+	return Bucket;
+}
+
+static void __ParkBucketUnlock(TParkBucket &Bucket) {
+	InterlockedExchange(&Bucket.Lock, 0);
+}
+
+static void __ParkLotWait(LONG volatile *Address, LONG Value) {
+	TParkWaiter Waiter = { Address, CreateEvent(NULL, FALSE, FALSE, NULL), nullptr };
+	if (Waiter.Event == NULL)
+		SYSFAIL(_T("Unable to create parking event"));
+
+	// The value is checked under the bucket lock, which the waker takes after changing it
+	TParkBucket &Bucket = __ParkBucketLock(Address);
+	bool Park = *Address == Value;
+	if (Park) {
+		Waiter.Next = Bucket.Waiters;
+		Bucket.Waiters = &Waiter;
+	}
+	__ParkBucketUnlock(Bucket);
+
+	// A queued waiter is dequeued and signaled exactly once by a waker
+	if (Park) WaitForSingleObject(Waiter.Event, INFINITE);
+	CloseHandle(Waiter.Event);
+}
+
+static void __ParkLotWake(LONG volatile *Address, bool All) {
+	TParkBucket &Bucket = __ParkBucketLock(Address);
+	TParkWaiter **Link = &Bucket.Waiters;
+	while (TParkWaiter *Waiter = *Link) {
+		if (Waiter->Address == Address) {
+			*Link = Waiter->Next;
+			SetEvent(Waiter->Event);
+			if (!All) break;
+		} else Link = &Waiter->Next;
+	}
+	__ParkBucketUnlock(Bucket);
+}
+
+#endif
+
+// Park on the lock word while it still holds the given value
+inline void __ParkOnAddress(LONG volatile *Address, LONG Value) {
+#ifdef _WIN32
+	TAddressWaitAPI const &API = __GetAddressWaitAPI();
+	if (API.Wait != nullptr) API.Wait(Address, &Value, sizeof(LONG), INFINITE);
+	else __ParkLotWait(Address, Value);
+#else
+	syscall(SYS_futex, (int*)Address, FUTEX_WAIT_PRIVATE, Value, nullptr, nullptr, 0);
+#endif
+}
+
+// Wake one thread parked on the lock word
+inline void __WakeAddress(LONG volatile *Address) {
+#ifdef _WIN32
+	TAddressWaitAPI const &API = __GetAddressWaitAPI();
+	if (API.Wait != nullptr) API.WakeSingle((PVOID)Address);
+	else __ParkLotWake(Address, false);
+#else
+	syscall(SYS_futex, (int*)Address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+// Wake all threads parked on the lock word
+inline void __WakeAddressAll(LONG volatile *Address) {
+#ifdef _WIN32
+	TAddressWaitAPI const &API = __GetAddressWaitAPI();
+	if (API.Wait != nullptr) API.WakeAll((PVOID)Address);
+	else __ParkLotWake(Address, true);
+#else
+	syscall(SYS_futex, (int*)Address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+// TLockableAdaptive
+void TLockableAdaptive::__LockContended(void) {
+	// Spinning is only worthwhile if the holder is expected to leave soon
+	LONG HoldCycles = rHoldCycles;
+	if (HoldCycles < LOCKADAPTIVE_SPIN_MAX) {
+		UINT64 SpinLimit = __rdtsc() + ((HoldCycles * 2 > LOCKADAPTIVE_SPIN_MIN) ? HoldCycles * 2 : LOCKADAPTIVE_SPIN_MIN);
+		DWORD Backoff = 1;
+		do {
+			for (DWORD i = 0; i < Backoff; i++)
+				YieldProcessor();
+			if ((rState == 0) && (InterlockedCompareExchange(&rState, 1, 0) == 0))
+				return;
+			if (Backoff < LOCKADAPTIVE_BACKOFF_MAX)
+				Backoff <<= 1;
+		} while (__rdtsc() < SpinLimit);
+	}
+	// Mark the lock contended, so that the holder will wake us up
+	while (InterlockedExchange(&rState, 2) != 0)
+		__ParkOnAddress(&rState, 2);
+}
+
+void TLockableAdaptive::__SyncLock(void) {
+	DWORD ThreadID = GetCurrentThreadId();
+	if (rOwner == ThreadID) {
+		rRecursion++;
+		return;
+	}
+	if (InterlockedCompareExchange(&rState, 1, 0) != 0)
+		__LockContended();
+	rOwner = ThreadID;
+	rRecursion = 1;
+	rAcquireStamp = __rdtsc();
+}
+
+bool TLockableAdaptive::__SyncTryLock(void) {
+	DWORD ThreadID = GetCurrentThreadId();
+	if (rOwner == ThreadID) {
+		rRecursion++;
+		return true;
+	}
+	if ((rState != 0) || (InterlockedCompareExchange(&rState, 1, 0) != 0))
+		return false;
+	rOwner = ThreadID;
+	rRecursion = 1;
+	rAcquireStamp = __rdtsc();
+	return true;
+}
+
+void TLockableAdaptive::__SyncUnlock(void) {
+	DEBUG(if (rOwner != GetCurrentThreadId()) FAIL(_T("Releasing a lock not owned by current thread")));
+	if (--rRecursion != 0) return;
+
+	UINT64 HoldCycles = __rdtsc() - rAcquireStamp;
+	if (HoldCycles > LOCKADAPTIVE_SPIN_MAX * 2) HoldCycles = LOCKADAPTIVE_SPIN_MAX * 2;
+	rHoldCycles += ((LONG)HoldCycles - rHoldCycles) / 8;
+
+	rOwner = 0;
+	if (InterlockedExchange(&rState, 0) == 2)
+		__WakeAddress(&rState);
+}
+
+// TLockableSRW
+#define SRW_READER			0x0000000000000001LL
+#define SRW_READER_MASK		0x000000000000FFFFLL
+#define SRW_WRITER			0x0000000000010000LL
+#define SRW_QWRITER			0x0000000000020000LL
+#define SRW_QWRITER_MASK	0x00000000FFFE0000LL
+#define SRW_QREADER			0x0000000100000000LL
+#define SRW_QREADER_MASK	0x0000FFFF00000000LL
+#define SRW_QREADER_SHIFT	32
+#define SRW_BATCH			0x0001000000000000LL
+#define SRW_BATCH_MASK		0xFFFF000000000000LL
+
+// Writers park on the lower half (active / queued writer states),
+// readers park on the upper half (queued readers and batch generation)
+#define SRW_WRITER_WORD(State)	(((LONG volatile*)&(State))[0])
+#define SRW_READER_WORD(State)	(((LONG volatile*)&(State))[1])
+
+void TLockableSRW::__SyncLock(void) {
+	bool Queued = false;
+	LONGLONG State = rState;
+	while (true) {
+		if ((State & (SRW_READER_MASK | SRW_WRITER)) == 0) {
+			LONGLONG NewState = (State | SRW_WRITER) - (Queued ? SRW_QWRITER : 0);
+			LONGLONG PrevState = InterlockedCompareExchange64(&rState, NewState, State);
+			if (PrevState == State) return;
+			State = PrevState;
+		} else if (!Queued) {
+			// Register as waiting writer, this also holds off new readers
+			LONGLONG PrevState = InterlockedCompareExchange64(&rState, State + SRW_QWRITER, State);
+			if (PrevState == State) {
+				Queued = true;
+				State += SRW_QWRITER;
+			} else State = PrevState;
+		} else {
+			__ParkOnAddress(&SRW_WRITER_WORD(rState), (LONG)State);
+			State = rState;
+		}
+	}
+}
+
+bool TLockableSRW::__SyncTryLock(void) {
+	LONGLONG State = rState;
+	while ((State & (SRW_READER_MASK | SRW_WRITER)) == 0) {
+		LONGLONG PrevState = InterlockedCompareExchange64(&rState, State | SRW_WRITER, State);
+		if (PrevState == State) return true;
+		State = PrevState;
+	}
+	return false;
+}
+
+void TLockableSRW::__SyncUnlock(void) {
+	LONGLONG State = rState;
+	LONGLONG Readers;
+	while (true) {
+		LONGLONG NewState = State & ~SRW_WRITER;
+		// Admit all queued readers as one batch
+		Readers = (State & SRW_QREADER_MASK) >> SRW_QREADER_SHIFT;
+		if (Readers != 0)
+			NewState = (NewState & ~SRW_QREADER_MASK) + Readers * SRW_READER + SRW_BATCH;
+		LONGLONG PrevState = InterlockedCompareExchange64(&rState, NewState, State);
+		if (PrevState == State) break;
+		State = PrevState;
+	}
+	if (Readers != 0)
+		__WakeAddressAll(&SRW_READER_WORD(rState));
+	else if ((State & SRW_QWRITER_MASK) != 0)
+		__WakeAddress(&SRW_WRITER_WORD(rState));
+}
+
+void TLockableSRW::__SyncLockShared(void) {
+	LONGLONG State = rState;
+	while (true) {
+		LONGLONG PrevState;
+		if ((State & (SRW_WRITER | SRW_QWRITER_MASK)) == 0) {
+			PrevState = InterlockedCompareExchange64(&rState, State + SRW_READER, State);
+			if (PrevState == State) return;
+		} else {
+			// Writer active or waiting, queue up for the next batch
+			PrevState = InterlockedCompareExchange64(&rState, State + SRW_QREADER, State);
+			if (PrevState == State) break;
+		}
+		State = PrevState;
+	}
+	// The releasing writer admits us by moving on the batch generation
+	LONGLONG Batch = State & SRW_BATCH_MASK;
+	while (true) {
+		State = rState;
+		if ((State & SRW_BATCH_MASK) != Batch) return;
+		__ParkOnAddress(&SRW_READER_WORD(rState), (LONG)(State >> 32));
+	}
+}
+
+bool TLockableSRW::__SyncTryLockShared(void) {
+	LONGLONG State = rState;
+	while ((State & (SRW_WRITER | SRW_QWRITER_MASK)) == 0) {
+		LONGLONG PrevState = InterlockedCompareExchange64(&rState, State + SRW_READER, State);
+		if (PrevState == State) return true;
+		State = PrevState;
+	}
+	return false;
+}
+
+void TLockableSRW::__SyncUnlockShared(void) {
+	LONGLONG State = InterlockedExchangeAdd64(&rState, -SRW_READER) - SRW_READER;
+	// Last reader out hands over to a waiting writer
+	if (((State & (SRW_READER_MASK | SRW_WRITER)) == 0) && ((State & SRW_QWRITER_MASK) != 0))
+		__WakeAddress(&SRW_WRITER_WORD(rState));
+}
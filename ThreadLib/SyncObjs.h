@@ -38,6 +38,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @date Jul 29, 2013: Port to Visual C++ 2012
  * @date Jan 29, 2014: Make the code C++ style (avoid performance hit of __try __finally)
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Adaptive spin-then-park lockable, used by TSyncObj by default
+ * @date Oct 17, 2026: Shared (read-only) locking, writer-preferring reader-writer lockable
+ * @date Oct 17, 2026: Optional lock contention profiling (LOCK_PROFILING)
+ * @date Oct 17, 2026: Sequence lockable for optimistic snapshots of trivially copyable objects
  **/
 
 #ifndef SyncObjs_H
@@ -49,6 +53,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "BaseLib/Allocator.h"
 #include "BaseLib/ManagedRef.h"
 
+#include "LockProfiler.h"
+
+#include <type_traits>
+
+#ifdef LOCK_PROFILING
+#include <typeinfo>
+#endif
+
 /**
  * @ingroup Threading
  * @brief Lockable class
@@ -56,6 +68,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * Abstract class for suppoting lock operations
  **/
 class TLockable {
+#ifdef LOCK_PROFILING
+private:
+	TLockProfile *__Profile = nullptr;
+	bool __Unprofiled = false;
+#endif
 public:
 	virtual ~TLockable(void) {}
 
@@ -64,17 +81,28 @@ public:
 	private:
 		TLockable &Instance;
 	protected:
-		TLock(TLockable &xInstance, bool xLocked) :
-			Instance(xInstance), isLocked(xLocked) {}
+		TLock(TLockable &xInstance, bool xLocked, bool xShared = false) :
+			Instance(xInstance), isLocked(xLocked), isShared(xShared)
+		{ LOCKPROF(AcquireTS = TLockProfile::Now()); }
+		LOCKPROF(UINT64 AcquireTS);
 	public:
 		bool const isLocked;
+		bool const isShared;
 
 		TLock(TLock const&) = delete;
-		TLock(TLock &&xLock) : Instance(xLock.Instance), isLocked(xLock.isLocked)
-		{ *const_cast<bool*>(&xLock.isLocked) = false; }
+		TLock(TLock &&xLock) : Instance(xLock.Instance), isLocked(xLock.isLocked), isShared(xLock.isShared) {
+			LOCKPROF(AcquireTS = xLock.AcquireTS);
+			*const_cast<bool*>(&xLock.isLocked) = false;
+		}
 
-		~TLock(void)
-		{ if (isLocked) Instance.__SyncUnlock(); }
+		~TLock(void) {
+			if (isLocked) {
+				LOCKPROF(if (TLockProfile *Profile = Instance.__SyncProfile())
+					Profile->Released(TLockProfile::Now() - AcquireTS));
+				if (isShared) Instance.__SyncUnlockShared();
+				else Instance.__SyncUnlock();
+			}
+		}
 	};
 
 	/**
@@ -93,13 +121,89 @@ public:
 	virtual void __SyncUnlock(void)
 	{ FAIL(_T("Abstract function")); }
 
+	/**
+	 * Acquire the lock for read-only access, wait forever
+	 * @note Lockables without shared mode fall back to exclusive locking
+	 **/
+	virtual void __SyncLockShared(void)
+	{ __SyncLock(); }
+	/**
+	 * Try to acquire the lock for read-only access in this instant, return false if failed
+	 **/
+	virtual bool __SyncTryLockShared(void)
+	{ return __SyncTryLock(); }
+	/**
+	 * Release acquired read-only lock
+	 **/
+	virtual void __SyncUnlockShared(void)
+	{ __SyncUnlock(); }
+
+#ifdef LOCK_PROFILING
+	/**
+	 * Get the contention profile of this lock (nullptr if excluded from profiling)
+	 **/
+	TLockProfile* __SyncProfile(void) {
+		if ((__Profile == nullptr) && !__Unprofiled)
+			__Profile = TLockProfile::Resolve(UTF8toTString(typeid(*this).name()));
+		return __Profile;
+	}
+	/**
+	 * Account this lock under given name
+	 **/
+	void __SyncProfileName(TString const &Name)
+	{ __Profile = TLockProfile::Resolve(Name); }
+	/**
+	 * Exclude this lock from profiling
+	 * @note Required for locks taken inside memory allocation (e.g. by the memory statistics),
+	 *       as resolving the profile allocates memory
+	 **/
+	void __SyncProfileDisable(void) {
+		__Profile = nullptr;
+		__Unprofiled = true;
+	}
+	/**
+	 * Acquire the lock, and account for the contention
+	 **/
+	void __SyncProfiledLock(bool Shared) {
+		UINT64 StartTS = TLockProfile::Now();
+		bool Contended = Shared ? !__SyncTryLockShared() : !__SyncTryLock();
+		if (Contended) {
+			if (Shared) __SyncLockShared();
+			else __SyncLock();
+		}
+		if (TLockProfile *Profile = __SyncProfile())
+			Profile->Acquired(Contended, TLockProfile::Now() - StartTS, Shared);
+	}
+#endif
+
 	inline TLock SyncLock(void) {
+#ifdef LOCK_PROFILING
+		__SyncProfiledLock(false);
+#else
 		__SyncLock();
+#endif
 		return TLock(*this, true);
 	}
 
 	inline TLock SyncTryLock(void) {
-		return TLock(*this, __SyncTryLock());
+		bool Locked = __SyncTryLock();
+		LOCKPROF(if (TLockProfile *Profile = __SyncProfile()) Profile->TryAcquired(Locked, false));
+		return TLock(*this, Locked);
+	}
+
+	inline TLock SyncLockShared(void) {
+#ifdef LOCK_PROFILING
+		__SyncProfiledLock(true);
+#else
+		__SyncLockShared();
+#endif
+		return TLock(*this, true, true);
+	}
+
+	inline TLock SyncTryLockShared(void) {
+		bool Locked = __SyncTryLockShared();
+		LOCKPROF(if (TLockProfile *Profile = __SyncProfile()) Profile->TryAcquired(Locked, true));
+		return TLock(*this, Locked, true);
 	}
 };
 typedef TLockable* PLockable;
@@ -186,33 +290,186 @@ public:
 	{ rSyncPerms.Leave(); }
 };
 
+//! Spin budget bounds (in CPU cycles) of the adaptive lockable
+#ifndef LOCKADAPTIVE_SPIN_MIN
+#define LOCKADAPTIVE_SPIN_MIN	2000
+#endif
+#ifndef LOCKADAPTIVE_SPIN_MAX
+#define LOCKADAPTIVE_SPIN_MAX	100000
+#endif
+//! Maximum number of pause instructions between two lock probes
+#define LOCKADAPTIVE_BACKOFF_MAX	64
+
+/**
+ * @ingroup Threading
+ * @brief Adaptive lockable
+ *
+ * Re-entrant user-mode lock, contended acquisitions spin with exponential backoff
+ * for about twice the recent average hold time, then park on the lock word
+ * @note Uncontended and briefly contended operations never enter the kernel;
+ *       parking uses WaitOnAddress() on Windows 8 and later, and a parking lot of per-waiter events before
+ **/
+class TLockableAdaptive : public TLockable {
+protected:
+	//! 0: free, 1: locked, 2: locked with (possibly) parked waiters
+	LONG volatile rState;
+	DWORD volatile rOwner;
+	DWORD rRecursion;
+	UINT64 rAcquireStamp;
+	//! Moving average of recent hold time (in CPU cycles)
+	LONG volatile rHoldCycles;
+
+	void __LockContended(void);
+
+public:
+	TLockableAdaptive(void) :
+		rState(0), rOwner(0), rRecursion(0), rAcquireStamp(0), rHoldCycles(0) {}
+
+	void __SyncLock(void) override;
+	bool __SyncTryLock(void) override;
+	void __SyncUnlock(void) override;
+};
+
+/**
+ * @ingroup Threading
+ * @brief Sequence lockable
+ *
+ * Writers are serialized by the adaptive lock, and bump the sequence number on
+ * entering and leaving; readers copy optimistically without taking any lock,
+ * and retry if the sequence number changed (or was odd) during the copy
+ * @note Used as CLockable, TSyncObj::Snapshot becomes lock-free (requires trivially copyable T)
+ **/
+class TLockableSeq : public TLockableAdaptive {
+protected:
+	LONG volatile rSequence;
+
+public:
+	TLockableSeq(void) : rSequence(0) {}
+
+	void __SyncLock(void) override {
+		TLockableAdaptive::__SyncLock();
+		if (rRecursion == 1) {
+			rSequence++;
+			_ReadWriteBarrier();
+		}
+	}
+	bool __SyncTryLock(void) override {
+		if (!TLockableAdaptive::__SyncTryLock()) return false;
+		if (rRecursion == 1) {
+			rSequence++;
+			_ReadWriteBarrier();
+		}
+		return true;
+	}
+	void __SyncUnlock(void) override {
+		if (rRecursion == 1) {
+			_ReadWriteBarrier();
+			rSequence++;
+		}
+		TLockableAdaptive::__SyncUnlock();
+	}
+
+	// Shared holders do not modify, no need to disturb the optimistic readers
+	inline void __SyncLockShared(void) override
+	{ TLockableAdaptive::__SyncLock(); }
+	inline bool __SyncTryLockShared(void) override
+	{ return TLockableAdaptive::__SyncTryLock(); }
+	inline void __SyncUnlockShared(void) override
+	{ TLockableAdaptive::__SyncUnlock(); }
+
+	/**
+	 * Check whether the calling thread is the writer (optimistic reads would wait for itself)
+	 **/
+	inline bool WriterIsCaller(void) const
+	{ return rOwner == GetCurrentThreadId(); }
+	/**
+	 * Begin an optimistic read, wait out any writer in progress
+	 * @return Sequence number to validate the read with
+	 * @note Must not be called by the writer (see WriterIsCaller())
+	 **/
+	inline LONG ReadBegin(void) const {
+		LONG Sequence;
+		while ((Sequence = rSequence) & 1)
+			YieldProcessor();
+		_ReadWriteBarrier();
+		return Sequence;
+	}
+	/**
+	 * Check whether an optimistic read needs to be retried
+	 **/
+	inline bool ReadRetry(LONG Sequence) const {
+		_ReadWriteBarrier();
+		return rSequence != Sequence;
+	}
+};
+
+/**
+ * @ingroup Threading
+ * @brief Reader-writer lockable
+ *
+ * Shared-exclusive lock, writer-preferring with reader batching:
+ * New readers queue up behind waiting writers, and when a writer leaves,
+ * all queued readers are admitted together before the next writer
+ * @note NOT re-entrant, in either mode
+ **/
+class TLockableSRW : public TLockable {
+protected:
+	//! [63..48] Reader batch generation | [47..32] Queued readers |
+	//! [31..17] Queued writers | [16] Writer active | [15..0] Active readers
+	LONGLONG volatile rState;
+
+public:
+	TLockableSRW(void) : rState(0) {}
+
+	void __SyncLock(void) override;
+	bool __SyncTryLock(void) override;
+	void __SyncUnlock(void) override;
+
+	void __SyncLockShared(void) override;
+	bool __SyncTryLockShared(void) override;
+	void __SyncUnlockShared(void) override;
+};
+
 /**
  * @ingroup Threading
  * @brief GenericWaitResult::apper to synchronize any object
  *
  * Wraps around an object with a lockable class to protect asynchronous accesses
  **/
-template<class T, class TAllocator = SimpleAllocator<T>, class CLockable = TLockableCS>
+template<class T, class TAllocator = SimpleAllocator<T>, class CLockable = TLockableAdaptive>
 class TSyncObj : private ManagedRef<T, TAllocator>, public TLockable {
 protected:
 	CLockable Lock;
+
+	void __Snapshot(T &DstObj, std::false_type const&) const;
+	void __Snapshot(T &DstObj, std::true_type const&) const;
 public:
 	class TDeSyncObj final {
 		friend TSyncObj;
 	protected:
 		TSyncObj &Container;
 		T* const Obj;
-		TDeSyncObj(TSyncObj *xContainer) : Container(*xContainer), Obj(&xContainer->__Pickup()) {}
-		TDeSyncObj(TSyncObj &xContainer) : Container(xContainer), Obj(xContainer.__TryPickup()) {}
+		LOCKPROF(UINT64 AcquireTS);
+		TDeSyncObj(TSyncObj *xContainer) : Container(*xContainer), Obj(&xContainer->__Pickup())
+		{ LOCKPROF(AcquireTS = TLockProfile::Now()); }
+		TDeSyncObj(TSyncObj &xContainer) : Container(xContainer), Obj(xContainer.__TryPickup())
+		{ LOCKPROF(AcquireTS = TLockProfile::Now()); }
 	public:
 		TDeSyncObj(TDeSyncObj const &) = delete;
 		TDeSyncObj(TDeSyncObj &&xDeSyncObj) :
 			Container(xDeSyncObj.Container), Obj(xDeSyncObj.Obj)
 		{
+			LOCKPROF(AcquireTS = xDeSyncObj.AcquireTS);
 			*const_cast<T**>(&xDeSyncObj.Obj) = nullptr;
 		}
 
-		~TDeSyncObj(void) { if (Obj) Container.__Drop(); }
+		~TDeSyncObj(void) {
+			if (Obj) {
+				LOCKPROF(if (TLockProfile *Profile = Container.__SyncProfile())
+					Profile->Released(TLockProfile::Now() - AcquireTS));
+				Container.__Drop();
+			}
+		}
 
 		TDeSyncObj& operator=(TDeSyncObj const &) = delete;
 		TDeSyncObj& operator=(TDeSyncObj &&xDeSyncObj) = delete;
@@ -227,6 +484,44 @@ public:
 		{ return *(*this); }
 	};
 
+	class TDeSyncObjShared final {
+		friend TSyncObj;
+	protected:
+		TSyncObj const &Container;
+		T const* const Obj;
+		LOCKPROF(UINT64 AcquireTS);
+		TDeSyncObjShared(TSyncObj const *xContainer) : Container(*xContainer), Obj(&xContainer->__PickupShared())
+		{ LOCKPROF(AcquireTS = TLockProfile::Now()); }
+	public:
+		TDeSyncObjShared(TDeSyncObjShared const &) = delete;
+		TDeSyncObjShared(TDeSyncObjShared &&xDeSyncObj) :
+			Container(xDeSyncObj.Container), Obj(xDeSyncObj.Obj)
+		{
+			LOCKPROF(AcquireTS = xDeSyncObj.AcquireTS);
+			*const_cast<T const**>(&xDeSyncObj.Obj) = nullptr;
+		}
+
+		~TDeSyncObjShared(void) {
+			if (Obj) {
+				LOCKPROF(if (TLockProfile *Profile = const_cast<TSyncObj&>(Container).__SyncProfile())
+					Profile->Released(TLockProfile::Now() - AcquireTS));
+				Container.__DropShared();
+			}
+		}
+
+		TDeSyncObjShared& operator=(TDeSyncObjShared const &) = delete;
+		TDeSyncObjShared& operator=(TDeSyncObjShared &&xDeSyncObj) = delete;
+
+		inline T const* operator&(void) const
+		{ return Obj; }
+		inline T const& operator*(void) const
+		{ return *&(*this); }
+		inline T const* operator->(void) const
+		{ return &(*this); }
+		inline operator T const&() const
+		{ return *(*this); }
+	};
+
 public:
 	/**
 	 * Create a new instance of T and managed object with default parameter
@@ -281,6 +576,15 @@ public:
 	 **/
 	inline void __Drop(void);
 
+	/**
+	 * Lock the wrapper for read-only access, and return a const reference of managed T instance
+	 **/
+	inline T const& __PickupShared(void) const;
+	/**
+	 * Unlock the wrapper from read-only access
+	 **/
+	inline void __DropShared(void) const;
+
 	/**
 	 * Lock theWaitResult::apper, and return an reference of managed T instance
 	 **/
@@ -289,6 +593,11 @@ public:
 	 * Try to lock theWaitResult::apper in the instant, and return a pointer to managed T instance, NULL if could not obtain lock
 	 **/
 	TDeSyncObj TryPickup(void);
+	/**
+	 * Lock the wrapper for read-only access, and return a const reference of managed T instance
+	 * @note Concurrent with other read-only accesses if CLockable supports shared locking
+	 **/
+	TDeSyncObjShared PickupShared(void) const;
 
 	/**
 	 * Lock theWaitResult::apper, reassign the managed T instance as RefObj, and unlock theWaitResult::apper
@@ -307,6 +616,7 @@ public:
 	/**
 	 * Lock theWaitResult::apper, assign a copy of the managed T instance to DstObj, and unlock theWaitResult::apper
 	 * @note T must support assignment operator
+	 * @note With TLockableSeq, the copy is made optimistically without locking
 	 **/
 	void Snapshot(T &DstObj) const;
 
@@ -317,6 +627,13 @@ public:
 	inline void __SyncUnlock(void) override
 	{ Lock.__SyncUnlock(); }
 
+	inline void __SyncLockShared(void) override
+	{ Lock.__SyncLockShared(); }
+	inline bool __SyncTryLockShared(void) override
+	{ return Lock.__SyncTryLockShared(); }
+	inline void __SyncUnlockShared(void) override
+	{ Lock.__SyncUnlockShared(); }
+
 };
 
 #include "ThreadLib/Threading.h"
@@ -362,7 +679,11 @@ TSyncObj<T, TAllocator, CLockable>& TSyncObj<T, TAllocator, CLockable>::operator
 
 template<class T, class TAllocator, class CLockable>
 T& TSyncObj<T, TAllocator, CLockable>::__Pickup(void) {
+#ifdef LOCK_PROFILING
+	__SyncProfiledLock(false);
+#else
 	Lock.__SyncLock();
+#endif
 	__try {
 		return *this;
 	} __except ([&] {
@@ -375,7 +696,9 @@ T& TSyncObj<T, TAllocator, CLockable>::__Pickup(void) {
 
 template<class T, class TAllocator, class CLockable>
 T* TSyncObj<T, TAllocator, CLockable>::__TryPickup(void) {
-	if (Lock.__SyncTryLock()) {
+	bool Locked = Lock.__SyncTryLock();
+	LOCKPROF(if (TLockProfile *Profile = __SyncProfile()) Profile->TryAcquired(Locked, false));
+	if (Locked) {
 		__try {
 			return &((T&)*this);
 		} __except ([&] {
@@ -403,6 +726,33 @@ typename TSyncObj<T, TAllocator, CLockable>::TDeSyncObj TSyncObj<T, TAllocator,
 	return TDeSyncObj{*this};
 }
 
+template<class T, class TAllocator, class CLockable>
+T const& TSyncObj<T, TAllocator, CLockable>::__PickupShared(void) const {
+#ifdef LOCK_PROFILING
+	const_cast<TSyncObj*>(this)->__SyncProfiledLock(true);
+#else
+	const_cast<CLockable*>(&Lock)->__SyncLockShared();
+#endif
+	__try {
+		return **this;
+	} __except ([&] {
+		const_cast<CLockable*>(&Lock)->__SyncUnlockShared();
+		return EXCEPTION_CONTINUE_SEARCH;
+		}()) {
+		// Should not reach!
+	}
+}
+
+template<class T, class TAllocator, class CLockable>
+void TSyncObj<T, TAllocator, CLockable>::__DropShared(void) const {
+	const_cast<CLockable*>(&Lock)->__SyncUnlockShared();
+}
+
+template<class T, class TAllocator, class CLockable>
+typename TSyncObj<T, TAllocator, CLockable>::TDeSyncObjShared TSyncObj<T, TAllocator, CLockable>::PickupShared(void) const {
+	return TDeSyncObjShared{this};
+}
+
 template<class T, class TAllocator, class CLockable>
 T TSyncObj<T, TAllocator, CLockable>::Assign(const T &RefObj) {
 	Synchronized(Lock, {
@@ -427,9 +777,30 @@ bool TSyncObj<T, TAllocator, CLockable>::CompareAndSwap(const T& CmpObj, T& RefO
 
 template<class T, class TAllocator, class CLockable>
 void TSyncObj<T, TAllocator, CLockable>::Snapshot(T& DstObj) const {
-	Synchronized((*const_cast<CLockable*>(&Lock)), {
+	__Snapshot(DstObj, std::is_base_of<TLockableSeq, CLockable>());
+}
+
+template<class T, class TAllocator, class CLockable>
+void TSyncObj<T, TAllocator, CLockable>::__Snapshot(T& DstObj, std::false_type const&) const {
+	SynchronizedShared((*const_cast<CLockable*>(&Lock)), {
 		DstObj = **this;
 	});
 }
 
+template<class T, class TAllocator, class CLockable>
+void TSyncObj<T, TAllocator, CLockable>::__Snapshot(T& DstObj, std::true_type const&) const {
+	static_assert(std::is_trivially_copyable<T>::value, "Optimistic snapshot requires trivially copyable object");
+	// The lock is re-entrant, a writer taking a snapshot already has exclusive access
+	if (Lock.WriterIsCaller()) {
+		DstObj = **this;
+		return;
+	}
+	LONG Sequence;
+	do {
+		Sequence = Lock.ReadBegin();
+		// May observe a torn copy, which is discarded by the sequence check
+		DstObj = **this;
+	} while (Lock.ReadRetry(Sequence));
+}
+
 #endif SyncObjs_H
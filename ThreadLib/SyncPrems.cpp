@@ -39,6 +39,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 using namespace std;
 
+#ifdef _WIN32
+
 inline WaitResult __FilterWaitResult(DWORD Ret, size_t ObjCnt, bool WaitAll) {
 	if ((Ret >= WAIT_OBJECT_0) && (Ret < WAIT_OBJECT_0 + ObjCnt)) {
 		// High frequency event
@@ -259,3 +261,22 @@ void TCriticalSection::Leave(void) {
 	DEBUGVV(OwnerThreadID = 0);
 	LeaveCriticalSection(&rCriticalSection);
 }
+
+// Queried on first use, may be needed during static initialization (racing queries are benign)
+static UINT64 volatile QPC_Frequency = 0;
+
+UINT64 TDeadline::Now(void) {
+	if (QPC_Frequency == 0) {
+		LARGE_INTEGER Frequency;
+		QueryPerformanceFrequency(&Frequency);
+		QPC_Frequency = Frequency.QuadPart;
+	}
+	LARGE_INTEGER Counter;
+	QueryPerformanceCounter(&Counter);
+	// Split to avoid overflow of the nanosecond scaling
+	UINT64 Seconds = Counter.QuadPart / QPC_Frequency;
+	UINT64 Fraction = Counter.QuadPart % QPC_Frequency;
+	return Seconds * 1000000000 + Fraction * 1000000000 / QPC_Frequency;
+}
+
+#endif //_WIN32
@@ -36,16 +36,53 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @date Oct 10, 2006: Initial implementation
  * @date Jul 26, 2013: Porting to Visual C++ 2012
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: POSIX backend (futex based wait objects, pthread critical section)
+ * @date Oct 17, 2026: Monotonic wait deadline
+ * @date Oct 17, 2026: Explicit acquire / release fences
  **/
 
 #ifndef SyncPrems_H
 #define SyncPrems_H
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <pthread.h>
+#endif
 #include <vector>
 
 #include "BaseLib/Exception.h"
 
+/**
+ * Acquire / release memory ordering fences for lock-free code
+ * (explicit, so that the ordering does not depend on /volatile:ms)
+ * @note x86 / x64 never reorder loads with loads or stores with stores, only the compiler needs to be restrained
+ **/
+#ifdef _MSC_VER
+#if defined(_M_IX86) || defined(_M_X64)
+#define AcquireFence()	_ReadWriteBarrier()
+#define ReleaseFence()	_ReadWriteBarrier()
+#else
+#define AcquireFence()	MemoryBarrier()
+#define ReleaseFence()	MemoryBarrier()
+#endif
+#else
+#define AcquireFence()	__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define ReleaseFence()	__atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+#ifndef _WIN32
+// Match the Win32 multi-object wait limit
+#ifndef MAXIMUM_WAIT_OBJECTS
+#define MAXIMUM_WAIT_OBJECTS 64
+#endif
+
+/**
+ * Internal wait object (state + registered waiter list), implemented in SyncPrems_POSIX.cpp
+ **/
+class TWaitCore;
+#endif
+
 class TWaitable;
 enum WaitResult {
 	Signaled,
@@ -61,6 +98,70 @@ enum WaitResult {
 WaitResult WaitSingle(const TWaitable &Waitable, DWORD Timeout = INFINITE, bool WaitAPC = false, bool WaitMsg = false);
 WaitResult WaitMultiple(std::vector<std::reference_wrapper<TWaitable const>> const &Waitables, bool WaitAll, DWORD Timeout = INFINITE, bool WaitAPC = false, bool WaitMsg = false);
 
+/**
+ * @ingroup Threading
+ * @brief Wait deadline
+ *
+ * Absolute expiry time on the monotonic high-resolution clock (in nanoseconds),
+ * unaffected by wall-clock adjustments. Wait loops compute it once on entry,
+ * and derive the remaining wait time from it on each round.
+ **/
+class TDeadline {
+protected:
+	UINT64 rExpiry;
+
+public:
+	//! Expiry of a deadline that never expires
+	static UINT64 const NEVER = (UINT64)-1;
+	//! Expiry of a deadline that has always expired (no clock query needed)
+	static UINT64 const IMMEDIATE = 0;
+
+	/**
+	 * Current monotonic time in nanoseconds
+	 **/
+	static UINT64 Now(void);
+
+	/**
+	 * Deadline at given milliseconds from now (INFINITE = never)
+	 **/
+	explicit TDeadline(DWORD Timeout = INFINITE) :
+		rExpiry((Timeout == INFINITE) ? NEVER : (Timeout == 0) ? IMMEDIATE : Now() + (UINT64)Timeout * 1000000) {}
+
+	/**
+	 * Deadline at given nanoseconds from now (for sub-millisecond timeouts)
+	 **/
+	static TDeadline After(UINT64 Nanoseconds) {
+		TDeadline Ret;
+		Ret.rExpiry = Now() + Nanoseconds;
+		return Ret;
+	}
+
+	bool Infinite(void) const
+	{ return rExpiry == NEVER; }
+	bool Expired(void) const
+	{ return (rExpiry == IMMEDIATE) || (!Infinite() && (Now() >= rExpiry)); }
+
+	/**
+	 * Remaining time in nanoseconds (NEVER if infinite)
+	 **/
+	UINT64 Remaining(void) const {
+		if (Infinite()) return NEVER;
+		UINT64 CurTime = Now();
+		return (CurTime >= rExpiry) ? 0 : rExpiry - CurTime;
+	}
+
+	/**
+	 * Remaining time as a millisecond wait timeout (INFINITE if infinite)
+	 * @note Rounded up so that a sub-millisecond remainder still blocks (at most 1ms past expiry)
+	 *       instead of polling with zero timeouts until the deadline
+	 **/
+	DWORD WaitTime(void) const {
+		if (Infinite()) return INFINITE;
+		UINT64 Ret = (Remaining() + 999999) / 1000000;
+		return (Ret >= INFINITE) ? INFINITE - 1 : (DWORD)Ret;
+	}
+};
+
 /**
  * @ingroup Threading
  * @brief Waitable base class
@@ -76,11 +177,19 @@ public:
 	virtual WaitResult WaitFor(DWORD Timeout = INFINITE)
 	{ return WaitSingle(*this, Timeout); };
 
+#ifdef _WIN32
 	/**
 	 * Get the waitable handle for advanced operations
 	 **/
 	virtual HANDLE CreateWaitHandle(void) const
 	{ FAIL(_T("Abstract function")); };
+#else
+	/**
+	 * Get the internal wait object (POSIX backend)
+	 **/
+	virtual TWaitCore* WaitCore(void) const
+	{ FAIL(_T("Abstract function")); };
+#endif
 };
 
 /**
@@ -91,7 +200,11 @@ public:
  **/
 class TSemaphore : public TWaitable {
 private:
+#ifdef _WIN32
 	HANDLE rSemaphore;
+#else
+	TWaitCore *rSemaphore;
+#endif
 
 public:
 	TSemaphore(LONG Initial = 0, LONG Maximum = MAXINT, LPCTSTR Name = nullptr);
@@ -103,7 +216,11 @@ public:
 	 **/
 	LONG Signal(LONG Count = 1);
 
+#ifdef _WIN32
 	HANDLE CreateWaitHandle(void) const override;
+#else
+	TWaitCore* WaitCore(void) const override;
+#endif
 };
 
 /**
@@ -114,7 +231,11 @@ public:
  **/
 class TMutex : public TWaitable {
 private:
+#ifdef _WIN32
 	HANDLE rMutex;
+#else
+	TWaitCore *rMutex;
+#endif
 
 public:
 	TMutex(bool Acquired = false, LPCTSTR Name = nullptr);
@@ -137,7 +258,11 @@ public:
 	 **/
 	void Release(void);
 
+#ifdef _WIN32
 	HANDLE CreateWaitHandle(void) const override;
+#else
+	TWaitCore* WaitCore(void) const override;
+#endif
 };
 
 /**
@@ -148,7 +273,11 @@ public:
  **/
 class TEvent : public TWaitable {
 private:
+#ifdef _WIN32
 	HANDLE rEvent;
+#else
+	TWaitCore *rEvent;
+#endif
 
 public:
 	TEvent(bool ManualReset = false, bool Initial = false, LPCTSTR Name = nullptr);
@@ -169,7 +298,11 @@ public:
 	 **/
 	void Pulse(void);
 
+#ifdef _WIN32
 	HANDLE CreateWaitHandle(void) const override;
+#else
+	TWaitCore* WaitCore(void) const override;
+#endif
 };
 
 /**
@@ -181,7 +314,12 @@ public:
  **/
 class TCriticalSection {
 private:
+#ifdef _WIN32
 	RTL_CRITICAL_SECTION rCriticalSection;
+#else
+	pthread_mutex_t rCriticalSection;
+	DWORD rSpinCount;
+#endif
 	DEBUGVV(DWORD OwnerThreadID);
 
 public:
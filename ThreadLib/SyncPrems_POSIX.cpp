@@ -0,0 +1,526 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// [Threading] Synchronization Premitive Classes (POSIX backend)
+
+#include "BaseLib/MMSwitcher.h"
+
+#include "SyncPrems.h"
+
+#include "BaseLib/DebugLog.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include <algorithm>
+
+using namespace std;
+
+//-------------------------------
+// Low level helpers
+
+static inline DWORD __ThreadID(void) {
+	static __thread DWORD ThreadID = 0;
+	if (ThreadID == 0) ThreadID = (DWORD)syscall(SYS_gettid);
+	return ThreadID;
+}
+
+static inline void __CPURelax(void) {
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#else
+	__asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+static inline int __Futex_Wait(int volatile *Word, int Expect, struct timespec const *Timeout) {
+	return (int)syscall(SYS_futex, (int*)Word, FUTEX_WAIT_PRIVATE, Expect, Timeout, nullptr, 0);
+}
+
+static inline void __Futex_Wake(int volatile *Word, int Count) {
+	syscall(SYS_futex, (int*)Word, FUTEX_WAKE_PRIVATE, Count, nullptr, nullptr, 0);
+}
+
+UINT64 TDeadline::Now(void) {
+	struct timespec CurTime;
+	clock_gettime(CLOCK_MONOTONIC, &CurTime);
+	return (UINT64)CurTime.tv_sec * 1000000000 + CurTime.tv_nsec;
+}
+
+static inline struct timespec* __Futex_Timeout(TDeadline const &Deadline, struct timespec &WaitTime) {
+	if (Deadline.Infinite()) return nullptr;
+	UINT64 Remaining = Deadline.Remaining();
+	WaitTime.tv_sec = (time_t)(Remaining / 1000000000);
+	WaitTime.tv_nsec = (long)(Remaining % 1000000000);
+	return &WaitTime;
+}
+
+//-------------------------------
+// Waiter registration
+//
+// Every blocking wait registers one node per object on the objects' waiter lists,
+// all pointing to a single (stack-resident) waiter record. The waiter sleeps on the
+// futex word in its record; signalers walk the waiter list under the object lock
+// and either hand the signal over directly (wait-any), or ask the waiter to
+// re-evaluate (wait-all). Nobody polls.
+
+#define __WAITER_PENDING	0
+#define __WAITER_RECHECK	-1
+#define __WAITER_CANCELED	-2
+// Word > 0: satisfied by object at index (Word - 1)
+
+#define __WAITER_STATE(W)		__atomic_load_n(&(W).Word, __ATOMIC_ACQUIRE)
+#define __WAITER_SETSTATE(W, S)	__atomic_store_n(&(W).Word, (S), __ATOMIC_RELEASE)
+
+struct __Waiter {
+	int volatile Word;
+	bool WaitAll;
+	DWORD ThreadID;
+};
+
+struct __WaitNode {
+	__WaitNode *Prev, *Next;
+	__Waiter *Waiter;
+	int Index;
+	bool Linked;
+};
+
+class TWaitCore {
+private:
+	pthread_mutex_t rLock;
+	__WaitNode *rHead, *rTail;
+
+protected:
+	/**
+	 * Hand available signals to registered waiters (object lock held)
+	 **/
+	void Dispatch(void) {
+		__WaitNode *Node = rHead;
+		while (Node != nullptr) {
+			__WaitNode *Next = Node->Next;
+			__Waiter *Waiter = Node->Waiter;
+			if (IsSignaled(Waiter->ThreadID)) {
+				if (Waiter->WaitAll) {
+					// Cannot acquire all objects from here, let the waiter re-evaluate
+					if (__sync_bool_compare_and_swap(&Waiter->Word, __WAITER_PENDING, __WAITER_RECHECK))
+						__Futex_Wake(&Waiter->Word, 1);
+				} else if (__sync_bool_compare_and_swap(&Waiter->Word, __WAITER_PENDING, Node->Index + 1)) {
+					Acquire(Waiter->ThreadID);
+					Unlink(Node);
+					// Safe: the waiter must take our lock to clean up before it returns
+					__Futex_Wake(&Waiter->Word, 1);
+				}
+			}
+			Node = Next;
+		}
+	}
+
+public:
+	TWaitCore(void) : rHead(nullptr), rTail(nullptr) {
+		int Ret = pthread_mutex_init(&rLock, nullptr);
+		if (Ret != 0)
+			FAIL(_T("Failed to create wait object lock (%d)"), Ret);
+	}
+
+	virtual ~TWaitCore(void) {
+		if (rHead != nullptr)
+			LOG(_T("WARNING: Freeing a wait object with registered waiters!"));
+		pthread_mutex_destroy(&rLock);
+	}
+
+	void Lock(void) { pthread_mutex_lock(&rLock); }
+	void Unlock(void) { pthread_mutex_unlock(&rLock); }
+
+	/**
+	 * Check whether the object would satisfy a wait from given thread (object lock held)
+	 **/
+	virtual bool IsSignaled(DWORD ThreadID) = 0;
+
+	/**
+	 * Consume the signal on behalf of given thread (object lock held)
+	 **/
+	virtual void Acquire(DWORD ThreadID) = 0;
+
+	void Link(__WaitNode *Node) {
+		Node->Next = nullptr;
+		Node->Prev = rTail;
+		if (rTail != nullptr) rTail->Next = Node;
+		else rHead = Node;
+		rTail = Node;
+		Node->Linked = true;
+	}
+
+	void Unlink(__WaitNode *Node) {
+		if (!Node->Linked) return;
+		if (Node->Prev != nullptr) Node->Prev->Next = Node->Next;
+		else rHead = Node->Next;
+		if (Node->Next != nullptr) Node->Next->Prev = Node->Prev;
+		else rTail = Node->Prev;
+		Node->Linked = false;
+	}
+};
+
+class TWaitCore_Semaphore : public TWaitCore {
+public:
+	LONG Count;
+	LONG const Maximum;
+
+	TWaitCore_Semaphore(LONG Initial, LONG xMaximum) : Count(Initial), Maximum(xMaximum) {}
+
+	bool IsSignaled(DWORD ThreadID) override { return Count > 0; }
+	void Acquire(DWORD ThreadID) override { Count--; }
+
+	bool Signal(LONG xCount, LONG &PrevCnt) {
+		Lock();
+		PrevCnt = Count;
+		bool Ret = (xCount > 0) && (Maximum - Count >= xCount);
+		if (Ret) {
+			Count += xCount;
+			Dispatch();
+		}
+		Unlock();
+		return Ret;
+	}
+};
+
+class TWaitCore_Mutex : public TWaitCore {
+public:
+	DWORD Owner;
+	LONG Recursion;
+
+	TWaitCore_Mutex(void) : Owner(0), Recursion(0) {}
+
+	bool IsSignaled(DWORD ThreadID) override { return (Owner == 0) || (Owner == ThreadID); }
+	void Acquire(DWORD ThreadID) override { Owner = ThreadID; Recursion++; }
+
+	bool Release(DWORD ThreadID) {
+		Lock();
+		bool Ret = (Owner == ThreadID);
+		if (Ret && (--Recursion == 0)) {
+			Owner = 0;
+			Dispatch();
+		}
+		Unlock();
+		return Ret;
+	}
+};
+
+class TWaitCore_Event : public TWaitCore {
+public:
+	bool const ManualReset;
+	bool State;
+
+	TWaitCore_Event(bool xManualReset, bool Initial) : ManualReset(xManualReset), State(Initial) {}
+
+	bool IsSignaled(DWORD ThreadID) override { return State; }
+	void Acquire(DWORD ThreadID) override { if (!ManualReset) State = false; }
+
+	void Set(bool Pulse) {
+		Lock();
+		State = true;
+		Dispatch();
+		if (Pulse) State = false;
+		Unlock();
+	}
+
+	void Reset(void) {
+		Lock();
+		State = false;
+		Unlock();
+	}
+};
+
+//-------------------------------
+// Wait functions
+
+static WaitResult __WaitAny(vector<TWaitCore*> const &Cores, DWORD Timeout) {
+	size_t ObjCnt = Cores.size();
+	__Waiter Waiter = { __WAITER_PENDING, false, __ThreadID() };
+	vector<__WaitNode> Nodes(ObjCnt);
+
+	// Try each object in order, register on the ones not yet signaled
+	size_t Registered = 0;
+	while (Registered < ObjCnt) {
+		TWaitCore *Core = Cores[Registered];
+		__WaitNode &Node = Nodes[Registered];
+		Node.Waiter = &Waiter;
+		Node.Index = (int)Registered;
+		Node.Linked = false;
+		Core->Lock();
+		bool Done = false;
+		if (Core->IsSignaled(Waiter.ThreadID)) {
+			// Objects registered earlier may have handed over a signal already
+			if (__sync_bool_compare_and_swap(&Waiter.Word, __WAITER_PENDING, Node.Index + 1))
+				Core->Acquire(Waiter.ThreadID);
+			Done = true;
+		} else if (__WAITER_STATE(Waiter) != __WAITER_PENDING) {
+			Done = true;
+		} else if (Timeout != 0) {
+			Core->Link(&Node);
+		}
+		Core->Unlock();
+		Registered++;
+		if (Done) break;
+	}
+
+	if (__WAITER_STATE(Waiter) == __WAITER_PENDING) {
+		TDeadline Deadline(Timeout);
+		while (__WAITER_STATE(Waiter) == __WAITER_PENDING) {
+			if (Deadline.Expired()) {
+				__sync_bool_compare_and_swap(&Waiter.Word, __WAITER_PENDING, __WAITER_CANCELED);
+				break;
+			}
+			struct timespec WaitTime;
+			__Futex_Wait(&Waiter.Word, __WAITER_PENDING, __Futex_Timeout(Deadline, WaitTime));
+		}
+	}
+
+	// Deregister (also serializes against in-flight signalers)
+	for (size_t i = 0; i < Registered; i++) {
+		Cores[i]->Lock();
+		Cores[i]->Unlink(&Nodes[i]);
+		Cores[i]->Unlock();
+	}
+
+	int Word = __WAITER_STATE(Waiter);
+	return (Word > 0) ? (WaitResult)(WaitResult::Signaled_0 + Word - 1) : WaitResult::TimedOut;
+}
+
+static WaitResult __WaitAll(vector<TWaitCore*> Cores, DWORD Timeout) {
+	size_t ObjCnt = Cores.size();
+	// Lock in address order to avoid deadlocking with other wait-all waiters
+	sort(Cores.begin(), Cores.end());
+	if (adjacent_find(Cores.begin(), Cores.end()) != Cores.end()) {
+		LOGV(_T("WARNING: Wait failed - Duplicated wait objects"));
+		return WaitResult::Error;
+	}
+
+	__Waiter Waiter = { __WAITER_PENDING, true, __ThreadID() };
+	vector<__WaitNode> Nodes(ObjCnt);
+	for (size_t i = 0; i < ObjCnt; i++) {
+		Nodes[i].Waiter = &Waiter;
+		Nodes[i].Index = (int)i;
+		Nodes[i].Linked = false;
+	}
+
+	TDeadline Deadline(Timeout);
+	bool Registered = false;
+	WaitResult Ret = WaitResult::TimedOut;
+	bool Finished = false;
+	while (!Finished) {
+		for (TWaitCore *Core : Cores) Core->Lock();
+		bool AllSignaled = true;
+		for (TWaitCore *Core : Cores)
+			if (!(AllSignaled = Core->IsSignaled(Waiter.ThreadID))) break;
+		if (AllSignaled) {
+			for (TWaitCore *Core : Cores) Core->Acquire(Waiter.ThreadID);
+			Ret = WaitResult::Signaled;
+			Finished = true;
+		} else if (Deadline.Expired()) {
+			__WAITER_SETSTATE(Waiter, __WAITER_CANCELED);
+			Finished = true;
+		} else {
+			if (!Registered) {
+				for (size_t i = 0; i < ObjCnt; i++) Cores[i]->Link(&Nodes[i]);
+				Registered = true;
+			}
+			// All signalers are excluded, safe to re-arm
+			__WAITER_SETSTATE(Waiter, __WAITER_PENDING);
+		}
+		for (TWaitCore *Core : Cores) Core->Unlock();
+
+		while (!Finished && __WAITER_STATE(Waiter) == __WAITER_PENDING) {
+			if (Deadline.Expired()) break;
+			struct timespec WaitTime;
+			__Futex_Wait(&Waiter.Word, __WAITER_PENDING, __Futex_Timeout(Deadline, WaitTime));
+		}
+	}
+
+	if (Registered) {
+		for (size_t i = 0; i < ObjCnt; i++) {
+			Cores[i]->Lock();
+			Cores[i]->Unlink(&Nodes[i]);
+			Cores[i]->Unlock();
+		}
+	}
+	return Ret;
+}
+
+WaitResult WaitMultiple(vector<reference_wrapper<TWaitable const>> const&Waitables, bool WaitAll, DWORD Timeout, bool WaitAPC, bool WaitMsg) {
+	if (WaitAPC || WaitMsg)
+		FAIL(_T("APC / message wait is not supported on this platform"));
+	if (Waitables.empty() || (Waitables.size() > MAXIMUM_WAIT_OBJECTS)) {
+		LOGV(_T("WARNING: Wait failed - Invalid number of wait objects (%d)"), (int)Waitables.size());
+		return WaitResult::Error;
+	}
+	vector<TWaitCore*> Cores;
+	Cores.reserve(Waitables.size());
+	for (TWaitable const &Waitable : Waitables)
+		Cores.push_back(Waitable.WaitCore());
+	return WaitAll ? __WaitAll(Cores, Timeout) : __WaitAny(Cores, Timeout);
+}
+
+WaitResult WaitSingle(const TWaitable &Waitable, DWORD Timeout, bool WaitAPC, bool WaitMsg) {
+	if (WaitAPC || WaitMsg)
+		FAIL(_T("APC / message wait is not supported on this platform"));
+	vector<TWaitCore*> Cores(1, Waitable.WaitCore());
+	WaitResult Ret = __WaitAny(Cores, Timeout);
+	return (Ret == WaitResult::Signaled_0) ? WaitResult::Signaled : Ret;
+}
+
+//-------------------------------
+// TSemaphore
+TSemaphore::TSemaphore(LONG Initial, LONG Maximum, LPCTSTR Name) {
+	if (Name != nullptr)
+		FAIL(_T("Named semaphore is not supported on this platform"));
+	if ((Initial < 0) || (Maximum <= 0) || (Initial > Maximum))
+		FAIL(_T("Failed to create semaphore - Invalid count (%d / %d)"), Initial, Maximum);
+	rSemaphore = new TWaitCore_Semaphore(Initial, Maximum);
+}
+
+TSemaphore::~TSemaphore(void) {
+	delete rSemaphore;
+}
+
+LONG TSemaphore::Signal(LONG Count) {
+	LONG PrevCnt;
+	if (!static_cast<TWaitCore_Semaphore*>(rSemaphore)->Signal(Count, PrevCnt))
+		FAIL(_T("Failed to signal semaphore - Count exceeds maximum (%d + %d)"), PrevCnt, Count);
+	return PrevCnt;
+}
+
+TWaitCore* TSemaphore::WaitCore(void) const {
+	return rSemaphore;
+}
+
+// TMutex
+TMutex::TMutex(bool Acquired, LPCTSTR Name) {
+	if (Name != nullptr)
+		FAIL(_T("Named mutex is not supported on this platform"));
+	rMutex = new TWaitCore_Mutex();
+	if (Acquired)
+		rMutex->Acquire(__ThreadID());
+}
+
+TMutex::~TMutex(void) {
+	delete rMutex;
+}
+
+void TMutex::Release(void) {
+	if (!static_cast<TWaitCore_Mutex*>(rMutex)->Release(__ThreadID()))
+		FAIL(_T("Failed to release mutex - Not owned by current thread"));
+}
+
+TWaitCore* TMutex::WaitCore(void) const {
+	return rMutex;
+}
+
+// TEvent
+TEvent::TEvent(bool ManualReset, bool Initial, LPCTSTR Name) {
+	if (Name != nullptr)
+		FAIL(_T("Named event is not supported on this platform"));
+	rEvent = new TWaitCore_Event(ManualReset, Initial);
+}
+
+TEvent::~TEvent(void) {
+	delete rEvent;
+}
+
+void TEvent::Set(void) {
+	static_cast<TWaitCore_Event*>(rEvent)->Set(false);
+}
+
+void TEvent::Reset(void) {
+	static_cast<TWaitCore_Event*>(rEvent)->Reset();
+}
+
+void TEvent::Pulse(void) {
+	static_cast<TWaitCore_Event*>(rEvent)->Set(true);
+}
+
+TWaitCore* TEvent::WaitCore(void) const {
+	return rEvent;
+}
+
+// TCriticalSection
+TCriticalSection::TCriticalSection(bool Entered, DWORD SpinCount) {
+	pthread_mutexattr_t Attr;
+	pthread_mutexattr_init(&Attr);
+	// Win32 critical sections are re-entrant
+	pthread_mutexattr_settype(&Attr, PTHREAD_MUTEX_RECURSIVE);
+	int Ret = pthread_mutex_init(&rCriticalSection, &Attr);
+	pthread_mutexattr_destroy(&Attr);
+	if (Ret != 0)
+		FAIL(_T("Failed to create critical section (%d)"), Ret);
+	rSpinCount = SpinCount;
+	DEBUGVV(OwnerThreadID = 0);
+	if (Entered)
+		Enter();
+}
+
+TCriticalSection::~TCriticalSection(void) {
+	DEBUG(if (!TryEnter()) LOG(_T("WARNING: Freeing an acquired critical section!")));
+	UNDEBUG(Enter(void));
+	Leave();
+	pthread_mutex_destroy(&rCriticalSection);
+}
+
+void TCriticalSection::Enter(void) {
+	// Spin briefly before parking, similar to the Win32 spin count
+	for (DWORD Spin = 0; Spin < rSpinCount; Spin++) {
+		if (pthread_mutex_trylock(&rCriticalSection) == 0) {
+			DEBUGVV(OwnerThreadID = __ThreadID());
+			return;
+		}
+		__CPURelax();
+	}
+	pthread_mutex_lock(&rCriticalSection);
+	DEBUGVV(OwnerThreadID = __ThreadID());
+}
+
+bool TCriticalSection::TryEnter(void) {
+	bool Acquired = pthread_mutex_trylock(&rCriticalSection) == 0;
+	DEBUGVV(if (Acquired) OwnerThreadID = __ThreadID());
+	return Acquired;
+}
+
+void TCriticalSection::Leave(void) {
+	DEBUGVV(OwnerThreadID = 0);
+	pthread_mutex_unlock(&rCriticalSection);
+}
+
+#endif //_WIN32
@@ -35,12 +35,19 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @author Zhenyu Wu
  * @date Aug 01, 2013: Initial implementation
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Bulk enqueue / dequeue operations
+ * @date Oct 17, 2026: Bounded queue with blocking putters and watermarks
+ * @date Oct 17, 2026: Named lock profile
+ * @date Oct 17, 2026: Entry waitable for asynchronous getters
+ * @date Oct 17, 2026: Monotonic deadlines for timed operations
  **/
 
 #ifndef SyncQueue_H
 #define SyncQueue_H
 
 #include <deque>
+#include <vector>
+#include <functional>
 
 #include "SyncObjs.h"
 #include "SyncPrems.h"
@@ -52,14 +59,25 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @brief Synchronized queue
  *
  * Synchronized wrapper around a STL deque-like container for queue (FIFO) operations
+ * Optionally bounded, where producers block (or fail) when the queue is full
  **/
 template<class T, class Container = std::deque<T>>
 class TSyncQueue : TLockable {
 public:
 	typedef typename Container::size_type size_type;
+	/**
+	 * Watermark notification, High is true when the queue length reached the high watermark,
+	 * and false when it subsequently dropped to the low watermark
+	 * @note: Invoked while holding the queue lock, keep it short!
+	 **/
+	typedef std::function<void(TSyncQueue &Queue, bool High)> TWatermarkCallback;
 protected:
 	TSyncObj<Container> Queue;
 	TEvent WaitEvent;
+	TEvent SpaceEvent;
+	size_type HighMark, LowMark;
+	bool AboveMark;
+	TWatermarkCallback MarkCallback;
 #ifdef EMPTY_EVENT
 	TEvent EmptyEvent;
 #endif //EMPTY_EVENT
@@ -67,55 +85,137 @@ protected:
 	TLockableCS WaitLock;
 #endif //SIGNAL_MODERATION
 
+	inline size_type Enqueued(size_type PrevSize, size_type QueueSize);
+	inline void Dequeued(size_type PrevSize, size_type QueueSize);
+
 	bool TryDequeue(T& entry);
+	template<class OutContainer>
+	size_type TryDequeueBulk(OutContainer &Entries, size_type MaxCount);
+
+	static bool WaitSignal(TWaitable &Event, TDeadline const &Deadline, TWaitable *xWaitEvent);
+	bool WaitEntries(TDeadline const &Deadline, TWaitable *xWaitEvent);
 public:
 	TString const Name;
+	//! Maximum number of entries in the queue, 0 means no upper limit
+	size_type const Limit;
 
 #ifdef EMPTY_EVENT
 #ifdef SIGNAL_MODERATION
-	TSyncQueue(TString const &xName) : Name(xName), WaitEvent(false), EmptyEvent(true) {}
+	TSyncQueue(TString const &xName, size_type xLimit = 0) :
+		Name(xName), Limit(xLimit), WaitEvent(false), SpaceEvent(true, true), AboveMark(false), EmptyEvent(true)
+		{ LOCKPROF(Queue.__SyncProfileName(Name)); }
 #else
-	TSyncQueue(TString const &xName) : Name(xName), WaitEvent(true), EmptyEvent(true) {}
+	TSyncQueue(TString const &xName, size_type xLimit = 0) :
+		Name(xName), Limit(xLimit), WaitEvent(true), SpaceEvent(true, true), AboveMark(false), EmptyEvent(true)
+		{ LOCKPROF(Queue.__SyncProfileName(Name)); }
 #endif
 #else
 #ifdef SIGNAL_MODERATION
-	TSyncQueue(TString const &xName) : Name(xName), WaitEvent(false) {}
+	TSyncQueue(TString const &xName, size_type xLimit = 0) :
+		Name(xName), Limit(xLimit), WaitEvent(false), SpaceEvent(true, true), AboveMark(false)
+		{ LOCKPROF(Queue.__SyncProfileName(Name)); }
 #else
-	TSyncQueue(TString const &xName) : Name(xName), WaitEvent(true) {}
+	TSyncQueue(TString const &xName, size_type xLimit = 0) :
+		Name(xName), Limit(xLimit), WaitEvent(true), SpaceEvent(true, true), AboveMark(false)
+		{ LOCKPROF(Queue.__SyncProfileName(Name)); }
 #endif
 #endif //EMPTY_EVENT
 
 	~TSyncQueue() override;
 
 	/**
-	 * Put an object into the queue (no upper limit)
+	 * Put an object into the queue, if the queue is full, wait with given timeout
+	 * @return The length of the queue after the operation, 0 if timed out (use Timeout = 0 to fail fast)
+	 * @note: For multiple concurrent putters, fairness is NOT guaranteed!
 	 **/
-	size_type Enqueue(T entry);
+	size_type Enqueue(T entry, TDeadline const &Deadline, TWaitable *xWaitEvent = nullptr);
+	size_type Enqueue(T entry, DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr)
+	{ return Enqueue(std::move(entry), TDeadline(Limit ? Timeout : INFINITE), xWaitEvent); }
 	/**
-	 * Construct and put an object into the queue (no upper limit)
+	 * Construct and put an object into the queue, if the queue is full, wait until there is space
 	 **/
 	template<typename... Params>
-	size_type Emplace_Enqueue(Params&&... xParams);
+	size_type Emplace_Enqueue(Params&&... xParams)
+	{ return Emplace_EnqueueWait(TDeadline(), nullptr, std::forward<Params>(xParams)...); }
+	/**
+	 * Construct and put an object into the queue, if the queue is full, wait with given timeout
+	 * @return The length of the queue after the operation, 0 if timed out (use Timeout = 0 to fail fast)
+	 * @note: For multiple concurrent putters, fairness is NOT guaranteed!
+	 **/
+	template<typename... Params>
+	size_type Emplace_EnqueueWait(TDeadline const &Deadline, TWaitable *xWaitEvent, Params&&... xParams);
+	template<typename... Params>
+	size_type Emplace_EnqueueWait(DWORD Timeout, TWaitable *xWaitEvent, Params&&... xParams)
+	{ return Emplace_EnqueueWait(TDeadline(Limit ? Timeout : INFINITE), xWaitEvent, std::forward<Params>(xParams)...); }
+	/**
+	 * Put a range of objects into the queue under a single lock acquisition
+	 * If the queue is full, wait with given timeout for more space
+	 * @note: Objects are copied, use std::make_move_iterator to move them instead
+	 * @note: If copying (or moving) an object throws, the objects already put stay in the queue
+	 * @return Number of objects put into the queue
+	 **/
+	template<class InputIterator>
+	size_type EnqueueBulk(InputIterator First, InputIterator Last, TDeadline const &Deadline, TWaitable *xWaitEvent = nullptr);
+	template<class InputIterator>
+	size_type EnqueueBulk(InputIterator First, InputIterator Last, DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr)
+	{ return EnqueueBulk(First, Last, TDeadline(Limit ? Timeout : INFINITE), xWaitEvent); }
+	/**
+	 * Move objects of a vector into the queue under a single lock acquisition
+	 * If the queue is full, wait with given timeout for more space
+	 * @return Number of objects put into the queue (they are removed from the vector)
+	 **/
+	size_type EnqueueBulk(std::vector<T> &&Entries, TDeadline const &Deadline, TWaitable *xWaitEvent = nullptr);
+	size_type EnqueueBulk(std::vector<T> &&Entries, DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr)
+	{ return EnqueueBulk(std::move(Entries), TDeadline(Limit ? Timeout : INFINITE), xWaitEvent); }
 
 	/**
 	 * Try get an object fromt the queue with given timeout
-	 * @note: For multiple concurrent getters, fairness and timeout precision are NOT guaranteed!
+	 * @note: For multiple concurrent getters, fairness is NOT guaranteed!
 	 **/
-	bool Dequeue(T &entry, DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr);
+	bool Dequeue(T &entry, TDeadline const &Deadline, TWaitable *xWaitEvent = nullptr);
+	bool Dequeue(T &entry, DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr)
+	{ return Dequeue(entry, TDeadline(Timeout), xWaitEvent); }
+	/**
+	 * Try get up to MaxCount objects from the queue (appended to Entries) with given timeout
+	 * Waits until at least one object is available, then takes all available objects up to MaxCount
+	 * @note: If appending an object to Entries throws, the objects already appended stay taken
+	 * @return Number of objects taken from the queue, 0 if timed out
+	 * @note: For multiple concurrent getters, fairness is NOT guaranteed!
+	 **/
+	template<class OutContainer>
+	size_type DequeueBulk(OutContainer &Entries, size_type MaxCount, TDeadline const &Deadline, TWaitable *xWaitEvent = nullptr);
+	template<class OutContainer>
+	size_type DequeueBulk(OutContainer &Entries, size_type MaxCount, DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr)
+	{ return DequeueBulk(Entries, MaxCount, TDeadline(Timeout), xWaitEvent); }
 
 	/**
 	 * Return the instantaneous length of the queue
 	 **/
 	inline size_type Length(void);
 
+	/**
+	 * Waitable signaled when entries may be available, for getters that cannot block
+	 * (retry with Dequeue(entry, 0) after each wake up)
+	 * @note: With SIGNAL_MODERATION, only blocked getters are signaled, so waits should be bounded
+	 **/
+	TWaitable const& EntriesWaitable(void) const
+	{ return WaitEvent; }
+
 	inline void AdjustSize(void);
 
+	/**
+	 * Setup watermark notification (High > Low), or remove notification (empty Callback)
+	 **/
+	void SetWatermarks(size_type xHighMark, size_type xLowMark, TWatermarkCallback const &xCallback);
+
 #ifdef EMPTY_EVENT
 	/**
 	 * Try waiting for queue to become empty and hold a lock on the queue
-	 * @note: For multiple concurrent waiters, fairness and timeout precision are NOT guaranteed!
+	 * @note: For multiple concurrent waiters, fairness is NOT guaranteed!
 	 **/
-	bool EmptyLock(DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr);
+	bool EmptyLock(TDeadline const &Deadline, TWaitable *xWaitEvent = nullptr);
+	bool EmptyLock(DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr)
+	{ return EmptyLock(TDeadline(Timeout), xWaitEvent); }
 
 	/**
 	 * Release lock on the queue acquired by EmptyLock
@@ -174,42 +274,113 @@ TSyncQueue<T, Container>::~TSyncQueue() {
 }
 
 template<class T, class Container>
-typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::Enqueue(T entry) {
-	auto rQueue(Queue.Pickup());
-	rQueue->push_back(entry);
+typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::Enqueued(size_type PrevSize, size_type QueueSize) {
 #ifdef SIGNAL_MODERATION
 	auto Lock = WaitLock.SyncTryLock();
 	if (!Lock.isLocked)
 		// There is a getter waiting / trying to wait
 		WaitEvent.Set();
-	return rQueue->size();
 #else
-	size_type Ret = rQueue->size();
-	if (Ret == 1)
+	if (PrevSize == 0)
 		// There may be a getter waiting
 		WaitEvent.Set();
-	return Ret;
 #endif//SIGNAL_MODERATION
+	if (Limit && (QueueSize >= Limit))
+		// Queue is full!
+		SpaceEvent.Reset();
+	if (MarkCallback && !AboveMark && (QueueSize >= HighMark)) {
+		AboveMark = true;
+		MarkCallback(*this, true);
+	}
+	return QueueSize;
+}
+
+template<class T, class Container>
+void TSyncQueue<T, Container>::Dequeued(size_type PrevSize, size_type QueueSize) {
+#ifdef EMPTY_EVENT
+	if (QueueSize == 0)
+		// Signal empty condition
+		EmptyEvent.Set();
+#endif //EMPTY_EVENT
+	if (Limit && (PrevSize >= Limit) && (QueueSize < Limit))
+		// There may be a putter waiting
+		SpaceEvent.Set();
+	if (MarkCallback && AboveMark && (QueueSize <= LowMark)) {
+		AboveMark = false;
+		MarkCallback(*this, false);
+	}
+}
+
+template<class T, class Container>
+typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::Enqueue(T entry, TDeadline const &Deadline, TWaitable *xWaitEvent) {
+	while (true) {
+		// Synchronized Frame
+		{
+			auto rQueue(Queue.Pickup());
+			size_type QueueSize = rQueue->size();
+			if ((Limit == 0) || (QueueSize < Limit)) {
+				rQueue->push_back(std::move(entry));
+				return Enqueued(QueueSize, QueueSize + 1);
+			}
+		}
+		if (!WaitSignal(SpaceEvent, Deadline, xWaitEvent))
+			return 0;
+	}
 }
 
 template<class T, class Container>
 template<typename... Params>
-typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::Emplace_Enqueue(Params&&... xParams) {
-	auto rQueue(Queue.Pickup());
-	rQueue->emplace_back(xParams...);
-#ifdef SIGNAL_MODERATION
-	auto Lock = WaitLock.SyncTryLock();
-	if (!Lock.isLocked)
-		// There is a getter waiting / trying to wait
-		WaitEvent.Set();
-	return rQueue->size();
-#else
-	size_type Ret = rQueue->size();
-	if (Ret == 1)
-		// There may be a getter waiting
-		WaitEvent.Set();
+typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::Emplace_EnqueueWait(TDeadline const &Deadline, TWaitable *xWaitEvent, Params&&... xParams) {
+	while (true) {
+		// Synchronized Frame
+		{
+			auto rQueue(Queue.Pickup());
+			size_type QueueSize = rQueue->size();
+			if ((Limit == 0) || (QueueSize < Limit)) {
+				rQueue->emplace_back(std::forward<Params>(xParams)...);
+				return Enqueued(QueueSize, QueueSize + 1);
+			}
+		}
+		if (!WaitSignal(SpaceEvent, Deadline, xWaitEvent))
+			return 0;
+	}
+}
+
+template<class T, class Container>
+template<class InputIterator>
+typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::EnqueueBulk(InputIterator First, InputIterator Last, TDeadline const &Deadline, TWaitable *xWaitEvent) {
+	size_type Ret = 0;
+	while (First != Last) {
+		// Synchronized Frame
+		{
+			auto rQueue(Queue.Pickup());
+			size_type PrevSize = rQueue->size();
+			size_type QueueSize = PrevSize;
+			try {
+				for (; (First != Last) && ((Limit == 0) || (QueueSize < Limit)); ++First, ++QueueSize)
+					rQueue->push_back(*First);
+			} catch (...) {
+				// Signal the partial batch, so that waiting getters see the entries already put
+				if (QueueSize != PrevSize) Enqueued(PrevSize, QueueSize);
+				throw;
+			}
+			if (QueueSize != PrevSize) {
+				Enqueued(PrevSize, QueueSize);
+				Ret += QueueSize - PrevSize;
+			}
+			if (First == Last) break;
+		}
+		if (!WaitSignal(SpaceEvent, Deadline, xWaitEvent))
+			break;
+	}
+	return Ret;
+}
+
+template<class T, class Container>
+typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::EnqueueBulk(std::vector<T> &&Entries, TDeadline const &Deadline, TWaitable *xWaitEvent) {
+	size_type Ret = EnqueueBulk(std::make_move_iterator(Entries.begin()), std::make_move_iterator(Entries.end()), Deadline, xWaitEvent);
+	Entries.erase(Entries.begin(), Entries.begin() + Ret);
 	return Ret;
-#endif//SIGNAL_MODERATION
 }
 
 template<class T, class Container>
@@ -219,11 +390,7 @@ bool TSyncQueue<T, Container>::TryDequeue(T& entry) {
 	if (QueueSize > 0) {
 		entry = std::move(rQueue->front());
 		rQueue->pop_front();
-#ifdef EMPTY_EVENT
-		if (QueueSize == 1)
-			// Signal empty condition
-			EmptyEvent.Set();
-#endif //EMPTY_EVENT
+		Dequeued(QueueSize, QueueSize - 1);
 		return true;
 	} else {
 		// Queue is empty!
@@ -233,57 +400,87 @@ bool TSyncQueue<T, Container>::TryDequeue(T& entry) {
 }
 
 template<class T, class Container>
-bool TSyncQueue<T, Container>::Dequeue(T &entry, DWORD Timeout, TWaitable *xWaitEvent) {
-	Flatten_FILETIME EnterTime;
-	if (Timeout != INFINITE)
-		GetSystemTimeAsFileTime(&EnterTime.FileTime);
-	while (true) {
-		if (TryDequeue(entry))
-			return true;
-#ifdef SIGNAL_MODERATION
-		Synchronized(WaitLock, {
-			size_type QueueSize = Length();
-			if (QueueSize == 0) {
-				DWORD Delta;
-				if (Timeout != INFINITE) {
-					Flatten_FILETIME CurTime;
-					GetSystemTimeAsFileTime(&CurTime.FileTime);
-					Delta = (DWORD)((CurTime.U64 - EnterTime.U64) / MSTime_o100ns);
-					if (Delta > Timeout) return false;
-				} else
-					Delta = 0;
-				if (xWaitEvent == nullptr) {
-					if (WaitEvent.WaitFor(Timeout - Delta) != WaitResult::Signaled)
-						return false;
-				} else {
-					if (WaitMultiple({WaitEvent, *xWaitEvent}, false, Timeout - Delta) != WaitResult::Signaled_0)
-						return false;
-				}
+template<class OutContainer>
+typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::TryDequeueBulk(OutContainer &Entries, size_type MaxCount) {
+	auto rQueue(Queue.Pickup());
+	size_type QueueSize = rQueue->size();
+	if (QueueSize > 0) {
+		size_type Ret = QueueSize < MaxCount ? QueueSize : MaxCount;
+		size_type Taken = 0;
+		try {
+			for (; Taken < Ret; Taken++) {
+				Entries.push_back(std::move(rQueue->front()));
+				rQueue->pop_front();
 			}
-		});
-#else
-		DWORD Delta;
-		if (Timeout != INFINITE) {
-			Flatten_FILETIME CurTime;
-			GetSystemTimeAsFileTime(&CurTime.FileTime);
-			Delta = (DWORD)((CurTime.U64 - EnterTime.U64) / MSTime_o100ns);
-			if (Delta > Timeout) return false;
-		} else
-			Delta = 0;
-		if (xWaitEvent == nullptr) {
-			if (WaitEvent.WaitFor(Timeout - Delta) != WaitResult::Signaled)
-				return false;
-		} else {
-			if (WaitMultiple({WaitEvent, *xWaitEvent}, false, Timeout - Delta) != WaitResult::Signaled_0)
-				return false;
+		} catch (...) {
+			// Account for the partial batch, so that waiting putters see the space already freed
+			if (Taken != 0) Dequeued(QueueSize, QueueSize - Taken);
+			throw;
 		}
+		Dequeued(QueueSize, QueueSize - Ret);
+		return Ret;
+	} else {
+		// Queue is empty!
+		WaitEvent.Reset();
+	}
+	return 0;
+}
+
+template<class T, class Container>
+bool TSyncQueue<T, Container>::WaitSignal(TWaitable &Event, TDeadline const &Deadline, TWaitable *xWaitEvent) {
+	if (Deadline.Expired()) return false;
+	if (xWaitEvent == nullptr) {
+		WaitResult Ret = Event.WaitFor(Deadline.WaitTime());
+		if (Ret == WaitResult::Signaled) return true;
+		// The timer may fire slightly early, the caller then waits out the rest
+		return (Ret == WaitResult::TimedOut) && !Deadline.Expired();
+	} else {
+		WaitResult Ret = WaitMultiple({Event, *xWaitEvent}, false, Deadline.WaitTime());
+		if (Ret == WaitResult::Signaled_0) return true;
+		return (Ret == WaitResult::TimedOut) && !Deadline.Expired();
+	}
+}
+
+template<class T, class Container>
+bool TSyncQueue<T, Container>::WaitEntries(TDeadline const &Deadline, TWaitable *xWaitEvent) {
+#ifdef SIGNAL_MODERATION
+	Synchronized(WaitLock, {
+		size_type QueueSize = Length();
+		if (QueueSize == 0)
+			return WaitSignal(WaitEvent, Deadline, xWaitEvent);
+	});
+	return true;
+#else
+	return WaitSignal(WaitEvent, Deadline, xWaitEvent);
 #endif//SIGNAL_MODERATION
+}
+
+template<class T, class Container>
+bool TSyncQueue<T, Container>::Dequeue(T &entry, TDeadline const &Deadline, TWaitable *xWaitEvent) {
+	while (true) {
+		if (TryDequeue(entry))
+			return true;
+		if (!WaitEntries(Deadline, xWaitEvent))
+			return false;
+	}
+}
+
+template<class T, class Container>
+template<class OutContainer>
+typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::DequeueBulk(OutContainer &Entries, size_type MaxCount, TDeadline const &Deadline, TWaitable *xWaitEvent) {
+	if (MaxCount == 0) return 0;
+
+	while (true) {
+		if (size_type Ret = TryDequeueBulk(Entries, MaxCount))
+			return Ret;
+		if (!WaitEntries(Deadline, xWaitEvent))
+			return 0;
 	}
 }
 
 template<class T, class Container>
 typename TSyncQueue<T, Container>::size_type TSyncQueue<T, Container>::Length(void) {
-	auto rQueue(Queue.Pickup());
+	auto rQueue(Queue.PickupShared());
 	return rQueue->size();
 }
 
@@ -293,15 +490,23 @@ void TSyncQueue<T, Container>::AdjustSize(void) {
 	rQueue->shrink_to_fit();
 }
 
+template<class T, class Container>
+void TSyncQueue<T, Container>::SetWatermarks(size_type xHighMark, size_type xLowMark, TWatermarkCallback const &xCallback) {
+	if (xCallback && (xHighMark <= xLowMark))
+		SQFAIL(_T("Invalid watermarks (High %d, Low %d)"), (int)xHighMark, (int)xLowMark);
+
+	auto rQueue(Queue.Pickup());
+	HighMark = xHighMark;
+	LowMark = xLowMark;
+	MarkCallback = xCallback;
+	AboveMark = false;
+}
+
 
 #ifdef EMPTY_EVENT
 
 template<class T, class Container>
-bool TSyncQueue<T, Container>::EmptyLock(DWORD Timeout, TWaitable *xWaitEvent) {
-	Flatten_FILETIME EnterTime;
-	if (Timeout != INFINITE)
-		GetSystemTimeAsFileTime(&EnterTime.FileTime);
-
+bool TSyncQueue<T, Container>::EmptyLock(TDeadline const &Deadline, TWaitable *xWaitEvent) {
 	while (true) {
 		// Synchronized Frame
 		{
@@ -312,21 +517,8 @@ bool TSyncQueue<T, Container>::EmptyLock(DWORD Timeout, TWaitable *xWaitEvent) {
 			}
 		}
 
-		DWORD Delta;
-		if (Timeout != INFINITE) {
-			Flatten_FILETIME CurTime;
-			GetSystemTimeAsFileTime(&CurTime.FileTime);
-			Delta = (DWORD)((CurTime.U64 - EnterTime.U64) / MSTime_o100ns);
-			if (Delta > Timeout) return false;
-		} else
-			Delta = 0;
-		if (xWaitEvent == nullptr) {
-			if (EmptyEvent.WaitFor(Timeout - Delta) != WaitResult::Signaled)
-				return false;
-		} else {
-			if (WaitMultiple({EmptyEvent, *xWaitEvent}, false, Timeout - Delta) != WaitResult::Signaled_0)
-				return false;
-		}
+		if (!WaitSignal(EmptyEvent, Deadline, xWaitEvent))
+			return false;
 	}
 }
 
@@ -0,0 +1,523 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/**
+ * @addtogroup Threading Threading Support Utilities
+ * @file
+ * @brief Lock-free Ring Buffer Message Queue
+ * @author Zhenyu Wu
+ * @date Oct 17, 2026: Initial implementation
+ * @date Oct 17, 2026: Single-producer / single-consumer ring buffer
+ * @date Oct 17, 2026: Monotonic deadlines for timed operations
+ **/
+
+#ifndef SyncRingQueue_H
+#define SyncRingQueue_H
+
+#include <type_traits>
+
+#include "BaseLib/Allocator.h"
+#include "SyncQueue.h"
+#include "Threading.h"
+
+/**
+ * @ingroup Threading
+ * @brief Lock-free multi-producer / multi-consumer ring buffer
+ *
+ * Container tag for TSyncQueue, selects a bounded lock-free ring buffer implementation
+ **/
+template<class T>
+struct TRingMPMC {};
+
+/**
+ * @ingroup Threading
+ * @brief Wait-free single-producer / single-consumer ring buffer
+ *
+ * Container tag for TSyncQueue, selects a bounded wait-free implementation
+ * @note: Only ONE thread may put and only ONE thread may get at any time!
+ **/
+template<class T>
+struct TRingSPSC {};
+
+// Number of polls before a consumer parks on an empty ring
+#define RINGQUEUE_SPIN_COUNT	64
+
+/**
+ * @ingroup Threading
+ * @brief Synchronized queue (lock-free MPMC ring buffer)
+ *
+ * Bounded FIFO queue where each slot carries its own sequence number, published with release fenced stores
+ * and read with acquire fenced loads, so that producers and consumers only contend on the (cache-line separated)
+ * tail and head counters.
+ * The wait event is only touched when there is a consumer parked on the queue.
+ **/
+template<class T>
+class TSyncQueue<T, TRingMPMC<T>> {
+public:
+	typedef size_t size_type;
+protected:
+	struct TSlot {
+		LONG_PTR volatile Seq;
+		bool Filled;
+		typename std::aligned_storage<sizeof(T), __alignof(T)>::type Storage;
+	};
+
+	TSlot* const Slots;
+	LONG_PTR const Mask;
+	TEvent WaitEvent;
+
+	BYTE __Pad0[CACHE_LINE_SIZE];
+	LONG_PTR volatile Tail;
+	BYTE __Pad1[CACHE_LINE_SIZE - sizeof(LONG_PTR)];
+	LONG_PTR volatile Head;
+	BYTE __Pad2[CACHE_LINE_SIZE - sizeof(LONG_PTR)];
+	LONG volatile Parked;
+	BYTE __Pad3[CACHE_LINE_SIZE - sizeof(LONG)];
+
+	static size_type __RoundCapacity(size_type xCapacity);
+
+	bool TryDequeue(T& entry);
+	inline void WakeConsumer(void);
+public:
+	TString const Name;
+
+	/**
+	 * Create a ring queue holding at most xCapacity entries (rounded up to a power of 2)
+	 **/
+	TSyncQueue(TString const &xName, size_type xCapacity);
+	~TSyncQueue();
+
+	/**
+	 * Put an object into the queue
+	 * @return The approximate length of the queue after the operation, 0 if the queue is full
+	 **/
+	size_type Enqueue(T entry);
+	/**
+	 * Construct and put an object into the queue
+	 * @return The approximate length of the queue after the operation, 0 if the queue is full
+	 **/
+	template<typename... Params>
+	size_type Emplace_Enqueue(Params&&... xParams);
+
+	/**
+	 * Try get an object fromt the queue with given timeout
+	 * @note: For multiple concurrent getters, fairness is NOT guaranteed!
+	 **/
+	bool Dequeue(T &entry, TDeadline const &Deadline, TWaitable *xWaitEvent = nullptr);
+	bool Dequeue(T &entry, DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr)
+	{ return Dequeue(entry, TDeadline(Timeout), xWaitEvent); }
+
+	/**
+	 * Return the instantaneous length of the queue
+	 * @note: The value may be stale by the time it is returned
+	 **/
+	inline size_type Length(void);
+
+	/**
+	 * Return the maximum number of entries the queue can hold
+	 **/
+	inline size_type Capacity(void) const
+	{ return (size_type)Mask + 1; }
+};
+
+//! Perform logging within a synchronized queue
+#define SQLOG(s, ...) LOG(SQLogHeader s, Name.c_str(), __VA_ARGS__)
+#define SQLOGV(s, ...) LOGV(SQLogHeader s, Name.c_str(), __VA_ARGS__)
+#define SQLOGVV(s, ...) LOGVV(SQLogHeader s, Name.c_str(), __VA_ARGS__)
+
+template<class T>
+typename TSyncQueue<T, TRingMPMC<T>>::size_type TSyncQueue<T, TRingMPMC<T>>::__RoundCapacity(size_type xCapacity) {
+	size_type Ret = 2;
+	while (Ret < xCapacity) Ret <<= 1;
+	return Ret;
+}
+
+template<class T>
+TSyncQueue<T, TRingMPMC<T>>::TSyncQueue(TString const &xName, size_type xCapacity) :
+	Slots(new TSlot[__RoundCapacity(xCapacity)]), Mask(__RoundCapacity(xCapacity) - 1),
+	WaitEvent(false), Tail(0), Head(0), Parked(0), Name(xName) {
+	for (LONG_PTR i = 0; i <= Mask; i++)
+		Slots[i].Seq = i;
+}
+
+template<class T>
+TSyncQueue<T, TRingMPMC<T>>::~TSyncQueue() {
+	SQLOGV(_T("Destruction in progress..."));
+	size_t QSize = 0;
+	for (LONG_PTR Pos = Head; Pos != Tail; Pos++) {
+		TSlot &Slot = Slots[Pos & Mask];
+		if (Slot.Filled) {
+			reinterpret_cast<T*>(&Slot.Storage)->~T();
+			QSize++;
+		}
+	}
+	if (QSize) {
+		SQLOGV(_T("There are %d entries left over in queue"), (int)QSize);
+	}
+	delete[] Slots;
+}
+
+template<class T>
+void TSyncQueue<T, TRingMPMC<T>>::WakeConsumer(void) {
+	// Make sure the published slot is visible before checking for parked consumers
+	MemoryBarrier();
+	if (Parked)
+		WaitEvent.Set();
+}
+
+template<class T>
+typename TSyncQueue<T, TRingMPMC<T>>::size_type TSyncQueue<T, TRingMPMC<T>>::Enqueue(T entry) {
+	return Emplace_Enqueue(std::move(entry));
+}
+
+template<class T>
+template<typename... Params>
+typename TSyncQueue<T, TRingMPMC<T>>::size_type TSyncQueue<T, TRingMPMC<T>>::Emplace_Enqueue(Params&&... xParams) {
+	LONG_PTR Pos = Tail;
+	while (true) {
+		TSlot &Slot = Slots[Pos & Mask];
+		LONG_PTR Diff = Slot.Seq - Pos;
+		if (Diff == 0) {
+			LONG_PTR CurPos = __ARC_InterlockedCompareExchange(&Tail, Pos + 1, Pos);
+			if (CurPos == Pos) {
+				// Acquire: the consumer is done with the slot before it hands it back
+				AcquireFence();
+				try {
+					PlacementNew<T>(&Slot.Storage, std::forward<Params>(xParams)...);
+				} catch (...) {
+					// Publish the claimed slot as empty, otherwise the ring stalls at it
+					Slot.Filled = false;
+					ReleaseFence();
+					Slot.Seq = Pos + 1;
+					throw;
+				}
+				Slot.Filled = true;
+				// Release: the slot content is published before the sequence
+				ReleaseFence();
+				Slot.Seq = Pos + 1;
+				break;
+			}
+			Pos = CurPos;
+		} else if (Diff < 0) {
+			// Queue is full!
+			return 0;
+		} else
+			Pos = Tail;
+	}
+	WakeConsumer();
+	LONG_PTR Ret = Pos + 1 - Head;
+	return Ret > 0 ? (size_type)Ret : 1;
+}
+
+template<class T>
+bool TSyncQueue<T, TRingMPMC<T>>::TryDequeue(T& entry) {
+	LONG_PTR Pos = Head;
+	while (true) {
+		TSlot &Slot = Slots[Pos & Mask];
+		LONG_PTR Diff = Slot.Seq - (Pos + 1);
+		if (Diff == 0) {
+			LONG_PTR CurPos = __ARC_InterlockedCompareExchange(&Head, Pos + 1, Pos);
+			if (CurPos == Pos) {
+				// Acquire: the slot content is read after the producer published the sequence
+				AcquireFence();
+				if (!Slot.Filled) {
+					// Skip over a slot abandoned by a failed construction
+					ReleaseFence();
+					Slot.Seq = Pos + Mask + 1;
+					Pos++;
+					continue;
+				}
+				T* Obj = reinterpret_cast<T*>(&Slot.Storage);
+				try {
+					entry = std::move(*Obj);
+				} catch (...) {
+					// The slot is already claimed, drop the entry and hand the slot back, otherwise the ring stalls at it
+					Obj->~T();
+					ReleaseFence();
+					Slot.Seq = Pos + Mask + 1;
+					throw;
+				}
+				Obj->~T();
+				// Release: the slot is vacated before it is handed back to producers
+				ReleaseFence();
+				Slot.Seq = Pos + Mask + 1;
+				return true;
+			}
+			Pos = CurPos;
+		} else if (Diff < 0) {
+			// Queue is empty!
+			return false;
+		} else
+			Pos = Head;
+	}
+}
+
+template<class T>
+bool TSyncQueue<T, TRingMPMC<T>>::Dequeue(T &entry, TDeadline const &Deadline, TWaitable *xWaitEvent) {
+	if (TryDequeue(entry))
+		return true;
+
+	while (true) {
+		// Announce intention to park, then check again (producers check after publishing)
+		InterlockedIncrement(&Parked);
+		if (TryDequeue(entry)) {
+			InterlockedDecrement(&Parked);
+			return true;
+		}
+
+		if (Deadline.Expired()) {
+			InterlockedDecrement(&Parked);
+			return false;
+		}
+		WaitResult WRet = (xWaitEvent == nullptr) ? WaitEvent.WaitFor(Deadline.WaitTime()) :
+			WaitMultiple({WaitEvent, *xWaitEvent}, false, Deadline.WaitTime());
+		InterlockedDecrement(&Parked);
+		// A timed-out wait re-checks the deadline above (the timer may fire slightly early)
+		if (WRet == WaitResult::TimedOut) continue;
+		if (WRet != ((xWaitEvent == nullptr) ? WaitResult::Signaled : WaitResult::Signaled_0))
+			return false;
+
+		if (TryDequeue(entry)) {
+			// Consecutive wake-ups may have coalesced on the event, pass it on
+			if (Parked && (Length() > 0))
+				WaitEvent.Set();
+			return true;
+		}
+	}
+}
+
+template<class T>
+typename TSyncQueue<T, TRingMPMC<T>>::size_type TSyncQueue<T, TRingMPMC<T>>::Length(void) {
+	LONG_PTR CurHead = Head;
+	LONG_PTR Ret = Tail - CurHead;
+	return Ret > 0 ? (size_type)Ret : 0;
+}
+
+/**
+ * @ingroup Threading
+ * @brief Synchronized queue (wait-free SPSC ring buffer)
+ *
+ * Bounded FIFO queue where the tail index is only written by the producer and the head index
+ * only by the consumer, each publishing with release fenced stores and reading the other with acquire fenced loads.
+ * The consumer spins briefly before parking, and the producer only signals when it has parked,
+ * so the common path makes no system calls.
+ **/
+template<class T>
+class TSyncQueue<T, TRingSPSC<T>> {
+public:
+	typedef size_t size_type;
+protected:
+	typedef typename std::aligned_storage<sizeof(T), __alignof(T)>::type TSlot;
+
+	TSlot* const Slots;
+	size_t const Mask;
+	TEvent WaitEvent;
+
+	BYTE __Pad0[CACHE_LINE_SIZE];
+	// Producer owned
+	size_t volatile Tail;
+	size_t HeadCache;
+	BYTE __Pad1[CACHE_LINE_SIZE - sizeof(size_t) * 2];
+	// Consumer owned
+	size_t volatile Head;
+	size_t TailCache;
+	BYTE __Pad2[CACHE_LINE_SIZE - sizeof(size_t) * 2];
+	LONG volatile Parked;
+	BYTE __Pad3[CACHE_LINE_SIZE - sizeof(LONG)];
+
+	static size_type __RoundCapacity(size_type xCapacity);
+
+	bool TryDequeue(T& entry);
+	inline void WakeConsumer(void);
+public:
+	TString const Name;
+
+	/**
+	 * Create a ring queue holding at most xCapacity entries (rounded up to a power of 2)
+	 **/
+	TSyncQueue(TString const &xName, size_type xCapacity);
+	~TSyncQueue();
+
+	/**
+	 * Put an object into the queue (producer thread only)
+	 * @return The length of the queue after the operation, 0 if the queue is full
+	 **/
+	size_type Enqueue(T entry);
+	/**
+	 * Construct and put an object into the queue (producer thread only)
+	 * @return The length of the queue after the operation, 0 if the queue is full
+	 **/
+	template<typename... Params>
+	size_type Emplace_Enqueue(Params&&... xParams);
+
+	/**
+	 * Try get an object fromt the queue with given timeout (consumer thread only)
+	 **/
+	bool Dequeue(T &entry, TDeadline const &Deadline, TWaitable *xWaitEvent = nullptr);
+	bool Dequeue(T &entry, DWORD Timeout = INFINITE, TWaitable *xWaitEvent = nullptr)
+	{ return Dequeue(entry, TDeadline(Timeout), xWaitEvent); }
+
+	/**
+	 * Return the instantaneous length of the queue
+	 * @note: The value may be stale by the time it is returned
+	 **/
+	inline size_type Length(void);
+
+	/**
+	 * Return the maximum number of entries the queue can hold
+	 **/
+	inline size_type Capacity(void) const
+	{ return Mask + 1; }
+};
+
+template<class T>
+typename TSyncQueue<T, TRingSPSC<T>>::size_type TSyncQueue<T, TRingSPSC<T>>::__RoundCapacity(size_type xCapacity) {
+	size_type Ret = 2;
+	while (Ret < xCapacity) Ret <<= 1;
+	return Ret;
+}
+
+template<class T>
+TSyncQueue<T, TRingSPSC<T>>::TSyncQueue(TString const &xName, size_type xCapacity) :
+	Slots(new TSlot[__RoundCapacity(xCapacity)]), Mask(__RoundCapacity(xCapacity) - 1),
+	WaitEvent(false), Tail(0), HeadCache(0), Head(0), TailCache(0), Parked(0), Name(xName) {}
+
+template<class T>
+TSyncQueue<T, TRingSPSC<T>>::~TSyncQueue() {
+	SQLOGV(_T("Destruction in progress..."));
+	size_t QSize = 0;
+	for (size_t Pos = Head; Pos != Tail; Pos++, QSize++)
+		reinterpret_cast<T*>(&Slots[Pos & Mask])->~T();
+	if (QSize) {
+		SQLOGV(_T("There are %d entries left over in queue"), (int)QSize);
+	}
+	delete[] Slots;
+}
+
+template<class T>
+void TSyncQueue<T, TRingSPSC<T>>::WakeConsumer(void) {
+	// Make sure the published tail is visible before checking for parked consumer
+	MemoryBarrier();
+	if (Parked && InterlockedExchange(&Parked, 0))
+		WaitEvent.Set();
+}
+
+template<class T>
+typename TSyncQueue<T, TRingSPSC<T>>::size_type TSyncQueue<T, TRingSPSC<T>>::Enqueue(T entry) {
+	return Emplace_Enqueue(std::move(entry));
+}
+
+template<class T>
+template<typename... Params>
+typename TSyncQueue<T, TRingSPSC<T>>::size_type TSyncQueue<T, TRingSPSC<T>>::Emplace_Enqueue(Params&&... xParams) {
+	size_t Pos = Tail;
+	if (Pos - HeadCache > Mask) {
+		HeadCache = Head;
+		// Acquire: the consumer is done with the slot before it hands it back
+		AcquireFence();
+		if (Pos - HeadCache > Mask)
+			// Queue is full!
+			return 0;
+	}
+	PlacementNew<T>(&Slots[Pos & Mask], std::forward<Params>(xParams)...);
+	// Release: the slot content is published before the tail
+	ReleaseFence();
+	Tail = Pos + 1;
+	WakeConsumer();
+	return Pos + 1 - HeadCache;
+}
+
+template<class T>
+bool TSyncQueue<T, TRingSPSC<T>>::TryDequeue(T& entry) {
+	size_t Pos = Head;
+	if (Pos == TailCache) {
+		TailCache = Tail;
+		// Acquire: the slot content is read after the producer published tail
+		AcquireFence();
+		if (Pos == TailCache)
+			// Queue is empty!
+			return false;
+	}
+	T* Obj = reinterpret_cast<T*>(&Slots[Pos & Mask]);
+	entry = std::move(*Obj);
+	Obj->~T();
+	// Release: the slot is vacated before it is handed back to the producer
+	ReleaseFence();
+	Head = Pos + 1;
+	return true;
+}
+
+template<class T>
+bool TSyncQueue<T, TRingSPSC<T>>::Dequeue(T &entry, TDeadline const &Deadline, TWaitable *xWaitEvent) {
+	for (int i = 0; i < RINGQUEUE_SPIN_COUNT; i++) {
+		if (TryDequeue(entry))
+			return true;
+		YieldProcessor();
+	}
+
+	while (true) {
+		// Announce intention to park, then check again (producer checks after publishing)
+		InterlockedExchange(&Parked, 1);
+		if (TryDequeue(entry)) {
+			Parked = 0;
+			return true;
+		}
+
+		if (Deadline.Expired()) {
+			Parked = 0;
+			return false;
+		}
+		WaitResult WRet = (xWaitEvent == nullptr) ? WaitEvent.WaitFor(Deadline.WaitTime()) :
+			WaitMultiple({WaitEvent, *xWaitEvent}, false, Deadline.WaitTime());
+		Parked = 0;
+		// A timed-out wait re-checks the deadline above (the timer may fire slightly early)
+		if (WRet == WaitResult::TimedOut) continue;
+		if (WRet != ((xWaitEvent == nullptr) ? WaitResult::Signaled : WaitResult::Signaled_0))
+			return false;
+
+		if (TryDequeue(entry))
+			return true;
+	}
+}
+
+template<class T>
+typename TSyncQueue<T, TRingSPSC<T>>::size_type TSyncQueue<T, TRingSPSC<T>>::Length(void) {
+	size_t CurHead = Head;
+	// Tail may have advanced past a full ring relative to the head snapshot
+	size_t Ret = Tail - CurHead;
+	return Ret <= Mask + 1 ? Ret : Mask + 1;
+}
+
+#undef SQLOG
+#undef SQLOGV
+#undef SQLOGVV
+
+#endif//SyncRingQueue_H
@@ -0,0 +1,341 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// [Threading] Work-stealing Thread Pool
+
+#include "BaseLib/MMSwitcher.h"
+
+#include "ThreadPool.h"
+#include <thread>
+
+#define TPLogTag _T("T.Pool '%s'")
+#define TPLogHeader _T("{") TPLogTag _T("} ")
+
+//! Perform logging within a thread pool
+#define TPLOG(s, ...) LOG(TPLogHeader s, Name.c_str(), __VA_ARGS__)
+#define TPLOGV(s, ...) LOGV(TPLogHeader s, Name.c_str(), __VA_ARGS__)
+#define TPLOGVV(s, ...) LOGVV(TPLogHeader s, Name.c_str(), __VA_ARGS__)
+
+//! Initial per-worker deque capacity (must be power of 2)
+#define POOLDEQUE_CAPACITY 256
+
+typedef TThreadPool::TTask TTask;
+
+/**
+ * Chase-Lev work-stealing deque
+ * Only the owner pushes and pops (at the bottom), anyone may steal (from the top)
+ * Retired rings are kept until destruction, as a thief may still be reading them
+ **/
+class TWorkStealingDeque {
+protected:
+	struct TRing {
+		INT64 const Mask;
+		TTask* volatile *const Slots;
+		TRing *const Prev;
+
+		TRing(INT64 Capacity, TRing *xPrev) :
+			Mask(Capacity - 1), Slots(new TTask* volatile[(size_t)Capacity]), Prev(xPrev) {}
+		~TRing(void) { delete[] Slots; }
+	};
+
+	INT64 volatile rTop;
+	INT64 volatile rBottom;
+	TRing* volatile rRing;
+
+	TRing* __Grow(TRing *Ring, INT64 Bottom, INT64 Top) {
+		TRing *NewRing = new TRing((Ring->Mask + 1) * 2, Ring);
+		for (INT64 i = Top; i < Bottom; i++)
+			NewRing->Slots[i & NewRing->Mask] = Ring->Slots[i & Ring->Mask];
+		rRing = NewRing;
+		return NewRing;
+	}
+
+public:
+	TWorkStealingDeque(void) : rTop(0), rBottom(0), rRing(new TRing(POOLDEQUE_CAPACITY, nullptr)) {}
+	~TWorkStealingDeque(void) {
+		for (INT64 i = rTop; i < rBottom; i++)
+			delete rRing->Slots[i & rRing->Mask];
+		TRing *Ring = rRing;
+		while (Ring) {
+			TRing *Prev = Ring->Prev;
+			delete Ring;
+			Ring = Prev;
+		}
+	}
+
+	//! Owner only
+	void Push(TTask *Task) {
+		INT64 Bottom = rBottom;
+		INT64 Top = rTop;
+		TRing *Ring = rRing;
+		if (Bottom - Top > Ring->Mask)
+			Ring = __Grow(Ring, Bottom, Top);
+		Ring->Slots[Bottom & Ring->Mask] = Task;
+		// Publish the slot before the new bottom
+		_WriteBarrier();
+		rBottom = Bottom + 1;
+	}
+
+	//! Owner only
+	TTask* Pop(void) {
+		INT64 Bottom = rBottom - 1;
+		TRing *Ring = rRing;
+		rBottom = Bottom;
+		// The bottom store must be visible before reading the top (store-load ordering)
+		MemoryBarrier();
+		INT64 Top = rTop;
+		if (Top > Bottom) {
+			rBottom = Bottom + 1;
+			return nullptr;
+		}
+		TTask *Task = Ring->Slots[Bottom & Ring->Mask];
+		if (Top == Bottom) {
+			// Last task, race against the thieves
+			if (InterlockedCompareExchange64(&rTop, Top + 1, Top) != Top)
+				Task = nullptr;
+			rBottom = Bottom + 1;
+		}
+		return Task;
+	}
+
+	//! Any thread
+	TTask* Steal(void) {
+		while (true) {
+			INT64 Top = rTop;
+			MemoryBarrier();
+			INT64 Bottom = rBottom;
+			if (Top >= Bottom)
+				return nullptr;
+			TRing *Ring = rRing;
+			TTask *Task = Ring->Slots[Top & Ring->Mask];
+			if (InterlockedCompareExchange64(&rTop, Top + 1, Top) == Top)
+				return Task;
+			// Lost to another thief (or the owner), retry
+			YieldProcessor();
+		}
+	}
+
+	bool Empty(void) const
+	{ return rTop >= rBottom; }
+};
+
+/**
+ * Pool worker, runs the scheduling loop on its TWorkerThread
+ **/
+class TThreadPoolWorker : public TRunnable {
+	friend TThreadPool;
+protected:
+	TThreadPool &rPool;
+	TWorkStealingDeque rDeque;
+	TWorkerThread *rThread;
+	UINT32 rSeed;
+
+	UINT32 __NextVictim(void) {
+		// xorshift32
+		rSeed ^= rSeed << 13;
+		rSeed ^= rSeed >> 17;
+		rSeed ^= rSeed << 5;
+		return rSeed;
+	}
+
+	void* Run(TWorkerThread &WorkerThread, void *NoUse) override;
+	void StopNotify(void) override
+	{ rPool.rWakeup.Signal(); }
+
+public:
+	TThreadPoolWorker(TThreadPool &xPool, UINT32 xSeed) :
+		rPool(xPool), rThread(nullptr), rSeed(xSeed | 1) {}
+};
+
+static __declspec(thread) TThreadPoolWorker *__CurrentWorker = nullptr;
+
+void* TThreadPoolWorker::Run(TWorkerThread &WorkerThread, void *NoUse) {
+	rThread = &WorkerThread;
+	__CurrentWorker = this;
+	while (WorkerThread.CurrentState() == TWorkerThread::State::Running) {
+		TTask *Task = rPool.__Acquire(this);
+		if (Task == nullptr) {
+			// Only quit after all submitted work is done
+			if (~rPool.rStopping) break;
+
+			// Announce idle before the final check, so a concurrent submission either
+			// finds us counted (and signals), or is visible to the check
+			rPool.rIdleCount++;
+			Task = rPool.__Acquire(this);
+			if ((Task == nullptr) && !~rPool.rStopping)
+				rPool.rWakeup.WaitFor();
+			rPool.rIdleCount--;
+			if (Task == nullptr) continue;
+		}
+
+		std::unique_ptr<TTask> xTask(Task);
+		(*xTask)();
+	}
+	__CurrentWorker = nullptr;
+	return nullptr;
+}
+
+TThreadPool::TThreadPool(TString const &xName, size_t WorkerCount, SIZE_T StackSize) :
+	Name(xName), rInjectCount(0), rIdleCount(0), rStopping(FALSE) {
+	if (WorkerCount == 0)
+		WorkerCount = std::thread::hardware_concurrency();
+	if (WorkerCount == 0)
+		WorkerCount = 1;
+
+	// All deques must exist before any worker starts stealing
+	for (size_t i = 0; i < WorkerCount; i++)
+		rWorkers.push_back(new TThreadPoolWorker(*this, (UINT32)((i + 1) * 0x9E3779B9)));
+	for (size_t i = 0; i < WorkerCount; i++) {
+		rThreads.push_back(new TWorkerThread(TStringCast(Name << _T('#') << i), *rWorkers[i], nullptr, StackSize));
+	}
+	TPLOGV(_T("Started %d workers"), (int)WorkerCount);
+}
+
+TThreadPool::~TThreadPool(void) {
+	Shutdown();
+	for (auto Thread : rThreads)
+		delete Thread;
+	for (auto Worker : rWorkers)
+		delete Worker;
+	// Anything left behind (e.g. workers died of SEH exceptions)
+	auto Injection(rInjection.Pickup());
+	for (auto Task : *Injection)
+		delete Task;
+}
+
+void TThreadPool::Shutdown(void) {
+	if ((__CurrentWorker != nullptr) && (&__CurrentWorker->rPool == this))
+		FAIL(_T("{Pool %s} Cannot shutdown from within a pool worker"), Name.c_str());
+
+	if (rStopping.Exchange(TRUE)) return;
+	TPLOGV(_T("Shutting down..."));
+	rWakeup.Signal((LONG)rThreads.size());
+	for (auto Thread : rThreads)
+		Thread->WaitFor();
+	TPLOGV(_T("All workers stopped"));
+}
+
+void TThreadPool::__Enqueue(TTask *Task) {
+	TThreadPoolWorker *Worker = __CurrentWorker;
+	if ((Worker != nullptr) && (&Worker->rPool == this)) {
+		// Tasks may still spawn sub-tasks while the pool drains
+		Worker->rDeque.Push(Task);
+	} else {
+		if (~rStopping) {
+			delete Task;
+			FAIL(_T("{Pool %s} Cannot submit task after shutdown"), Name.c_str());
+		}
+		rInjection.Pickup()->push_back(Task);
+		rInjectCount++;
+	}
+	// Pairs with the idle announcement of the workers
+	MemoryBarrier();
+	if (~rIdleCount > 0)
+		rWakeup.Signal();
+}
+
+TTask* TThreadPool::__Acquire(TThreadPoolWorker *Worker) {
+	TTask *Task;
+	if (Worker && (Task = Worker->rDeque.Pop()))
+		return Task;
+
+	if (~rInjectCount > 0) {
+		auto Injection(rInjection.Pickup());
+		if (!Injection->empty()) {
+			Task = Injection->front();
+			Injection->pop_front();
+			rInjectCount--;
+			return Task;
+		}
+	}
+
+	// Steal from a random victim, then sweep the rest
+	size_t Count = rWorkers.size();
+	size_t Start = (Worker ? Worker->__NextVictim() : GetCurrentThreadId()) % Count;
+	for (size_t i = 0; i < Count; i++) {
+		TThreadPoolWorker *Victim = rWorkers[(Start + i) % Count];
+		if ((Victim != Worker) && (Task = Victim->rDeque.Steal()))
+			return Task;
+	}
+	return nullptr;
+}
+
+bool TThreadPool::HelpOne(void) {
+	// Tasks (e.g. submitted runnables) may expect to run on a worker thread of this pool
+	TThreadPoolWorker *Worker = __CurrentWorker;
+	if ((Worker == nullptr) || (&Worker->rPool != this)) return false;
+
+	TTask *Task = __Acquire(Worker);
+	if (Task == nullptr) return false;
+
+	std::unique_ptr<TTask> xTask(Task);
+	(*xTask)();
+	return true;
+}
+
+bool TThreadPool::InWorker(void) const {
+	TThreadPoolWorker *Worker = __CurrentWorker;
+	return (Worker != nullptr) && (&Worker->rPool == this);
+}
+
+bool TThreadPool::SpawnedTaken(void) {
+	TThreadPoolWorker *Worker = __CurrentWorker;
+	if ((Worker != nullptr) && (&Worker->rPool == this))
+		return Worker->rDeque.Empty();
+	return ~rInjectCount == 0;
+}
+
+void* TThreadPool::__RunRunnable(TRunnable &Runnable, void *InputData) {
+	TThreadPoolWorker *Worker = __CurrentWorker;
+	if ((Worker == nullptr) || (&Worker->rPool != this))
+		FAIL(_T("{Pool %s} Runnable not running on a pool worker"), Name.c_str());
+	TWorkerThread &WorkerThread = *Worker->rThread;
+	void *Ret;
+	try {
+		Ret = Runnable.Run(WorkerThread, InputData);
+	} catch (...) {
+		Runnable.DiscardInput(InputData);
+		throw;
+	}
+	Runnable.DiscardInput(InputData);
+	return Ret;
+}
+
+std::future<void*> TThreadPool::Submit(TRunnable &Runnable, void *InputData) {
+	TRunnable *xRunnable = &Runnable;
+	return Submit([this, xRunnable, InputData] {
+		return __RunRunnable(*xRunnable, InputData);
+	});
+}
+
+#undef TPLOG
+#undef TPLOGV
+#undef TPLOGVV
@@ -0,0 +1,161 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/**
+ * @addtogroup Threading Threading Support Utilities
+ * @file
+ * @brief Work-stealing Thread Pool
+ * @author Zhenyu Wu
+ * @date Oct 17, 2026: Initial implementation
+ * @date Oct 17, 2026: Fire-and-forget tasks and helping wait
+ **/
+
+#ifndef ThreadPool_H
+#define ThreadPool_H
+
+#include "BaseLib/Misc.h"
+
+#include "Threading.h"
+#include "SyncObjs.h"
+#include "WorkerThread.h"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <future>
+#include <functional>
+#include <type_traits>
+
+class TThreadPoolWorker;
+
+/**
+ * @ingroup Threading
+ * @brief Work-stealing thread pool
+ *
+ * Runs many small tasks on a fixed set of worker threads.
+ * Each worker owns a Chase-Lev deque: tasks submitted from a worker are pushed
+ * to (and popped from) the bottom of its own deque, idle workers steal from the
+ * top of a randomly chosen victim; tasks submitted from other threads go through
+ * a shared injection queue.
+ * @note Workers are regular TWorkerThreads, so the startup / shutdown events fire as usual
+ * @note Tasks should not block on each other's futures, there is no compensation thread
+ **/
+class TThreadPool {
+	friend TThreadPoolWorker;
+public:
+	typedef std::function<void(void)> TTask;
+
+protected:
+	std::vector<TThreadPoolWorker*> rWorkers;
+	std::vector<TWorkerThread*> rThreads;
+	TSyncObj<std::deque<TTask*>> rInjection;
+	TSyncInt rInjectCount;
+	TSyncInt rIdleCount;
+	TSyncBool rStopping;
+	TSemaphore rWakeup;
+
+	void __Enqueue(TTask *Task);
+	TTask* __Acquire(TThreadPoolWorker *Worker);
+	void* __RunRunnable(TRunnable &Runnable, void *InputData);
+
+public:
+	TString const Name;
+
+	/**
+	 * Create the pool and start its worker threads
+	 * @param WorkerCount Number of workers (0 = hardware concurrency)
+	 **/
+	TThreadPool(TString const &xName, size_t WorkerCount = 0, SIZE_T StackSize = 0);
+	~TThreadPool(void);
+
+	/**
+	 * Submit a callable for execution
+	 * @return Future of the callable's result (exceptions are forwarded)
+	 **/
+	template<class F>
+	std::future<typename std::result_of<F(void)>::type> Submit(F &&Func);
+
+	/**
+	 * Submit a runnable for execution on one of the pool workers
+	 * @note The input data is discarded after the run, as if by a dedicated worker thread
+	 * @note The caller owns the data returned through the future
+	 **/
+	std::future<void*> Submit(TRunnable &Runnable, void *InputData);
+
+	/**
+	 * Submit a callable for execution, without a future
+	 * @note The callable must not throw, there is nobody to receive the exception
+	 **/
+	template<class F>
+	void Spawn(F &&Func)
+	{ __Enqueue(new TTask(std::forward<F>(Func))); }
+
+	/**
+	 * Run one pending task on the calling thread (if any)
+	 * Used for waiting without blocking a worker, which keeps nested parallelism deadlock-free
+	 * @return Whether a task was run
+	 * @note Only workers of this pool run tasks, other threads always get false
+	 **/
+	bool HelpOne(void);
+
+	/**
+	 * Check whether the calling thread is a worker of this pool
+	 **/
+	bool InWorker(void) const;
+
+	/**
+	 * Check whether all tasks submitted by the calling thread have been picked up
+	 * (from its own deque on a pool worker, from the injection queue elsewhere)
+	 * Used for splitting work lazily, only when other workers are looking for it
+	 **/
+	bool SpawnedTaken(void);
+
+	/**
+	 * Finish all submitted tasks and stop the workers
+	 * @note Must not be called from within a pool worker
+	 **/
+	void Shutdown(void);
+
+	size_t WorkerCount(void) const
+	{ return rWorkers.size(); }
+};
+
+template<class F>
+std::future<typename std::result_of<F(void)>::type> TThreadPool::Submit(F &&Func) {
+	typedef typename std::result_of<F(void)>::type TResult;
+	// packaged_task is move-only, while std::function requires copyable targets
+	auto Task = std::make_shared<std::packaged_task<TResult(void)>>(std::forward<F>(Func));
+	std::future<TResult> Ret(Task->get_future());
+	__Enqueue(new TTask([Task] { (*Task)(); }));
+	return Ret;
+}
+
+#endif //ThreadPool_H
@@ -79,6 +79,12 @@ CurLoad(0), SampleCount(xMInterval / xTInterval), SamplePtr(0), Samples(SampleCo
 		TTFAIL(_T("WARNING: Throttling interval %d smaller than recommended value %d"), xTInterval, xMInterval / MTRatioLarge);
 	if (xLoadLimit >= MAXLOAD)
 		TTLOG(_T("WARNING: Load limit %d is higher than the maximum hardware concurrency (%d)"), xLoadLimit, MAXLOAD);
+	PublishStatus();
+}
+
+void ThreadThrottler::PublishStatus(void) {
+	TStatus xStatus = { rState, CurLoad, ThrottleCount, ThrottleTime };
+	Status.Assign(xStatus);
 }
 
 LPCTSTR ThreadThrottler::STR_State(State const &xState) {
@@ -131,27 +137,27 @@ void ThreadThrottler::Bump(void) {
 }
 
 double ThreadThrottler::GetLoadFactor(void) const {
-	Synchronized((*const_cast<TLockableCS*>(&RunLock)), {
-		return LoadLimit ? (double)CurLoad / LoadLimit : INFINITY;
-	});
+	TStatus xStatus;
+	Status.Snapshot(xStatus);
+	return LoadLimit ? (double)xStatus.CurLoad / LoadLimit : INFINITY;
 }
 
 ThreadThrottler::State ThreadThrottler::CurrentState(void) const {
-	Synchronized((*const_cast<TLockableCS*>(&RunLock)), {
-		return rState;
-	});
+	TStatus xStatus;
+	Status.Snapshot(xStatus);
+	return xStatus.rState;
 }
 
 UINT64 ThreadThrottler::GetThrottleCount(void) const {
-	Synchronized((*const_cast<TLockableCS*>(&RunLock)), {
-		return ThrottleCount;
-	});
+	TStatus xStatus;
+	Status.Snapshot(xStatus);
+	return xStatus.ThrottleCount;
 }
 
 UINT64 ThreadThrottler::GetThrottleTime(void) const {
-	Synchronized((*const_cast<TLockableCS*>(&RunLock)), {
-		return ThrottleTime;
-	});
+	TStatus xStatus;
+	Status.Snapshot(xStatus);
+	return xStatus.ThrottleTime;
 }
 
 void ThreadThrottler::StateCheck(DWORD &WaitTime) {
@@ -253,6 +259,8 @@ void ThreadThrottler::StateCheck(DWORD &WaitTime) {
 				break;
 		}
 	});
+	// Only the throttler thread modifies the status
+	PublishStatus();
 }
 
 void* ThreadThrottler::Run(TWorkerThread& WorkerThread, void* NoUse) {
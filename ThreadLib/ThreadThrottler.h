@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @author Zhenyu Wu
  * @date Nov 13, 2013: Initial implementation
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Lock-free status queries
  **/
 
 #ifndef ThreadThrottler_H
@@ -45,6 +46,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "BaseLib/Misc.h"
 
 #include "Threading.h"
+#include "SyncObjs.h"
 #include "WorkerThread.h"
 
 #include <vector>
@@ -90,6 +92,16 @@ protected:
 	std::vector<TSample> Samples;
 	int SamplePtr;
 
+	struct TStatus {
+		State rState;
+		DWORD CurLoad;
+		UINT64 ThrottleCount;
+		UINT64 ThrottleTime;
+	};
+	//! Published copy of the running status, readers never block the throttler
+	TSyncObj<TStatus, SimpleAllocator<TStatus>, TLockableSeq> Status;
+	void PublishStatus(void);
+
 	void RegisterWorker(TWorkerThread *Worker);
 	void UnregisterWorker(TWorkerThread *Worker);
 
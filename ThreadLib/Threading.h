@@ -37,6 +37,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @date Jul 31, 2013: Port to Visual C++ 2012
  * @date Jan 29, 2014: Make the code C++ style (avoid performance hit of __try __finally)
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Read-only synchronized code wrapper
  **/
 
 #ifndef Threading_H
@@ -54,14 +55,19 @@ typedef TInterlockedSyncOrdinal64<UINT64> TSyncUInt64;
 typedef TInterlockedSyncOrdinal32<BOOL> TSyncBool;
 typedef TInterlockedSyncOrdinal<PVOID> TSyncPtr;
 
+// Native width interlocked operations (on LONG_PTR)
 #ifdef _WIN64
 typedef INT64 __ARC_INT;
 typedef UINT64 __ARC_UINT;
 typedef TSyncInt64 TSyncInt;
+#define __ARC_InterlockedCompareExchange	InterlockedCompareExchange64
+#define __ARC_InterlockedExchangeAdd		InterlockedExchangeAdd64
 #else
 typedef INT32 __ARC_INT;
 typedef UINT32 __ARC_UINT;
 typedef TSyncInt32 TSyncInt;
+#define __ARC_InterlockedCompareExchange	InterlockedCompareExchange
+#define __ARC_InterlockedExchangeAdd		InterlockedExchangeAdd
 #endif //_WIN64
 
 /**
@@ -72,6 +78,14 @@ typedef TSyncInt32 TSyncInt;
 **/
 #define Synchronized(lockable,code) { auto __Lock__ = lockable.SyncLock(); code; }
 
+/**
+ * @ingroup Threading
+ * @brief Synchronized Read-only Code Wrapper
+ *
+ * Make a piece of read-only code synchronized with respect to a lockable object
+ **/
+#define SynchronizedShared(lockable,code) { auto __Lock__ = lockable.SyncLockShared(); code; }
+
 //extern TLockable* Lock_ConsoleIn;
 //extern TLockable* Lock_ConsoleOut;
 //extern TLockable* Lock_ConsoleErr;
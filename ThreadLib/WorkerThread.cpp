@@ -171,14 +171,148 @@ TWorkerThread::~TWorkerThread(void) {
 		delete rException;
 }
 
-void TWorkerThread::__ThreadStart(SIZE_T StackSize) {
+void TWorkerThread::__ThreadStart(TThreadAttributes const &Attributes) {
 	auto ForwardRec = new WorkerThreadForwardRec{this, &TWorkerThread::__CallForwarder_Outer, rSelfFree};
-	rThread = CreateThread(nullptr, StackSize, &ThreadProc, ForwardRec, 0, const_cast<LPDWORD>(&ThreadID));
+	// Start suspended, so that the attributes are in effect before the runnable starts
+	rThread = CreateThread(nullptr, Attributes.StackSize, &ThreadProc, ForwardRec, CREATE_SUSPENDED, const_cast<LPDWORD>(&ThreadID));
 	if (rThread == nullptr) {
 		DWORD ErrCode = GetLastError();
 		delete ForwardRec;
 		SYSERRFAIL(ErrCode, _T("Failed to create thread for worker '%s'"), Name.c_str());
 	}
+
+	TThreadAttributes Initial(Attributes);
+	if (Initial.Name.empty()) Initial.Name = Name;
+	SetAttributes(Initial);
+	ResumeThread(rThread);
+}
+
+#ifdef UNICODE
+
+typedef HRESULT(WINAPI *TSetThreadDescription)(HANDLE hThread, PCWSTR lpThreadDescription);
+typedef HRESULT(WINAPI *TGetThreadDescription)(HANDLE hThread, PWSTR *ppszThreadDescription);
+
+// Thread descriptions are only available on Windows 10 (1607) or later
+static TSetThreadDescription __SetThreadDescription(void) {
+	static TSetThreadDescription Func =
+		(TSetThreadDescription)GetProcAddress(GetModuleHandle(_T("kernel32.dll")), "SetThreadDescription");
+	return Func;
+}
+
+static TGetThreadDescription __GetThreadDescription(void) {
+	static TGetThreadDescription Func =
+		(TGetThreadDescription)GetProcAddress(GetModuleHandle(_T("kernel32.dll")), "GetThreadDescription");
+	return Func;
+}
+
+#endif
+
+void TWorkerThread::__SetThreadName(TString const &xName) {
+#ifdef UNICODE
+	auto SetDescription = __SetThreadDescription();
+	if (SetDescription != nullptr) {
+		HRESULT Ret = SetDescription(rThread, xName.c_str());
+		if (FAILED(Ret))
+			SYSERRFAIL(Ret, _T("Failed to set name of worker '%s'"), Name.c_str());
+		return;
+	}
+#endif
+	WTLOGVV(_T("Thread naming not supported by the system"));
+}
+
+void TWorkerThread::__SetAffinity(DWORD_PTR AffinityMask, USHORT NUMANode) {
+	GROUP_AFFINITY Affinity;
+	ZeroMemory(&Affinity, sizeof(GROUP_AFFINITY));
+	if (NUMANode != TThreadAttributes::NodeAny) {
+		if (!GetNumaNodeProcessorMaskEx(NUMANode, &Affinity))
+			SYSFAIL(_T("Failed to query processors of NUMA node %d"), NUMANode);
+		if (AffinityMask != 0) {
+			Affinity.Mask &= AffinityMask;
+			if (Affinity.Mask == 0)
+				WTFAIL(_T("Affinity mask %p has no processor on NUMA node %d"), (PVOID)AffinityMask, NUMANode);
+		}
+	} else {
+		if (!GetThreadGroupAffinity(rThread, &Affinity))
+			SYSFAIL(_T("Failed to query affinity of worker '%s'"), Name.c_str());
+		Affinity.Mask = AffinityMask;
+	}
+	if (!SetThreadGroupAffinity(rThread, &Affinity, nullptr))
+		SYSFAIL(_T("Failed to set affinity of worker '%s'"), Name.c_str());
+	WTLOGVV(_T("Affinity set to group %d, mask %p"), Affinity.Group, (PVOID)Affinity.Mask);
+}
+
+void TWorkerThread::__SetPriority(int Priority) {
+	if (!SetThreadPriority(rThread, Priority))
+		SYSFAIL(_T("Failed to set priority of worker '%s'"), Name.c_str());
+	WTLOGVV(_T("Priority set to %d"), Priority);
+}
+
+bool TWorkerThread::SetAttributes(TThreadAttributes const &Attributes) {
+	bool Ret = true;
+	// Each field is applied on its own, a failed one does not hold back the others
+	auto Failed = [&](LPCTSTR Field, Exception *e) {
+		WTLOG(_T("WARNING: Failed to apply %s - %s"), Field, e->Why());
+		delete e;
+		Ret = false;
+	};
+	if ((Attributes.AffinityMask != 0) || (Attributes.NUMANode != TThreadAttributes::NodeAny)) {
+		try {
+			__SetAffinity(Attributes.AffinityMask, Attributes.NUMANode);
+		} catch (Exception *e) {
+			Failed(_T("affinity"), e);
+		}
+	}
+	if (Attributes.Priority != TThreadAttributes::PriorityAny) {
+		try {
+			__SetPriority(Attributes.Priority);
+		} catch (Exception *e) {
+			Failed(_T("priority"), e);
+		}
+	}
+	if (!Attributes.Name.empty()) {
+		try {
+			__SetThreadName(Attributes.Name);
+		} catch (Exception *e) {
+			Failed(_T("name"), e);
+		}
+	}
+	return Ret;
+}
+
+TThreadAttributes TWorkerThread::GetAttributes(void) {
+	TThreadAttributes Ret;
+
+	GROUP_AFFINITY Affinity;
+	if (!GetThreadGroupAffinity(rThread, &Affinity))
+		SYSFAIL(_T("Failed to query affinity of worker '%s'"), Name.c_str());
+	Ret.AffinityMask = Affinity.Mask;
+
+	ULONG HighestNode;
+	if (GetNumaHighestNodeNumber(&HighestNode)) {
+		for (USHORT Node = 0; Node <= HighestNode; Node++) {
+			GROUP_AFFINITY NodeAffinity;
+			if (GetNumaNodeProcessorMaskEx(Node, &NodeAffinity) && (NodeAffinity.Group == Affinity.Group)
+				&& ((Affinity.Mask & ~NodeAffinity.Mask) == 0)) {
+				Ret.NUMANode = Node;
+				break;
+			}
+		}
+	}
+
+	Ret.Priority = GetThreadPriority(rThread);
+	if (Ret.Priority == THREAD_PRIORITY_ERROR_RETURN)
+		SYSFAIL(_T("Failed to query priority of worker '%s'"), Name.c_str());
+
+	Ret.Name = Name;
+#ifdef UNICODE
+	auto GetDescription = __GetThreadDescription();
+	PWSTR Description;
+	if ((GetDescription != nullptr) && SUCCEEDED(GetDescription(rThread, &Description))) {
+		if (*Description) Ret.Name = Description;
+		LocalFree(Description);
+	}
+#endif
+	return Ret;
 }
 
 class WTStackWalker : public StackWalker {
@@ -37,6 +37,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * @date Jul 31, 2013: Port to Visual C++ 2012
  * @date Nov 18, 2013: Major modeling upgrade
  * @date Jan 22, 2016: Initial Public Release
+ * @date Oct 17, 2026: Thread attributes (affinity, NUMA node, priority, name)
  **/
 
 #ifndef WorkerThread_H
@@ -45,6 +46,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Threading.h"
 
 class TWorkerThread;
+class TThreadPool;
 
 /**
  * @ingroup Threading
@@ -54,6 +56,7 @@ class TWorkerThread;
  **/
 class TRunnable {
 	friend TWorkerThread;
+	friend TThreadPool;
 protected:
 	virtual ~TRunnable(void) {}
 
@@ -78,6 +81,34 @@ protected:
 	virtual void DiscardReturn(void *RetData) {}
 };
 
+/**
+ * @ingroup Threading
+ * @brief Worker thread attributes
+ *
+ * Scheduling and identification attributes of a worker thread;
+ * fields left at their default values are not applied
+ **/
+struct TThreadAttributes {
+	//! NUMA node value for "no preference"
+	static USHORT const NodeAny = 0xFFFF;
+	//! Priority value for "not specified"
+	static int const PriorityAny = THREAD_PRIORITY_ERROR_RETURN;
+
+	//! Stack size (creation only, 0 = executable default)
+	SIZE_T StackSize;
+	//! Processor affinity mask, relative to the processor group (of the NUMA node, if specified)
+	DWORD_PTR AffinityMask;
+	//! Preferred NUMA node, the thread is confined to the processors of the node
+	USHORT NUMANode;
+	//! Scheduling priority (THREAD_PRIORITY_*, Windows equivalent of the nice level)
+	int Priority;
+	//! Thread name shown in debuggers and profilers (empty = worker name at creation)
+	TString Name;
+
+	explicit TThreadAttributes(SIZE_T xStackSize = 0) :
+		StackSize(xStackSize), AffinityMask(0), NUMANode(NodeAny), Priority(PriorityAny) {}
+};
+
 class ThreadThrottler;
 
 /**
@@ -98,7 +129,10 @@ public:
 	LPCTSTR STR_State(State const &xState);
 
 private:
-	void __ThreadStart(SIZE_T StackSize);
+	void __ThreadStart(TThreadAttributes const &Attributes);
+	void __SetThreadName(TString const &xName);
+	void __SetAffinity(DWORD_PTR AffinityMask, USHORT NUMANode);
+	void __SetPriority(int Priority);
 	int CollectSEHException(struct _EXCEPTION_POINTERS *SEH);
 	DWORD __CallForwarder_Outer(void);
 	void __CallForwarder_Inner(void);
@@ -127,7 +161,19 @@ public:
 		rRunnable(Runnable), rInputData(InputData), rReturnData(nullptr), rSelfFree(SelfFree),
 		rThread(nullptr), rException(nullptr), rState((__ARC_INT)State::Initialzing), rThrottler(nullptr),
 		Name(xName), ThreadID(0) {
-		__ThreadStart(StackSize);
+		__ThreadStart(TThreadAttributes(StackSize));
+	}
+
+	/**
+	 * Create and start the thread with given attributes
+	 * @note Attributes that failed to apply are logged, and do not prevent the thread from starting
+	 **/
+	template<class IRunnable>
+	TWorkerThread(TString const &xName, IRunnable &Runnable, void* InputData, TThreadAttributes const &Attributes, bool SelfFree = false) :
+		rRunnable(Runnable), rInputData(InputData), rReturnData(nullptr), rSelfFree(SelfFree),
+		rThread(nullptr), rException(nullptr), rState((__ARC_INT)State::Initialzing), rThrottler(nullptr),
+		Name(xName), ThreadID(0) {
+		__ThreadStart(Attributes);
 	}
 
 	~TWorkerThread(void) override;
@@ -149,6 +195,19 @@ public:
 	 **/
 	void Throttler(ThreadThrottler *xThrottler);
 
+	/**
+	 * Adjust the attributes of the running thread
+	 * @note Only the specified fields are applied, the stack size is ignored
+	 * @note Each field is applied independently, failures are logged
+	 * @return true if all specified fields were applied
+	 **/
+	bool SetAttributes(TThreadAttributes const &Attributes);
+	/**
+	 * Query the current attributes of the thread
+	 * @note NUMA node is reported only if the affinity is confined to a single node
+	 **/
+	TThreadAttributes GetAttributes(void);
+
 	/**
 	 * Get the return data of the thread
 	 * @note Must be called AFTER worker thread goes to wtsTerminated
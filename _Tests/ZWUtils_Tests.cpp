@@ -32,18 +32,25 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "BaseLib/MMSwitcher.h"
 
 #include <Windows.h>
+#include <cmath>
 
 #include "BaseLib/Misc.h"
 
 #include "BaseLib/DebugLog.h"
 #include "BaseLib/Exception.h"
 #include "BaseLib/WinError.h"
+#include "BaseLib/Allocator.h"
+#include "BaseLib/RecMMAnalyzer.h"
 
 #include "ThreadLib/SyncObjs.h"
 #include "ThreadLib/WorkerThread.h"
 #include "ThreadLib/SyncQueue.h"
+#include "ThreadLib/SyncRingQueue.h"
 #include "ThreadLib/SyncObjPool.h"
 #include "ThreadLib/ThreadThrottler.h"
+#include "ThreadLib/ThreadPool.h"
+#include "ThreadLib/Parallel.h"
+#include "ThreadLib/FiberScheduler.h"
 #include "ThreadLib/StackWalker.h"
 
 #include "Modeling/Identifier.h"
@@ -98,18 +105,48 @@ protected:
 	}
 };
 
+class TestIdle : public TRunnable {
+protected:
+	void* Run(TWorkerThread &WorkerThread, void* pEvent) override {
+		static_cast<TEvent*>(pEvent)->WaitFor();
+		return nullptr;
+	}
+};
+
 typedef TSyncQueue<int> TSyncIntQueue;
+typedef TSyncQueue<int, TRingMPMC<int>> TSyncIntRingQueue;
+typedef TSyncQueue<int, TRingSPSC<int>> TSyncIntSPSCQueue;
+
+struct TFragileEntry {
+	int Value;
+	TFragileEntry(void) : Value(0) {}
+	TFragileEntry(int xValue) : Value(xValue) {
+		if (xValue < 0) FAIL(_T("Refused to construct entry %d"), xValue);
+	}
+};
+
+struct TFragileMove {
+	int Value;
+	TFragileMove(int xValue = 0) : Value(xValue) {}
+	TFragileMove& operator=(TFragileMove &&Other) {
+		if (Other.Value < 0) FAIL(_T("Refused to move entry %d"), Other.Value);
+		Value = Other.Value;
+		return *this;
+	}
+};
 
+template<class CSyncQueue = TSyncIntQueue>
 class TestQueuePut : public TRunnable {
 protected:
 	void* Run(TWorkerThread &WorkerThread, void* pSyncIntQueue) override {
-		TSyncIntQueue& Q = *(TSyncIntQueue*)pSyncIntQueue;
+		CSyncQueue& Q = *(CSyncQueue*)pSyncIntQueue;
 
 		int COUNT = IsDebuggerPresent() ? 10000 : 1000000;
 		Flatten_FILETIME StartTime;
 		GetSystemTimeAsFileTime(&StartTime.FileTime);
 		for (int i = 0; i < COUNT; i++)
-			Q.Enqueue(i);
+			while (Q.Enqueue(i) == 0)
+				SwitchToThread();
 		Flatten_FILETIME EndTime;
 		GetSystemTimeAsFileTime(&EndTime.FileTime);
 
@@ -119,10 +156,11 @@ protected:
 	}
 };
 
+template<class CSyncQueue = TSyncIntQueue>
 class TestQueueGet : public TRunnable {
 protected:
 	void* Run(TWorkerThread &WorkerThread, void* pSyncIntQueue) override {
-		TSyncIntQueue& Q = *(TSyncIntQueue*)pSyncIntQueue;
+		CSyncQueue& Q = *(CSyncQueue*)pSyncIntQueue;
 		int j = -1;
 
 		int COUNT = IsDebuggerPresent() ? 10000 : 1000000;
@@ -144,13 +182,28 @@ protected:
 
 typedef TSyncObjPool<Integer> TSyncIntPool;
 
+struct TFragilePayload {
+	static int Budget;
+	static int Live;
+	int value;
+	TFragilePayload(void) : value(0) {
+		if (Budget-- <= 0) FAIL(_T("Construction budget exhausted"));
+		Live++;
+	}
+	~TFragilePayload(void)
+	{ Live--; }
+};
+int TFragilePayload::Budget = 0;
+int TFragilePayload::Live = 0;
+
+template<class CSyncPool = TSyncIntPool>
 class TestSyncPool : public TRunnable {
 private:
-	TSyncQueue<TSyncIntPool::TSyncPoolObj*> ObjQueue;
+	TSyncQueue<typename CSyncPool::TSyncPoolObj*> ObjQueue;
 	TSyncBool SenderReceiver;
 protected:
 	void* Run(TWorkerThread &WorkerThread, void* pSyncIntPool) override {
-		TSyncIntPool& Pool = *(TSyncIntPool*)pSyncIntPool;
+		CSyncPool& Pool = *(CSyncPool*)pSyncIntPool;
 
 		int COUNT = IsDebuggerPresent() ? 10000 : 1000000;
 
@@ -160,7 +213,7 @@ protected:
 			Flatten_FILETIME StartTime;
 			GetSystemTimeAsFileTime(&StartTime.FileTime);
 			for (int i = 0; i < COUNT; i++) {
-				TSyncIntPool::TSyncPoolObj *Entry = Pool.Acquire();
+				typename CSyncPool::TSyncPoolObj *Entry = Pool.Acquire();
 				ObjQueue.Enqueue(Entry);
 			}
 			Flatten_FILETIME EndTime;
@@ -174,7 +227,7 @@ protected:
 			Flatten_FILETIME StartTime;
 			GetSystemTimeAsFileTime(&StartTime.FileTime);
 			for (int i = 0; i < COUNT; i++) {
-				TSyncIntPool::TSyncPoolObj *Entry;
+				typename CSyncPool::TSyncPoolObj *Entry;
 				ObjQueue.Dequeue(Entry);
 				Entry->Release();
 			}
@@ -273,6 +326,48 @@ void TestSyncObj(void) {
 	LOG(_T("d = %d"), d);
 	LOG(_T("a = %d"), (Integer&)a.Pickup());
 
+	LOG(_T("--- Re-entrant pickup"));
+	{
+		auto rA(a.Pickup());
+		auto rA2(a.Pickup());
+		(*rA2)++;
+		LOG(_T("a = %d"), (Integer&)rA);
+	}
+
+	LOG(_T("--- Shared pickup"));
+	{
+		TSyncObj<Integer, SimpleAllocator<Integer>, TLockableSRW> f(7);
+		auto rF(f.PickupShared());
+		auto rF2(f.PickupShared());
+		LOG(_T("f = %d"), (Integer const&)rF2);
+		if (&f.TryPickup() != nullptr)
+			FAIL(_T("Exclusive pickup while shared"));
+	}
+
+	LOG(_T("--- Optimistic snapshot"));
+	{
+		struct TPair { int A; int B; };
+		TPair Init = { 1, 2 };
+		TSyncObj<TPair, SimpleAllocator<TPair>, TLockableSeq> f(Init);
+		Init.B = 3;
+		f.Assign(Init);
+		TPair Snap;
+		f.Snapshot(Snap);
+		LOG(_T("f = {%d, %d}"), Snap.A, Snap.B);
+		if (Snap.B != 3)
+			FAIL(_T("Snapshot mismatch"));
+
+		// Snapshot by the writer itself must not wait for the write to finish
+		{
+			auto Writer(f.Pickup());
+			Writer->B = 4;
+			f.Snapshot(Snap);
+		}
+		LOG(_T("f = {%d, %d}"), Snap.A, Snap.B);
+		if (Snap.B != 4)
+			FAIL(_T("Snapshot mismatch"));
+	}
+
 	LOG(_T("--- Hand-off Construction (No memory leak)"));
 	TSyncInteger _b(HANDOFF_CONSTRUCT, new Integer(123));
 	LOG(_T("_b = %d"), (Integer&)_b.Pickup());
@@ -304,6 +399,35 @@ void TestSyncObj(void) {
 
 	LOG(_T("--- Finished All Counting..."));
 	LOG(_T("e = %d"), (Integer&)e.Pickup());
+
+	LOG(_T("*** Test WorkerThread (Attributes)"));
+	{
+		TestIdle IdleRun;
+		TEvent Release(true, false);
+		TThreadAttributes PinnedAttributes;
+		PinnedAttributes.AffinityMask = 1;
+		PinnedAttributes.Priority = THREAD_PRIORITY_BELOW_NORMAL;
+		TWorkerThread TestWT(_T("PinnedThread"), IdleRun, &Release, PinnedAttributes);
+
+		TThreadAttributes Attributes(TestWT.GetAttributes());
+		LOG(_T("PinnedThread: Affinity %p, NUMA node %d, Priority %d, Name '%s'"), (PVOID)Attributes.AffinityMask,
+			Attributes.NUMANode, Attributes.Priority, Attributes.Name.c_str());
+		if ((Attributes.AffinityMask != 1) || (Attributes.Priority != THREAD_PRIORITY_BELOW_NORMAL))
+			FAIL(_T("Thread attributes not applied at creation"));
+
+		// A failed field does not prevent the others from being applied
+		TThreadAttributes Adjust;
+		Adjust.NUMANode = 0xFFFE;
+		Adjust.Priority = THREAD_PRIORITY_ABOVE_NORMAL;
+		if (TestWT.SetAttributes(Adjust))
+			FAIL(_T("Invalid NUMA node accepted"));
+		if (TestWT.GetAttributes().Priority != THREAD_PRIORITY_ABOVE_NORMAL)
+			FAIL(_T("Priority not applied along with a failed field"));
+
+		Release.Set();
+		TestWT.WaitFor();
+	}
+	LOCKPROF(TLockProfile::Report());
 }
 
 void TestSyncQueue(void) {
@@ -318,15 +442,175 @@ void TestSyncQueue(void) {
 		FAIL(_T("Should not reach"))
 	else
 	LOG(_T("Failed to dequeue (expected)"));
+	LOG(_T("--- Wait 500 microseconds and fail"));
+	UINT64 DeadlineStart = TDeadline::Now();
+	if (TestQueue.Dequeue(f, TDeadline::After(500000)))
+		FAIL(_T("Should not reach"));
+	LOG(_T("Failed to dequeue after %d us (expected)"), (int)((TDeadline::Now() - DeadlineStart) / 1000));
+
+	LOG(_T("--- Bulk enqueue 5 + 3 entries, bulk dequeue 4 + 4 entries"));
+	int Batch[] = {1, 2, 3, 4, 5};
+	TestQueue.EnqueueBulk(std::begin(Batch), std::end(Batch));
+	TestQueue.EnqueueBulk(std::vector<int>({6, 7, 8}));
+	std::vector<int> Received;
+	size_t BulkCnt1 = TestQueue.DequeueBulk(Received, 4);
+	size_t BulkCnt2 = TestQueue.DequeueBulk(Received, 16, 0);
+	if ((BulkCnt1 != 4) || (BulkCnt2 != 4) || (Received.back() != 8))
+		FAIL(_T("Unexpected bulk operation result (%d, %d)"), (int)BulkCnt1, (int)BulkCnt2);
+	if (TestQueue.DequeueBulk(Received, 16, 100) != 0)
+		FAIL(_T("Should not reach"));
+
+	LOG(_T("*** Test SyncQueue (Bounded, non-threading correctness)"));
+	TSyncIntQueue BoundedQueue(_T("TestQueue2"), 4);
+	BoundedQueue.SetWatermarks(3, 1, [](TSyncIntQueue &Queue, bool High) {
+		LOG(_T("Queue '%s' reached %s watermark"), Queue.Name.c_str(), High ? _T("high") : _T("low"));
+	});
+	for (int i = 0; i < 4; i++)
+		BoundedQueue.Enqueue(i, 0);
+	if (BoundedQueue.Enqueue(4, 0) != 0)
+		FAIL(_T("Should not reach"));
+	LOG(_T("--- Wait 2 seconds and fail"));
+	if (BoundedQueue.Enqueue(4, 2000) != 0)
+		FAIL(_T("Should not reach"))
+	else
+	LOG(_T("Failed to enqueue (expected)"));
+	LOG(_T("--- Emplace with timeout, then with abort event (expect both fail)"));
+	if (BoundedQueue.Emplace_EnqueueWait(100, nullptr, 4) != 0)
+		FAIL(_T("Should not reach"));
+	TEvent EnqueueAbort(true, true);
+	if (BoundedQueue.Emplace_EnqueueWait(INFINITE, &EnqueueAbort, 4) != 0)
+		FAIL(_T("Should not reach"));
+	Received.clear();
+	BoundedQueue.DequeueBulk(Received, 3);
+	LOG(_T("--- Bulk enqueue 5 entries (expect 3 enqueued)"));
+	std::vector<int> Pending({5, 6, 7, 8, 9});
+	size_t BulkCnt3 = BoundedQueue.EnqueueBulk(std::move(Pending), 0);
+	if ((BulkCnt3 != 3) || (Pending.size() != 2))
+		FAIL(_T("Unexpected bulk operation result (%d)"), (int)BulkCnt3);
 
 	LOG(_T("*** Test SyncQueue (Threading correctness)"));
 	TSyncIntQueue Queue(_T("SyncIntQueue"));
-	TestQueuePut TestQPut;
+	TestQueuePut<> TestQPut;
 	TWorkerThread TestWTQPut(_T("QueuePutThread"), TestQPut, &Queue);
-	TestQueueGet TestQGet;
+	TestQueueGet<> TestQGet;
 	TWorkerThread TestWTQGet(_T("QueueGetThread"), TestQGet, &Queue);
 	TestWTQGet.WaitFor();
 	LOG(_T("--- Finished All Queue Operation..."));
+
+	LOG(_T("*** Test SyncQueue (Lock-free MPMC ring, non-threading correctness)"));
+	TSyncIntRingQueue TestRingQueue(_T("TestRingQueue1"), 3);
+	LOG(_T("Ring capacity: %d"), (int)TestRingQueue.Capacity());
+	TestRingQueue.Emplace_Enqueue(123);
+	TestRingQueue.Enqueue(456);
+	TestRingQueue.Enqueue(789);
+	TestRingQueue.Enqueue(0);
+	if (TestRingQueue.Enqueue(-1) != 0)
+		FAIL(_T("Should not reach"));
+	TestRingQueue.Dequeue(f);
+	LOG(_T("f = %d (length %d)"), f, (int)TestRingQueue.Length());
+	LOG(_T("--- Failed construction must not stall the ring"));
+	TSyncQueue<TFragileEntry, TRingMPMC<TFragileEntry>> FragileQueue(_T("TestRingQueue2"), 4);
+	bool Constructed = true;
+	try {
+		FragileQueue.Emplace_Enqueue(-1);
+	} catch (Exception *e) {
+		e->Show();
+		delete e;
+		Constructed = false;
+	}
+	if (Constructed)
+		FAIL(_T("Should not reach"));
+	FragileQueue.Emplace_Enqueue(42);
+	TFragileEntry FragileEntry;
+	if (!FragileQueue.Dequeue(FragileEntry, 0) || (FragileEntry.Value != 42))
+		FAIL(_T("Unexpected entry after failed construction (%d)"), FragileEntry.Value);
+	if (FragileQueue.Dequeue(FragileEntry, 0))
+		FAIL(_T("Should not reach"));
+	LOG(_T("--- Failed bulk construction keeps the partial batch"));
+	{
+		TSyncQueue<TFragileEntry> FragileBulkQueue(_T("TestQueue3"));
+		int const Values[] = {1, 2, -3, 4};
+		bool Enqueued = true;
+		try {
+			FragileBulkQueue.EnqueueBulk(std::begin(Values), std::end(Values));
+		} catch (Exception *e) {
+			e->Show();
+			delete e;
+			Enqueued = false;
+		}
+		if (Enqueued || (FragileBulkQueue.Length() != 2))
+			FAIL(_T("Unexpected partial batch (length %d)"), (int)FragileBulkQueue.Length());
+		std::vector<TFragileEntry> FragileEntries;
+		if ((FragileBulkQueue.DequeueBulk(FragileEntries, 4, 0) != 2) || (FragileEntries.back().Value != 2))
+			FAIL(_T("Partial batch not dequeued"));
+	}
+	LOG(_T("--- Failed move out must not stall the ring"));
+	{
+		TSyncQueue<TFragileMove, TRingMPMC<TFragileMove>> FragileMoveQueue(_T("TestRingQueue3"), 4);
+		FragileMoveQueue.Emplace_Enqueue(-1);
+		FragileMoveQueue.Emplace_Enqueue(42);
+		TFragileMove MoveEntry;
+		bool Moved = true;
+		try {
+			FragileMoveQueue.Dequeue(MoveEntry, 0);
+		} catch (Exception *e) {
+			e->Show();
+			delete e;
+			Moved = false;
+		}
+		if (Moved)
+			FAIL(_T("Should not reach"));
+		if (!FragileMoveQueue.Dequeue(MoveEntry, 0) || (MoveEntry.Value != 42))
+			FAIL(_T("Unexpected entry after failed move (%d)"), MoveEntry.Value);
+	}
+
+	LOG(_T("*** Test SyncQueue (Lock-free MPMC ring, threading correctness)"));
+	TSyncIntRingQueue RingQueue(_T("SyncIntRingQueue"), 1024);
+	TestQueuePut<TSyncIntRingQueue> TestRQPut;
+	TWorkerThread TestWTRQPut(_T("RingQueuePutThread"), TestRQPut, &RingQueue);
+	TestQueueGet<TSyncIntRingQueue> TestRQGet;
+	TWorkerThread TestWTRQGet(_T("RingQueueGetThread"), TestRQGet, &RingQueue);
+	TestWTRQGet.WaitFor();
+	LOG(_T("--- Finished All Ring Queue Operation..."));
+
+	LOG(_T("*** Test SyncQueue (Wait-free SPSC ring, non-threading correctness)"));
+	TSyncIntSPSCQueue TestSPSCQueue(_T("TestSPSCQueue1"), 3);
+	if (TestSPSCQueue.Capacity() != 4)
+		FAIL(_T("Unexpected ring capacity (%d)"), (int)TestSPSCQueue.Capacity());
+	if (TestSPSCQueue.Dequeue(f, 0))
+		FAIL(_T("Should not reach"));
+	for (int Round = 0; Round < 3; Round++) {
+		// Fill up and drain across the wrap-around
+		for (int i = 0; i < 4; i++)
+			if (TestSPSCQueue.Enqueue(Round * 4 + i) == 0)
+				FAIL(_T("Unexpected full ring at entry %d"), i);
+		if (TestSPSCQueue.Enqueue(-1) != 0)
+			FAIL(_T("Should not reach"));
+		if (TestSPSCQueue.Length() != 4)
+			FAIL(_T("Unexpected ring length (%d)"), (int)TestSPSCQueue.Length());
+		for (int i = 0; i < 4; i++)
+			if (!TestSPSCQueue.Dequeue(f, 0) || (f != Round * 4 + i))
+				FAIL(_T("Unexpected entry %d (expect %d)"), f, Round * 4 + i);
+		if (TestSPSCQueue.Length() != 0)
+			FAIL(_T("Unexpected ring length (%d)"), (int)TestSPSCQueue.Length());
+	}
+	LOG(_T("--- Wait 100 ms on empty ring and fail"));
+	UINT64 SPSCWaitStart = TDeadline::Now();
+	if (TestSPSCQueue.Dequeue(f, 100))
+		FAIL(_T("Should not reach"));
+	UINT64 SPSCWaitTime = (TDeadline::Now() - SPSCWaitStart) / 1000000;
+	if (SPSCWaitTime < 100)
+		FAIL(_T("Dequeue timed out early (%d ms)"), (int)SPSCWaitTime);
+	LOG(_T("Failed to dequeue after %d ms (expected)"), (int)SPSCWaitTime);
+
+	LOG(_T("*** Test SyncQueue (Wait-free SPSC ring, threading correctness)"));
+	TSyncIntSPSCQueue SPSCQueue(_T("SyncIntSPSCQueue"), 1024);
+	TestQueuePut<TSyncIntSPSCQueue> TestSQPut;
+	TWorkerThread TestWTSQPut(_T("SPSCQueuePutThread"), TestSQPut, &SPSCQueue);
+	TestQueueGet<TSyncIntSPSCQueue> TestSQGet;
+	TWorkerThread TestWTSQGet(_T("SPSCQueueGetThread"), TestSQGet, &SPSCQueue);
+	TestWTSQGet.WaitFor();
+	LOG(_T("--- Finished All SPSC Queue Operation..."));
 	if (IsDebuggerPresent())
 		LOG(_T("--- NOTE: Since you have debugger attached, the performance is NOT accurate"));
 }
@@ -385,16 +669,485 @@ void TestSyncObjPool(void) {
 
 	LOG(_T("*** Test SyncObjPool (Threading correctness)"));
 	TSyncIntPool ThreadPool(_T("SyncIntThreadPool"), 256, 64);
-	TestSyncPool TestSOP;
+	TestSyncPool<> TestSOP;
 	TWorkerThread TestSOPSend(_T("PoolSenderThread"), TestSOP, &ThreadPool);
 	TWorkerThread TestSOPRecv(_T("PoolReceiverThread"), TestSOP, &ThreadPool);
 	TestSOPRecv.WaitFor();
 	LOG(_T("--- Finished All Pool Operation..."));
 	LOG(_T("--- Final pool capacity: %d"), ThreadPool.Capacity());
+
+	LOG(_T("*** Test SyncObjPool (Threading correctness, with magazines)"));
+	TSyncIntPool MagazinePool(_T("SyncIntMagazinePool"), 256, 64, 8);
+	TestSyncPool<> TestSOPM;
+	TWorkerThread TestSOPMSend(_T("MagazinePoolSenderThread"), TestSOPM, &MagazinePool);
+	TWorkerThread TestSOPMRecv(_T("MagazinePoolReceiverThread"), TestSOPM, &MagazinePool);
+	TestSOPMRecv.WaitFor();
+	LOG(_T("--- Finished All Pool Operation..."));
+	if (!MagazinePool.ObjectReturnLock(1000))
+		FAIL(_T("Objects cached in magazines were not returned"));
+	MagazinePool.ObjectReturnUnlock();
+	LOG(_T("--- Final pool capacity: %d"), MagazinePool.Capacity());
+
+	LOG(_T("*** Test SyncObjPool (Threading correctness, with slab allocation)"));
+	TSyncIntPool SlabPool(_T("SyncIntSlabPool"), 256, 64, 0, true);
+	{
+		// Payloads of the slab are packed in one array starting on a cache line
+		std::vector<TSyncIntPool::TSyncPoolObj*> SlabObjs;
+		for (int i = 0; i < 64; i++)
+			SlabObjs.push_back(SlabPool.Acquire());
+		Integer* SlabBase = &**SlabObjs.front();
+		if ((UINT_PTR)SlabBase % CACHE_LINE_SIZE)
+			FAIL(_T("Slab payloads not aligned to cache line"));
+		for (int i = 0; i < 64; i++) {
+			if (&**SlabObjs[i] != SlabBase + i)
+				FAIL(_T("Slab object #%d not packed"), i);
+		}
+		SlabObjs.front()->Replace(new Integer);
+		for (auto SlabObj : SlabObjs)
+			SlabObj->Release();
+		// Slab pools never deallocate part of a slab
+		LOG(_T("--- Slab pool capacity: %d"), SlabPool.Capacity());
+		if (SlabPool.Capacity() % 64)
+			FAIL(_T("Slab pool shrunk by a partial slab"));
+	}
+	LOG(_T("--- Slab construction failure (expect unwind)"));
+	{
+		// The first slab is built by the pool constructor
+		TFragilePayload::Budget = 10;
+		bool Created = true;
+		try {
+			TSyncObjPool<TFragilePayload> FragilePool(_T("FragileSlabPool"), 256, 64, 0, true);
+		} catch (Exception *e) {
+			e->Show();
+			delete e;
+			Created = false;
+		}
+		if (Created || (TFragilePayload::Live != 0))
+			FAIL(_T("Slab not unwound (%d payloads live)"), TFragilePayload::Live);
+		TFragilePayload::Budget = 64;
+		TSyncObjPool<TFragilePayload> FragilePool(_T("FragileSlabPool"), 256, 64, 0, true);
+		FragilePool.Acquire()->Release();
+	}
+	if (TFragilePayload::Live != 0)
+		FAIL(_T("Slab payloads leaked (%d live)"), TFragilePayload::Live);
+	TestSyncPool<> TestSOPS;
+	TWorkerThread TestSOPSSend(_T("SlabPoolSenderThread"), TestSOPS, &SlabPool);
+	TWorkerThread TestSOPSRecv(_T("SlabPoolReceiverThread"), TestSOPS, &SlabPool);
+	TestSOPSRecv.WaitFor();
+	LOG(_T("--- Finished All Pool Operation..."));
+	LOG(_T("--- Final pool capacity: %d"), SlabPool.Capacity());
 	if (IsDebuggerPresent())
 		LOG(_T("--- NOTE: Since you have debugger attached, the performance is NOT accurate"));
 }
 
+#define ALLOC_COUNT 1000000
+
+template<class TAllocator>
+void BenchAllocator(LPCTSTR Name, std::vector<Integer*> &Objs) {
+	Flatten_FILETIME StartTime;
+	GetSystemTimeAsFileTime(&StartTime.FileTime);
+	for (int Round = 0; Round < 10; Round++) {
+		for (int i = 0; i < ALLOC_COUNT / 10; i++)
+			Objs[i] = TAllocator::Create(i);
+		for (int i = 0; i < ALLOC_COUNT / 10; i++)
+			TAllocator::Destroy(Objs[i]);
+	}
+	Flatten_FILETIME EndTime;
+	GetSystemTimeAsFileTime(&EndTime.FileTime);
+	double TimeSpan = (double)(EndTime.U64 - StartTime.U64) / MSTime_o100ns / MSTime_aSecond;
+	LOG(_T("%s: %d objects in %.2f sec (%.2f ops/sec)"), Name, ALLOC_COUNT, TimeSpan, ALLOC_COUNT / TimeSpan);
+}
+
+void TestAllocators(void) {
+	LOG(_T("*** Test ArenaAllocator (Correctness)"));
+	TArena Arena(4 * BSize_aKB);
+	if (TArena::Current() != nullptr)
+		FAIL(_T("Unexpected arena in scope"));
+	{
+		TArena::TScope ArenaScope(Arena);
+		std::vector<Integer*> Objs;
+		for (int i = 0; i < 1000; i++)
+			Objs.push_back(ArenaAllocator<Integer>::Create(i));
+		for (int i = 0; i < 1000; i++) {
+			if (Objs[i]->value != i)
+				FAIL(_T("Expect %d, got %d"), i, Objs[i]->value);
+			ArenaAllocator<Integer>::Destroy(Objs[i]);
+		}
+		LOG(_T("--- Allocated %d bytes, reserved %d bytes"), (int)Arena.Allocated(), (int)Arena.Reserved());
+	}
+	if (TArena::Current() != nullptr)
+		FAIL(_T("Arena scope not restored"));
+	Arena.Reset();
+	if ((Arena.Allocated() != 0) || (Arena.Reserved() != Arena.ChunkSize))
+		FAIL(_T("Arena not properly reset"));
+
+	LOG(_T("*** Test ArenaAllocator (Bound arena, cross-thread integration)"));
+	{
+		typedef ArenaAllocator<Integer> TArenaIntAlloc;
+		TArena SharedArena(4 * BSize_aKB);
+		TArenaIntAlloc::Bind(&SharedArena);
+		{
+			ManagedRef<Integer, TArenaIntAlloc> Ref(EMPLACE_CONSTRUCT, 1);
+			ManagedRef<Integer, TArenaIntAlloc> RefMoved(std::move(Ref));
+			TSyncObj<Integer, TArenaIntAlloc> SyncObj(2);
+			SyncObj.Pickup()->value += RefMoved->value;
+			if (SyncObj.Pickup()->value != 3)
+				FAIL(_T("Expect 3, got %d"), SyncObj.Pickup()->value);
+
+			LOG(_T("--- Pool grows and shrinks on worker threads"));
+			TSyncObjPool<Integer, TArenaIntAlloc> ArenaPool(_T("SyncIntArenaPool"), 256, 64);
+			TestSyncPool<TSyncObjPool<Integer, TArenaIntAlloc>> TestSOPA;
+			TWorkerThread TestSOPASend(_T("ArenaPoolSenderThread"), TestSOPA, &ArenaPool);
+			TWorkerThread TestSOPARecv(_T("ArenaPoolReceiverThread"), TestSOPA, &ArenaPool);
+			TestSOPARecv.WaitFor();
+			TestSOPASend.WaitFor();
+			LOG(_T("--- Allocated %d bytes, reserved %d bytes"), (int)SharedArena.Allocated(), (int)SharedArena.Reserved());
+		}
+		// Destroyed objects are only reclaimed on reset
+		if (SharedArena.Allocated() == 0)
+			FAIL(_T("Arena allocations not accounted"));
+		SharedArena.Reset();
+		if ((SharedArena.Allocated() != 0) || (SharedArena.Reserved() != SharedArena.ChunkSize))
+			FAIL(_T("Arena not properly reset"));
+		TArenaIntAlloc::Bind(nullptr);
+		bool Created = true;
+		try {
+			TArenaIntAlloc::Create(0);
+		} catch (Exception *e) {
+			e->Show();
+			delete e;
+			Created = false;
+		}
+		if (Created)
+			FAIL(_T("Should not reach"));
+	}
+
+	LOG(_T("*** Test FixedPoolAllocator (Correctness)"));
+	{
+		std::vector<Integer*> Objs;
+		for (int i = 0; i < 1000; i++)
+			Objs.push_back(FixedPoolAllocator<Integer>::Create(i));
+		for (int i = 0; i < 1000; i++) {
+			if (Objs[i]->value != i)
+				FAIL(_T("Expect %d, got %d"), i, Objs[i]->value);
+			if ((UINT_PTR)Objs[i] % FIXEDPOOL_GRANULARITY)
+				FAIL(_T("Fixed pool object not properly aligned"));
+			FixedPoolAllocator<Integer>::Destroy(Objs[i]);
+		}
+		// Reuse freed blocks
+		Integer *Obj = FixedPoolAllocator<Integer>::Create(1);
+		if (Obj != Objs[999])
+			FAIL(_T("Freed block not reused"));
+		FixedPoolAllocator<Integer>::Destroy(Obj);
+		TFixedPool::FlushThreadCache();
+	}
+
+	LOG(_T("*** Test Allocators (Performance)"));
+#if defined(NEDMM)
+	LOG(_T("--- Heap backend: NedMM"));
+#elif defined(FASTMM)
+	LOG(_T("--- Heap backend: FastMM"));
+#else
+	LOG(_T("--- Heap backend: CRT"));
+#endif
+	{
+		std::vector<Integer*> Objs(ALLOC_COUNT);
+		BenchAllocator<SimpleAllocator<Integer>>(_T("SimpleAllocator"), Objs);
+		BenchAllocator<FixedPoolAllocator<Integer>>(_T("FixedPoolAllocator"), Objs);
+		TFixedPool::FlushThreadCache();
+
+		Flatten_FILETIME StartTime;
+		GetSystemTimeAsFileTime(&StartTime.FileTime);
+		{
+			TArena::TScope ArenaScope(Arena);
+			for (int i = 0; i < ALLOC_COUNT; i++)
+				Objs[i] = ArenaAllocator<Integer>::Create(i);
+			Arena.Reset();
+		}
+		Flatten_FILETIME EndTime;
+		GetSystemTimeAsFileTime(&EndTime.FileTime);
+		double TimeSpan = (double)(EndTime.U64 - StartTime.U64) / MSTime_o100ns / MSTime_aSecond;
+		LOG(_T("ArenaAllocator: %d objects in %.2f sec (%.2f ops/sec)"), ALLOC_COUNT, TimeSpan, ALLOC_COUNT / TimeSpan);
+	}
+	if (IsDebuggerPresent())
+		LOG(_T("--- NOTE: Since you have debugger attached, the performance is NOT accurate"));
+}
+
+void ReplayTrace(TRecMMReplayPlan const &Plan, IRecMMReplayBackend &Backend) {
+	TRecMMReplayPlan::TResult Result = Plan.Replay(Backend);
+	LOG(_T("%s: %llu operations in %.3f sec (%.2f ops/sec), peak footprint %.2fKB"), Backend.Name(),
+		Result.Operations, Result.Seconds, Result.Operations / max(Result.Seconds, 1e-9),
+		(double)Result.PeakFootprint / BSize_aKB);
+}
+
+void TestTraceAnalyzer(LPCTSTR TraceFile) {
+	TString FileName;
+	if (TraceFile == nullptr) {
+		LOG(_T("*** Test Trace Analyzer (Synthetic Trace)"));
+		FileName = _T("MemOps.Test.log");
+		FILE *File;
+		if (_tfopen_s(&File, FileName.c_str(), _T("wb")) != 0)
+			FAIL(_T("Unable to create synthetic trace"));
+		TRecMMTraceHeader const Header = {RECMM_TRACE_MAGIC, RECMM_TRACE_VERSION, sizeof(void*), 0};
+		fwrite(&Header, sizeof(Header), 1, File);
+		// Thread 1 allocates A and B, frees A, then allocates over live C;
+		// thread 2 allocates and grows C, reuses A in the same tick as its free, frees B and something unknown
+		UINT64 const Ops[2][5][5] = {
+			{{100, 1, 0x10000, 100, 0}, {300, 3, 0x20000, 5000, 0}, {500, 6, 0x10000, 0, 0}, {800, 10, 0x30000, 8, 0}},
+			{{200, 2, 0x30000, 16, 0}, {400, 4, 0x30000, 32, 1}, {500, 7, 0x10000, 64, 0}, {600, 8, 0x20000, 0, 0},
+			 {700, 9, 0x40000, 0, 0}},
+		};
+		UINT32 const Counts[2] = {4, 5};
+		for (int i = 0; i < 2; i++) {
+			BYTE Payload[5 * 4 * RECMM_VARINT_MAX];
+			TRecMMChunkHeader ChunkHeader = {RECMM_CHUNK_MAGIC, (UINT32)i + 1, Counts[i], 0, Ops[i][0][0], Ops[i][0][2], Ops[i][0][1]};
+			TRecMMChunkEncoder Encoder(ChunkHeader.BaseTS, ChunkHeader.BaseAddr, ChunkHeader.BaseSeq);
+			BYTE *Cursor = Payload;
+			for (UINT32 j = 0; j < Counts[i]; j++)
+				Cursor = Encoder.Put(Cursor, Ops[i][j][0], Ops[i][j][1], Ops[i][j][2], Ops[i][j][3], Ops[i][j][4] != 0);
+			ChunkHeader.Length = (UINT32)(Cursor - Payload);
+			fwrite(&ChunkHeader, sizeof(ChunkHeader), 1, File);
+			fwrite(Payload, 1, ChunkHeader.Length, File);
+		}
+		// No index, exercise chunk scanning
+		fclose(File);
+	} else {
+		LOG(_T("*** Test Trace Analyzer (%s)"), TraceFile);
+		FileName = TraceFile;
+	}
+
+	TRecMMTrace Trace(FileName);
+	TRecMMAnalyzer Analyzer(Trace);
+	TRecMMReplayPlan Plan;
+	Analyzer.Analyze(&Plan);
+	Analyzer.Report();
+
+	if (TraceFile == nullptr) {
+		TRecMMAnalyzer::TStats const &Stats = Analyzer.Stats;
+		if ((Trace.ChunkCount() != 2) || (Stats.Allocs != 4) || (Stats.Resizes != 1) || (Stats.Frees != 2) ||
+			(Stats.WildFrees != 1) || (Stats.Overlaps != 1))
+			FAIL(_T("Unexpected operation counts"));
+		if ((Stats.PeakBytes != 5132) || (Stats.PeakCount != 3) || (Stats.PeakTS != 400))
+			FAIL(_T("Unexpected peak footprint %d"), (int)Stats.PeakBytes);
+		if ((Stats.LiveBytes != 96) || (Stats.LiveCount != 2) || (Stats.LivePages != 2))
+			FAIL(_T("Unexpected remaining blocks"));
+		if (Plan.Count() != 7)
+			FAIL(_T("Unexpected replay plan size %d"), (int)Plan.Count());
+		_tremove(FileName.c_str());
+	}
+
+	LOG(_T("*** Test Trace Replay"));
+	{ TRecMMReplayCRT Backend; ReplayTrace(Plan, Backend); }
+	{ TRecMMReplayHeap Backend; ReplayTrace(Plan, Backend); }
+#ifdef NEDMM
+	{ TRecMMReplayNed Backend; ReplayTrace(Plan, Backend); }
+#endif
+#ifdef FASTMM
+	{ TRecMMReplayFast Backend; ReplayTrace(Plan, Backend); }
+#endif
+	{ TRecMMReplayFixedPool Backend; ReplayTrace(Plan, Backend); }
+	{ TRecMMReplayArena Backend; ReplayTrace(Plan, Backend); }
+	if (IsDebuggerPresent())
+		LOG(_T("--- NOTE: Since you have debugger attached, the performance is NOT accurate"));
+}
+
+#if defined(STATMM) && !defined(STATMM_LT)
+
+// Dedicated allocation site, isolates test allocations from everything else being recorded
+static TCHAR const StatMMTestSite[] = _T("StatMMTestSite");
+
+class TestStatMMAlloc : public TRunnable {
+protected:
+	void* Run(TWorkerThread &WorkerThread, void* pBlocks) override {
+		std::vector<void*> &Blocks = *static_cast<std::vector<void*>*>(pBlocks);
+		for (size_t i = 0; i < Blocks.size(); i++)
+			Blocks[i] = _malloc_stat(16 + (i % 64) * 16, StatMMTestSite, 1);
+		return nullptr;
+	}
+};
+
+// Two distinct call paths to the same allocation site, for call stack attribution
+__declspec(noinline) static void* TestStatMMStackA(size_t Size)
+{ return _malloc_stat(Size, StatMMTestSite, 4); }
+__declspec(noinline) static void* TestStatMMStackB(size_t Size)
+{ return _malloc_stat(Size, StatMMTestSite, 4); }
+
+#endif
+
+void TestStatMM(void) {
+#if defined(STATMM) && !defined(STATMM_LT)
+	LOG(_T("*** Test StatMM (Sharded totals)"));
+	{
+		size_t const COUNT = 10000;
+		std::vector<void*> Blocks[4];
+		for (auto &ThreadBlocks : Blocks)
+			ThreadBlocks.resize(COUNT);
+		_MM_Stats Before = _MM_AllocStats();
+		{
+			TestStatMMAlloc Allocator;
+			TWorkerThread Worker1(_T("StatMMWorker1"), Allocator, &Blocks[0]);
+			TWorkerThread Worker2(_T("StatMMWorker2"), Allocator, &Blocks[1]);
+			TWorkerThread Worker3(_T("StatMMWorker3"), Allocator, &Blocks[2]);
+			TWorkerThread Worker4(_T("StatMMWorker4"), Allocator, &Blocks[3]);
+			Worker1.WaitFor();
+			Worker2.WaitFor();
+			Worker3.WaitFor();
+			Worker4.WaitFor();
+		}
+		size_t Bytes = 0;
+		for (auto &ThreadBlocks : Blocks)
+			for (void *Block : ThreadBlocks)
+				Bytes += _msize(Block);
+
+		_MM_Stats Site = _MM_SiteStats(StatMMTestSite, 1);
+		LOG(_T("Site: %d blocks, %d bytes (expect %d blocks, %d bytes)"),
+			(int)Site.__Alloc_Count, (int)Site.__Alloc_Size, (int)(COUNT * 4), (int)Bytes);
+		if ((Site.__Alloc_Count != COUNT * 4) || (Site.__Alloc_Size != Bytes))
+			FAIL(_T("Merged site records mismatch"));
+		_MM_Stats After = _MM_AllocStats();
+		if ((After.__Alloc_Count - Before.__Alloc_Count < COUNT * 4) ||
+			(After.__Alloc_Cumulative - Before.__Alloc_Cumulative < Bytes))
+			FAIL(_T("Merged totals missing allocations"));
+		if (After.__Alloc_Cumulative - After.__Dealloc_Cumulative != After.__Alloc_Size)
+			FAIL(_T("Merged totals inconsistent"));
+
+		// Free from another thread than the allocating ones
+		for (auto &ThreadBlocks : Blocks)
+			for (void *Block : ThreadBlocks)
+				free(Block);
+		Site = _MM_SiteStats(StatMMTestSite, 1);
+		if ((Site.__Alloc_Count != 0) || (Site.__Alloc_Size != 0))
+			FAIL(_T("Site records remain after free (%d blocks)"), (int)Site.__Alloc_Count);
+		_MM_Stats Final = _MM_AllocStats();
+		if ((Final.__Dealloc_Count - After.__Dealloc_Count < COUNT * 4) ||
+			(Final.__Dealloc_Cumulative - After.__Dealloc_Cumulative < Bytes))
+			FAIL(_T("Merged totals missing deallocations"));
+	}
+
+	LOG(_T("*** Test StatMM (Snapshots)"));
+	{
+		size_t const COUNT = 1000;
+		std::vector<void*> Blocks(COUNT);
+		_MM_TakeSnapshot(_T("Before"));
+		for (size_t i = 0; i < COUNT; i++)
+			Blocks[i] = _malloc_stat(64, StatMMTestSite, 2);
+		_MM_TakeSnapshot(_T("After"));
+		if (_MM_SiteStats(StatMMTestSite, 2).__Alloc_Count != COUNT)
+			FAIL(_T("Snapshot site records mismatch"));
+		_MM_CompareSnapshots(_T("Before"), _T("After"));
+		_MM_CompareSnapshots(_T("After"));
+
+		for (void *Block : Blocks)
+			free(Block);
+		// Replaces the previous snapshot of the same name, and keeps its slot
+		_MM_TakeSnapshot(_T("After"));
+		_MM_CompareSnapshots(_T("Before"), _T("After"));
+
+		// Fill up the remaining slots
+		std::vector<TString> Fillers;
+		for (int i = 2; i < 16; i++) {
+			Fillers.emplace_back(TStringCast(_T("Filler") << i));
+			_MM_TakeSnapshot(Fillers.back().c_str());
+		}
+		bool Taken = true;
+		try {
+			_MM_TakeSnapshot(_T("Overflow"));
+		} catch (Exception *e) {
+			e->Show();
+			delete e;
+			Taken = false;
+		}
+		if (Taken)
+			FAIL(_T("Snapshot taken beyond the limit"));
+		// Replacing still works when all slots are taken
+		_MM_TakeSnapshot(_T("After"));
+
+		_MM_DropSnapshot(_T("Before"));
+		bool Found = true;
+		try {
+			_MM_CompareSnapshots(_T("Before"), _T("After"));
+		} catch (Exception *e) {
+			e->Show();
+			delete e;
+			Found = false;
+		}
+		if (Found)
+			FAIL(_T("Dropped snapshot still found"));
+		// The dropped slot can be reused
+		_MM_TakeSnapshot(_T("Overflow"));
+
+		_MM_DropSnapshot(_T("Overflow"));
+		_MM_DropSnapshot(_T("After"));
+		for (auto &Filler : Fillers)
+			_MM_DropSnapshot(Filler.c_str());
+	}
+
+	LOG(_T("*** Test StatMM (Periodic snapshots)"));
+	{
+		_MM_SetSnapshotInterval(50);
+		Sleep(120);
+		_MM_SetSnapshotInterval(0);
+	}
+
+	LOG(_T("*** Test StatMM (Sampling)"));
+	{
+		size_t const COUNT = 20000;
+		size_t const SIZE = 256;
+		size_t const PrevRate = _MM_GetSampleRate();
+		std::vector<void*> Blocks(COUNT);
+		// About 300 samples expected, the estimates should be within a few percents
+		_MM_SetSampleRate(16 * 1024);
+		for (size_t i = 0; i < COUNT; i++)
+			Blocks[i] = _malloc_stat(SIZE, StatMMTestSite, 3);
+
+		_MM_Stats Site = _MM_SiteStats(StatMMTestSite, 3);
+		LOG(_T("Sampled site: ~%d blocks, ~%d bytes (expect %d blocks, %d bytes)"),
+			(int)Site.__Alloc_Count, (int)Site.__Alloc_Size, (int)COUNT, (int)(COUNT * SIZE));
+		if ((Site.__Alloc_Count < COUNT * 3 / 4) || (Site.__Alloc_Count > COUNT * 5 / 4))
+			FAIL(_T("Sampled block count estimate out of tolerance"));
+		// Allocated sizes may be rounded up by the underlying memory manager
+		if ((Site.__Alloc_Size < COUNT * SIZE * 3 / 4) || (Site.__Alloc_Size > COUNT * SIZE * 3 / 2))
+			FAIL(_T("Sampled size estimate out of tolerance"));
+
+		size_t Wild = _MM_AllocStats().__Dealloc_Wild;
+		for (void *Block : Blocks)
+			free(Block);
+		if (_MM_AllocStats().__Dealloc_Wild != Wild)
+			FAIL(_T("Unsampled blocks deallocated as wild"));
+		Site = _MM_SiteStats(StatMMTestSite, 3);
+		if ((Site.__Alloc_Count != 0) || (Site.__Alloc_Size != 0))
+			FAIL(_T("Sampled site records remain after free (%d blocks)"), (int)Site.__Alloc_Count);
+		_MM_SetSampleRate(PrevRate);
+	}
+
+	LOG(_T("*** Test StatMM (Call stacks)"));
+	{
+		size_t const COUNT = 100;
+		size_t const PrevDepth = _MM_GetStackDepth();
+		std::vector<void*> Blocks(COUNT * 2);
+		_MM_SetStackDepth(8);
+		if (_MM_GetStackDepth() != 8)
+			FAIL(_T("Stack depth not applied"));
+		// Repeated allocations from one path share a deduplicated stack record
+		for (size_t i = 0; i < COUNT; i++) {
+			Blocks[i * 2] = TestStatMMStackA(32);
+			Blocks[i * 2 + 1] = TestStatMMStackB(32);
+		}
+		_MM_Stats Site = _MM_SiteStats(StatMMTestSite, 4);
+		if (Site.__Alloc_Count != COUNT * 2)
+			FAIL(_T("Site records mismatch across call stacks (%d blocks)"), (int)Site.__Alloc_Count);
+		// Expect the site listed once per call path, each followed by its symbolized stack
+		_MM_DumpDetails();
+
+		for (void *Block : Blocks)
+			free(Block);
+		_MM_SetStackDepth(PrevDepth);
+	}
+#else
+	LOG(_T("*** Test StatMM (Not enabled in this configuration)"));
+#endif
+}
+
 void TestIdentifiers(void) {
 	LOG(_T("*** Test Identifiers"));
 	LOG(_T("RootIdent: %s"), RootIdent().toString().c_str());
@@ -550,11 +1303,229 @@ void TestThrottler(void) {
 	BZ4.SignalTerminate();
 }
 
+void TestThreadPool(void) {
+	LOG(_T("*** Test Thread Pool"));
+	TThreadPool Pool(_T("TestPool"), 4);
+
+	LOG(_T("--- Callable tasks"));
+	{
+		std::vector<std::future<int>> Results;
+		for (int i = 0; i < 1000; i++)
+			Results.emplace_back(Pool.Submit([i] { return i * 2; }));
+		int Sum = 0;
+		for (auto &Result : Results)
+			Sum += Result.get();
+		LOG(_T("Sum = %d"), Sum);
+		if (Sum != 999000)
+			FAIL(_T("Unexpected sum"));
+	}
+
+	LOG(_T("--- Runnable tasks"));
+	{
+		TestCount TestCtr;
+		TSyncInteger e(0);
+		auto R1(Pool.Submit(TestCtr, &e));
+		auto R2(Pool.Submit(TestCtr, &e));
+		R1.get();
+		R2.get();
+		LOG(_T("e = %d"), (Integer&)e.Pickup());
+
+		TestExcept TestRun;
+		auto R3(Pool.Submit(TestRun, nullptr));
+		try {
+			R3.get();
+		} catch (Exception *e) {
+			e->Show();
+			delete e;
+		}
+	}
+
+	LOG(_T("--- Nested tasks (work stealing)"));
+	TSyncInteger Ctr(0);
+	{
+		std::vector<std::future<void>> Spawners;
+		for (int i = 0; i < 4; i++) {
+			Spawners.emplace_back(Pool.Submit([&Pool, &Ctr] {
+				for (int j = 0; j < 10000; j++)
+					Pool.Submit([&Ctr] { ((Integer&)Ctr.Pickup())++; });
+			}));
+		}
+		for (auto &Spawner : Spawners)
+			Spawner.get();
+	}
+	// Shutdown drains all pending tasks
+	Pool.Shutdown();
+	LOG(_T("Ctr = %d"), (Integer&)Ctr.Pickup());
+	if ((Integer&)Ctr.Pickup() != 40000)
+		FAIL(_T("Lost nested tasks"));
+}
+
+template<class TFunc>
+double TimeIt(TFunc const &Func) {
+	Flatten_FILETIME StartTime;
+	GetSystemTimeAsFileTime(&StartTime.FileTime);
+	Func();
+	Flatten_FILETIME EndTime;
+	GetSystemTimeAsFileTime(&EndTime.FileTime);
+	return (double)(EndTime.U64 - StartTime.U64) / MSTime_o100ns / MSTime_aSecond;
+}
+
+double ComputeKernel(int i) {
+	double x = i;
+	for (int j = 0; j < 64; j++)
+		x = sqrt(fabs(sin(x) * 1000.0 + j));
+	return x;
+}
+
+void TestParallel(void) {
+	LOG(_T("*** Test Parallel Algorithms"));
+	TThreadPool Pool(_T("ParallelPool"));
+	LOG(_T("Using %d workers"), (int)Pool.WorkerCount());
+
+	int COUNT = IsDebuggerPresent() ? 1000000 : 16000000;
+	std::vector<double> Data(COUNT, 1.0);
+
+	LOG(_T("--- Memory-bound (scale and sum)"));
+	{
+		double SerialTime = TimeIt([&] {
+			for (int i = 0; i < COUNT; i++)
+				Data[i] = Data[i] * 2.0 + 1.0;
+		});
+		double ParallelTime = TimeIt([&] {
+			ParallelFor(Pool, 0, COUNT, 0, [&](int Begin, int End) {
+				for (int i = Begin; i < End; i++)
+					Data[i] = Data[i] * 2.0 + 1.0;
+			});
+		});
+		LOG(_T("Scale: serial %.3f sec, parallel %.3f sec (%.2fx)"), SerialTime, ParallelTime, SerialTime / ParallelTime);
+
+		double SerialSum = 0, ParallelSum = 0;
+		SerialTime = TimeIt([&] {
+			for (int i = 0; i < COUNT; i++)
+				SerialSum += Data[i];
+		});
+		ParallelTime = TimeIt([&] {
+			ParallelSum = ParallelReduce(Pool, 0, COUNT, 0, 0.0, [&](int Begin, int End) {
+				double Sum = 0;
+				for (int i = Begin; i < End; i++)
+					Sum += Data[i];
+				return Sum;
+			}, [](double const &A, double const &B) { return A + B; });
+		});
+		LOG(_T("Sum: serial %.3f sec, parallel %.3f sec (%.2fx)"), SerialTime, ParallelTime, SerialTime / ParallelTime);
+		if (SerialSum != (double)COUNT * 7.0 || ParallelSum != SerialSum)
+			FAIL(_T("Sum mismatch (%f / %f)"), SerialSum, ParallelSum);
+	}
+
+	LOG(_T("--- Compute-bound"));
+	{
+		int CCOUNT = COUNT / 16;
+		double SerialSum = 0, ParallelSum = 0;
+		double SerialTime = TimeIt([&] {
+			for (int i = 0; i < CCOUNT; i++)
+				SerialSum += ComputeKernel(i);
+		});
+		double ParallelTime = TimeIt([&] {
+			ParallelSum = ParallelReduce(Pool, 0, CCOUNT, 0, 0.0, [](int Begin, int End) {
+				double Sum = 0;
+				for (int i = Begin; i < End; i++)
+					Sum += ComputeKernel(i);
+				return Sum;
+			}, [](double const &A, double const &B) { return A + B; });
+		});
+		LOG(_T("Kernel: serial %.3f sec, parallel %.3f sec (%.2fx)"), SerialTime, ParallelTime, SerialTime / ParallelTime);
+		if (fabs(SerialSum - ParallelSum) > fabs(SerialSum) * 1e-9)
+			FAIL(_T("Sum mismatch (%f / %f)"), SerialSum, ParallelSum);
+	}
+
+	LOG(_T("--- Nested parallelism"));
+	{
+		TSyncInteger Ctr(0);
+		ParallelFor(Pool, 0, 64, 1, [&](int Begin, int End) {
+			ParallelFor(Pool, 0, 1000, 10, [&](int SubBegin, int SubEnd) {
+				((Integer&)Ctr.Pickup()).value += SubEnd - SubBegin;
+			});
+		});
+		LOG(_T("Ctr = %d"), (Integer&)Ctr.Pickup());
+		if ((Integer&)Ctr.Pickup() != 64000)
+			FAIL(_T("Lost nested iterations"));
+	}
+}
+
+void TestFibers(void) {
+	LOG(_T("*** Test Fiber Tasks"));
+	TFiberScheduler Scheduler(_T("TestScheduler"), 2);
+
+	LOG(_T("--- Await semaphore"));
+	{
+		int COUNT = 1000;
+		TSemaphore Sem;
+		TSyncInteger Done(0);
+		for (int i = 0; i < COUNT; i++) {
+			Scheduler.Spawn([&] {
+				if (TFiberScheduler::Await(Sem) == WaitResult::Signaled)
+					((Integer&)Done.Pickup())++;
+			});
+		}
+		Sem.Signal(COUNT);
+		Scheduler.Drain();
+		LOG(_T("Done = %d"), (Integer&)Done.Pickup());
+		if ((Integer&)Done.Pickup() != COUNT)
+			FAIL(_T("Lost tasks"));
+	}
+
+	LOG(_T("--- Await queue"));
+	{
+		TSyncIntQueue Queue(_T("FiberQueue"));
+		TSyncInteger Sum(0);
+		for (int i = 0; i < 100; i++) {
+			Scheduler.Spawn([&] {
+				int Entry;
+				while (TFiberScheduler::AwaitDequeue(Queue, Entry) && (Entry >= 0))
+					((Integer&)Sum.Pickup()).value += Entry;
+			});
+		}
+		for (int i = 0; i < 10000; i++)
+			Queue.Enqueue(i);
+		for (int i = 0; i < 100; i++)
+			Queue.Enqueue(-1);
+		Scheduler.Drain();
+		LOG(_T("Sum = %d"), (Integer&)Sum.Pickup());
+		if ((Integer&)Sum.Pickup() != 49995000)
+			FAIL(_T("Lost entries"));
+	}
+
+	LOG(_T("--- Await pool"));
+	{
+		TSyncIntPool Pool(_T("FiberPool"), 4, 4);
+		for (int i = 0; i < 50; i++) {
+			Scheduler.Spawn([&] {
+				auto Obj = TFiberScheduler::AwaitAcquire(Pool);
+				TFiberScheduler::Reschedule();
+				Obj->Release();
+			});
+		}
+		Scheduler.Drain();
+	}
+
+	LOG(_T("--- Await timeout"));
+	{
+		TEvent Never;
+		WaitResult Ret = WaitResult::Error;
+		Scheduler.Spawn([&] {
+			Ret = TFiberScheduler::Await(Never, 100);
+		});
+		Scheduler.Drain();
+		if (Ret != WaitResult::TimedOut)
+			FAIL(_T("Unexpected wait result %d"), Ret);
+	}
+}
+
 int _tmain(int argc, LPCTSTR argv[], LPCTSTR envp[]) {
 	LOG(_T("%s"), __REL_FILE__);
 	try {
-		if (argc != 2)
-			FAIL(_T("Require 1 parameter: <TestType> = 'ALL' | 'Exception' / 'ErrCode' / 'SyncObj' / 'SyncQueue' / 'SyncObjPool' / 'Identifiers' / 'StringConv' / 'Throttler'"));
+		if ((argc != 2) && (argc != 3))
+			FAIL(_T("Require 1 parameter: <TestType> = 'ALL' | 'Exception' / 'ErrCode' / 'SyncObj' / 'SyncQueue' / 'SyncObjPool' / 'Allocators' / 'TraceAnalyzer' [TraceFile] / 'StatMM' / 'Identifiers' / 'StringConv' / 'Throttler' / 'ThreadPool' / 'Parallel' / 'Fibers'"));
 
 		bool TestAll = _tcsicmp(argv[1], _T("ALL")) == 0;
 		if (TestAll || (_tcsicmp(argv[1], _T("Exception")) == 0)) {
@@ -572,6 +1543,15 @@ int _tmain(int argc, LPCTSTR argv[], LPCTSTR envp[]) {
 		if (TestAll || (_tcsicmp(argv[1], _T("SyncObjPool")) == 0)) {
 			TestSyncObjPool();
 		}
+		if (TestAll || (_tcsicmp(argv[1], _T("Allocators")) == 0)) {
+			TestAllocators();
+		}
+		if (TestAll || (_tcsicmp(argv[1], _T("TraceAnalyzer")) == 0)) {
+			TestTraceAnalyzer(argc > 2 ? argv[2] : nullptr);
+		}
+		if (TestAll || (_tcsicmp(argv[1], _T("StatMM")) == 0)) {
+			TestStatMM();
+		}
 		if (TestAll || (_tcsicmp(argv[1], _T("Identifiers")) == 0)) {
 			TestIdentifiers();
 		}
@@ -581,6 +1561,15 @@ int _tmain(int argc, LPCTSTR argv[], LPCTSTR envp[]) {
 		if (TestAll || (_tcsicmp(argv[1], _T("Throttler")) == 0)) {
 			TestThrottler();
 		}
+		if (TestAll || (_tcsicmp(argv[1], _T("ThreadPool")) == 0)) {
+			TestThreadPool();
+		}
+		if (TestAll || (_tcsicmp(argv[1], _T("Parallel")) == 0)) {
+			TestParallel();
+		}
+		if (TestAll || (_tcsicmp(argv[1], _T("Fibers")) == 0)) {
+			TestFibers();
+		}
 	} catch (Exception *e) {
 		e->Show();
 		delete e;
@@ -0,0 +1,138 @@
+/*
+Copyright (c) 2005 - 2016, Zhenyu Wu; 2012 - 2016, NEC Labs America Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of ZWUtils-VCPP nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "BaseLib/MMSwitcher.h"
+
+#include "BaseLib/Misc.h"
+
+#include "BaseLib/DebugLog.h"
+#include "BaseLib/Exception.h"
+
+#include "ThreadLib/SyncPrems.h"
+
+#include <thread>
+#include <functional>
+#include <chrono>
+
+static void __Delayed(DWORD Delay, std::function<void(void)> const &Action) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(Delay));
+	Action();
+}
+
+static void __ExpectWait(WaitResult Ret, WaitResult Expect, LPCTSTR Case) {
+	if (Ret != Expect)
+		FAIL(_T("%s: unexpected wait result %d (expect %d)"), Case, (int)Ret, (int)Expect);
+	LOG(_T("%s: OK"), Case);
+}
+
+void TestWaitMultiple(void) {
+	LOG(_T("*** Test WaitMultiple (wait-any)"));
+	{
+		TEvent EventA, EventB;
+		__ExpectWait(WaitMultiple({EventA, EventB}, false, 50), WaitResult::TimedOut, _T("Any / none signaled"));
+
+		std::thread Signaler(__Delayed, 50, [&] { EventB.Set(); });
+		__ExpectWait(WaitMultiple({EventA, EventB}, false, 5000), (WaitResult)(WaitResult::Signaled_0 + 1), _T("Any / second signaled later"));
+		Signaler.join();
+		// Auto-reset event is consumed by the wait
+		__ExpectWait(WaitSingle(EventB, 0), WaitResult::TimedOut, _T("Any / signal consumed"));
+
+		EventA.Set();
+		EventB.Set();
+		__ExpectWait(WaitMultiple({EventA, EventB}, false, 0), WaitResult::Signaled_0, _T("Any / lowest index wins"));
+		__ExpectWait(WaitSingle(EventB, 0), WaitResult::Signaled, _T("Any / other signal kept"));
+	}
+
+	LOG(_T("*** Test WaitMultiple (wait-all)"));
+	{
+		TSemaphore Semaphore(0, 10);
+		TEvent Event(true, false);
+		Semaphore.Signal();
+		__ExpectWait(WaitMultiple({Semaphore, Event}, true, 50), WaitResult::TimedOut, _T("All / partially signaled"));
+		// Nothing is acquired unless all objects are
+		__ExpectWait(WaitSingle(Semaphore, 0), WaitResult::Signaled, _T("All / partial signal kept"));
+
+		std::thread Signaler(__Delayed, 50, [&] {
+			Semaphore.Signal();
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			Event.Set();
+		});
+		__ExpectWait(WaitMultiple({Semaphore, Event}, true, 5000), WaitResult::Signaled, _T("All / signaled one by one"));
+		Signaler.join();
+		__ExpectWait(WaitSingle(Semaphore, 0), WaitResult::TimedOut, _T("All / semaphore count consumed"));
+		__ExpectWait(WaitSingle(Event, 0), WaitResult::Signaled, _T("All / manual-reset event stays set"));
+
+		__ExpectWait(WaitMultiple({Event, Event}, true, 0), WaitResult::Error, _T("All / duplicated objects"));
+	}
+
+	LOG(_T("*** Test WaitMultiple (contended wait-any)"));
+	{
+		TSemaphore Semaphore(0, 1000);
+		TEvent Stop(true, false);
+		volatile LONG Acquired = 0;
+		std::vector<std::thread> Waiters;
+		for (int i = 0; i < 4; i++) {
+			Waiters.emplace_back([&] {
+				while (WaitMultiple({Stop, Semaphore}, false) == (WaitResult)(WaitResult::Signaled_0 + 1))
+					InterlockedIncrement(&Acquired);
+			});
+		}
+		for (int i = 0; i < 1000; i++)
+			Semaphore.Signal();
+		TDeadline Deadline(5000);
+		while ((Acquired < 1000) && !Deadline.Expired())
+			std::this_thread::yield();
+		Stop.Set();
+		for (auto &Waiter : Waiters)
+			Waiter.join();
+		if (Acquired != 1000)
+			FAIL(_T("Contended: %d signals acquired (expect 1000)"), (int)Acquired);
+		LOG(_T("Contended: OK"));
+	}
+}
+
+int main(int argc, char *argv[]) {
+	LOG(_T("%s"), __REL_FILE__);
+	try {
+		if (argc != 2)
+			FAIL(_T("Require 1 parameter: <TestType> = 'ALL' | 'WaitMultiple'"));
+
+		bool TestAll = _tcsicmp(argv[1], _T("ALL")) == 0;
+		if (TestAll || (_tcsicmp(argv[1], _T("WaitMultiple")) == 0)) {
+			TestWaitMultiple();
+		}
+	} catch (Exception *e) {
+		e->Show();
+		delete e;
+		return 1;
+	}
+	return 0;
+}